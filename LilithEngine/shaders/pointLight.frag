@@ -18,11 +18,6 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
 	int numLights;
 } globUbo;
 
-layout(set = 1, binding = 0) uniform GameObjectUbo {
-	bool usesColorTexture;
-	uint textureId;
-} goUbo;
-
 layout(push_constant) uniform Push {
 	vec4 position;
 	vec4 color;
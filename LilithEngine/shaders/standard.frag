@@ -1,11 +1,17 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec3 fragPosWorld;
 layout (location = 1) in vec3 fragColor;
 layout (location = 2) in vec3 fragNormalWorld;
 layout (location = 3) in vec2 fragTexCoord;
+layout (location = 4) flat in uint fragTextureId;
+layout (location = 5) flat in uint fragFlags;
 
-layout (set = 0, binding = 1) uniform sampler2D texSampler[10];
+const uint INSTANCE_FLAG_USES_COLOR_TEXTURE = 1u << 0;
+
+// Bindless texture table, see LthTextureTable. The instances of a draw may use different textures.
+layout (set = 2, binding = 0) uniform sampler2D texSampler[];
 
 struct PointLight {
 	vec3 position;
@@ -22,23 +28,13 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
 	int numLights;
 } globUbo;
 
-layout(set = 1, binding = 0) uniform GameObjectUbo {
-	bool usesColorTexture;
-	uint textureId;
-} goUbo;
-
-layout(push_constant) uniform Push {
-	mat4 modelMatrix;
-	mat4 normalMatrix;
-} push;
-
 layout (location = 0) out vec4 outColor;
 
 
 void main() {
 	vec3 albedo;
-	if (goUbo.usesColorTexture) {
-		albedo = texture(texSampler[goUbo.textureId], fragTexCoord).xyz;
+	if ((fragFlags & INSTANCE_FLAG_USES_COLOR_TEXTURE) != 0) {
+		albedo = texture(texSampler[nonuniformEXT(fragTextureId)], fragTexCoord).xyz;
 	} else {
 		albedo = fragColor;
 	}
@@ -1,10 +1,5 @@
 #version 450
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 color;
-layout(location = 2) in vec3 normal;
-layout(location = 3) in vec2 uv;
-
 struct PointLight {
 	vec3 position;
 	float quadraticAttenuation;
@@ -21,28 +16,76 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
 	int numLights;
 } globUbo;
 
-layout(set = 1, binding = 0) uniform GameObjectUbo {
-	bool usesColorTexture;
-	uint textureId;
-} goUbo;
-
-layout(push_constant) uniform Push {
+struct InstanceData {
 	mat4 modelMatrix;
 	mat4 normalMatrix;
-} push;
+	uint textureId;
+	uint flags;
+	uint vertexOffset; // In 32 bits words.
+	uint vertexFormat;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer {
+	InstanceData instances[];
+} instanceBuffer;
+
+// LthVertexFormat, see lth_model.hpp.
+const uint VERTEX_FORMAT_FULL = 0;
+const uint VERTEX_FORMAT_PACKED = 1;
+const uint FULL_VERTEX_WORD_COUNT = 11; // position, color, normal and uv as floats.
+const uint PACKED_VERTEX_WORD_COUNT = 6; // float position, octahedral snorm16 normal, half uv and unorm8 color.
+
+layout(std430, set = 1, binding = 1) readonly buffer VertexBuffer {
+	uint vertexWords[];
+} vertexBuffer;
 
 layout(location = 0) out vec3 fragPosWorld;
 layout(location = 1) out vec3 fragColor;
 layout(location = 2) out vec3 fragNormalWorld;
 layout(location = 3) out vec2 fragTexCoord;
+layout(location = 4) flat out uint fragTextureId;
+layout(location = 5) flat out uint fragFlags;
+
 
+vec3 readVec3(uint word) {
+	return uintBitsToFloat(uvec3(vertexBuffer.vertexWords[word], vertexBuffer.vertexWords[word + 1], vertexBuffer.vertexWords[word + 2]));
+}
+
+vec3 decodeOctahedral(vec2 octahedral) {
+	vec3 normal = vec3(octahedral, 1.0 - abs(octahedral.x) - abs(octahedral.y));
+	float t = max(-normal.z, 0.0);
+	normal.xy += mix(vec2(t), vec2(-t), greaterThanEqual(normal.xy, vec2(0.0)));
+	return normalize(normal);
+}
 
 void main() {
-	vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+	InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
+
+	// gl_VertexIndex is relative to the model, its vertices start at the instance vertexOffset in the geometry pool.
+	vec3 position, color, normal;
+	vec2 uv;
+	if (instance.vertexFormat == VERTEX_FORMAT_PACKED) {
+		uint base = instance.vertexOffset + uint(gl_VertexIndex) * PACKED_VERTEX_WORD_COUNT;
+		position = readVec3(base);
+		normal = decodeOctahedral(unpackSnorm2x16(vertexBuffer.vertexWords[base + 3]));
+		uv = unpackHalf2x16(vertexBuffer.vertexWords[base + 4]);
+		color = unpackUnorm4x8(vertexBuffer.vertexWords[base + 5]).rgb;
+	}
+	else {
+		uint base = instance.vertexOffset + uint(gl_VertexIndex) * FULL_VERTEX_WORD_COUNT;
+		position = readVec3(base);
+		color = readVec3(base + 3);
+		normal = readVec3(base + 6);
+		uv = uintBitsToFloat(uvec2(vertexBuffer.vertexWords[base + 9], vertexBuffer.vertexWords[base + 10]));
+	}
+
+	vec4 positionWorld = instance.modelMatrix * vec4(position, 1.0);
 	gl_Position = globUbo.projectionMatrix * globUbo.viewMatrix * positionWorld;
 
 	fragPosWorld = positionWorld.xyz;
 	fragColor = color;
-	fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+	fragNormalWorld = normalize(mat3(instance.normalMatrix) * normal);
 	fragTexCoord = uv;
+	fragTextureId = instance.textureId;
+	fragFlags = instance.flags;
 }
\ No newline at end of file
@@ -1,8 +1,16 @@
 @echo off
+setlocal enabledelayedexpansion
 echo Shaders compilation...
+xcopy .\shaders .\shadersSpirv /t /i /q > nul
+set compilationFailed=0
 for %%G in (.vert, .frag, .comp, .rchit, .rgen, .rmiss, .rahit) do (
 	for /f %%i in ('FORFILES /P shaders\ /S /M *%%G /C "cmd /c echo @relpath"') do (
 		%VULKAN_SDK%\Bin\glslc.exe --target-env=vulkan1.4 .\shaders\%%~i -o .\shadersSpirv\%%~i.spv
+		if errorlevel 1 set compilationFailed=1
 	)
 )
-pause
\ No newline at end of file
+rem The SPIR-V is not versioned, a failed compilation fails the build instead of leaving stale modules behind.
+if !compilationFailed! == 1 (
+	echo Shaders compilation failed!
+	exit /b 1
+)
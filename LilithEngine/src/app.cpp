@@ -3,6 +3,8 @@
 #include "lth_camera.hpp"
 #include "lth_buffer.hpp"
 #include "lth_utils.hpp"
+#include "lth_upload_context.hpp"
+#include "lth_sampler_cache.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -24,14 +26,13 @@ namespace lth {
         viewerTransform{},
         startingTime{ std::chrono::high_resolution_clock::now() }
     {
-        lthShaderCompiler.createDefaultSlangSession();
-
         assert(GLOBALPOOLMAXSETS >= MAX_FRAMES_IN_FLIGHT && "Error: globalPool default size is too small for the swap chain.");
         generalDescriptorPool = LthDescriptorPool::Builder(lthDevice)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, GLOBALPOOLMAXSETS)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, GLOBALPOOLMAXSETS)
             .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, GLOBALPOOLMAXSETS)
             .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, GLOBALPOOLMAXSETS)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_FRAMES_IN_FLIGHT * 3)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_FRAMES_IN_FLIGHT * 3 + 2)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 4)
             .addPoolSize(VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, MAX_FRAMES_IN_FLIGHT)
             .setMaxSets(GLOBALPOOLMAXSETS)
             .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
@@ -87,11 +88,15 @@ namespace lth {
                 }
             }
 
+            // Retried every frame until the previous reload is done.
             if (checkPipelineForUpdates) {
-                lthRenderer.waitForSwapChainWork();
-                systemSet->rayTracingSystem.checkForPipelineUpdates();
-                checkPipelineForUpdates = false;
+                checkPipelineForUpdates = !pipelineReloader.requestReload(systemSet->getPipelines());
             }
+            pipelineReloader.update();
+
+            // Upload batches are submitted without waiting, their staging resources are released here once executed.
+            lthDevice.getUploadContext().collect();
+            scene.updateTextureLoads();
 
             auto newTime = std::chrono::high_resolution_clock::now();
             float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
@@ -129,6 +134,13 @@ namespace lth {
                 VkCommandBuffer computeCommandBuffer = lthRenderer.getCurrentComputeCommandBuffer();
 
                 int frameIndex = lthRenderer.getFrameIndex();
+                // Before the ring buffer gives back the draws of the previous frame with this index.
+                systemSet->renderSystem.readClusterCullingResults(frameIndex);
+                frameRingBuffer.beginFrame(frameIndex);
+
+                // The texture set of this frame is no longer in use, it takes the texture slots changed since.
+                VkDescriptorSet textureDescriptorSet = scene.getTextureTable().updateFrame(frameIndex);
+
                 FrameInfo frameInfo{
                     frameIndex,
                     frameTime,
@@ -136,7 +148,12 @@ namespace lth {
                     computeCommandBuffer,
                     camera,
                     globalDescriptorSets[frameIndex],
-                    scene
+                    0,
+                    instanceDescriptorSet,
+                    0,
+                    textureDescriptorSet,
+                    scene,
+                    frameRingBuffer
                 };
 
                 // Update uniform buffers.
@@ -145,13 +162,9 @@ namespace lth {
                 ubo.viewMatrix = camera.getView();
                 ubo.inverseViewMatrix = camera.getInverseView();
                 systemSet->pointLightSystem.update(frameInfo, ubo);
-                uboBuffers[frameIndex]->writeToBuffer(&ubo);
-                uboBuffers[frameIndex]->flush();
+                frameInfo.globalUboOffset = frameRingBuffer.push(ubo).dynamicOffset();
 
-                for (auto& keyValue : scene.gameObjects()) {
-                    auto& obj = keyValue.second;
-                    obj->updateUBO(frameIndex);
-                }
+                frameInfo.instanceBufferOffset = scene.writeInstanceBuffer(frameRingBuffer, camera, static_cast<float>(lthRenderer.getSwapChainImageExtent().height)).dynamicOffset();
 
                 // Dispatch the compute work.
 
@@ -163,6 +176,10 @@ namespace lth {
                 
                 // Render the scene.
 
+                // Cull the meshlets of the cluster draws before the render pass that draws them.
+
+                systemSet->renderSystem.cullClusters(frameInfo, clusterCullingDescriptorSet);
+
 				lthRenderer.beginSwapChainRenderPass(graphicsCommandBuffer, LTH_RP_MAIN);
                 
                 systemSet->renderSystem.render(frameInfo);
@@ -186,7 +203,7 @@ namespace lth {
                 ImGui_ImplGlfw_NewFrame();
                 ImGui::NewFrame();
 
-                showImGui();
+                showImGui(camera);
 
                 ImGui::Render();
                 ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), graphicsCommandBuffer, nullptr);
@@ -210,9 +227,12 @@ namespace lth {
     }
 
 	void App::loadScene() {
-        
-        auto viking_room_tex = scene.createTextureFromFile("viking_room.png", true);
-        auto circuitry_tex = scene.createTextureFromFile("Circuitry_albedo.bmp", true);
+        // Every model, texture and acceleration structure upload of the scene goes in a single submission.
+        LthUploadContext::Batch uploadBatch{ lthDevice.getUploadContext() };
+
+        // Textures are loaded on the thread pool while the models load, and bound once resident. The opaque ones fit in BC1.
+        auto viking_room_tex = scene.createTextureFromFileAsync("viking_room.png", true, LTH_TEXTURE_COMPRESSION_BC1);
+        auto circuitry_tex = scene.createTextureFromFileAsync("Circuitry_albedo.bmp", true);
 
         std::shared_ptr<LthModel> lthModel = scene.createModelFromFile(MODELSFOLDERPATH("smooth_vase.obj"));
 
@@ -237,7 +257,7 @@ namespace lth {
         floor->transform.setScale({ 3.f, 3.f, 3.f});
         scene.linkGameObjectToModel(floor, lthModel);
         floor->setUsesColorTexture(true);
-        floor->setTexture(circuitry_tex);
+        floor->setTexture(circuitry_tex.descriptorId);
 
         lthModel = scene.createModelFromFile(MODELSFOLDERPATH("viking_room.obj"));
         //std::shared_ptr<LthTexture> lthTexture = LthTexture::createTextureFromFile(lthDevice, TEXTURESFOLDERPATH("viking_room.png"), true);
@@ -246,7 +266,7 @@ namespace lth {
         viking_room->transform.setTranslation({ 0.f, 0.f, 5.f });
         scene.linkGameObjectToModel(viking_room, lthModel);
         viking_room->setUsesColorTexture(true);
-        viking_room->setTexture(viking_room_tex);
+        viking_room->setTexture(viking_room_tex.descriptorId);
 
         //Point lights
         std::vector<glm::vec3> lightColors{
@@ -272,14 +292,37 @@ namespace lth {
         scene.createTLAS();
 	}
 
+    // Instancing benchmark: a grid of game objects cycling through the loaded models, behind the scene.
+    // They are not added to the TLAS.
+    void App::spawnInstances(uint32_t count) {
+        std::vector<id_t> modelIds{};
+        for (auto& keyValue : scene.models()) {
+            modelIds.push_back(keyValue.first);
+        }
+        if (modelIds.empty()) return;
+
+        constexpr uint32_t gridWidth = 100;
+        constexpr float spacing = 0.5f;
+        uint32_t firstIndex = static_cast<uint32_t>(scene.getInstanceArray().size());
+        for (uint32_t i = firstIndex; i < firstIndex + count; ++i) {
+            auto gameObject = scene.createGameObject();
+            gameObject->transform.setTranslation({ (static_cast<float>(i % gridWidth) - gridWidth / 2.f) * spacing, 0.f, 8.f + (i / gridWidth) * spacing });
+            gameObject->transform.setScale({ .2f, .2f, .2f });
+            scene.linkGameObjectToModel(gameObject, modelIds[i % modelIds.size()]);
+        }
+    }
+
     void App::createDescriptorSets() {
         setLayouts.globalSetLayout = LthDescriptorSetLayout::Builder(lthDevice)
-            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL)
-            .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, TEXTUREARRAYSIZE)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL)
             .build();
 
-        setLayouts.gameObjectSetLayout = LthDescriptorSetLayout::Builder(lthDevice)
-            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL)
+        // Update after bind, so it cannot share the set of the dynamic uniform buffer.
+        setLayouts.textureSetLayout = &scene.getTextureTable().getSetLayout();
+
+        setLayouts.instanceSetLayout = LthDescriptorSetLayout::Builder(lthDevice)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
             .build();
 
         setLayouts.computeSetLayout = LthDescriptorSetLayout::Builder(lthDevice)
@@ -293,28 +336,22 @@ namespace lth {
             .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_ALL)
             .build();
 
+        setLayouts.clusterCullingSetLayout = LthDescriptorSetLayout::Builder(lthDevice)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
 
-        // General descriptor sets.
-
-        uboBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < uboBuffers.size(); ++i) {
-            uboBuffers[i] = std::make_unique<LthBuffer>(
-                lthDevice,
-                sizeof(GlobalUBO),
-                1,
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-            uboBuffers[i]->map();
-        }
 
-        auto descriptorImagesInfo = scene.getDescriptorImagesInfos();
+        // General descriptor sets.
+        // Uniforms are written in the frame ring buffer every frame and bound with a dynamic offset.
 
         globalDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
         for (int i = 0; i < globalDescriptorSets.size(); ++i) {
-            VkDescriptorBufferInfo bufferInfo = uboBuffers[i]->descriptorInfo();
+            VkDescriptorBufferInfo bufferInfo = frameRingBuffer.dynamicDescriptorInfo(sizeof(GlobalUBO));
             LthDescriptorWriter(*setLayouts.globalSetLayout, *generalDescriptorPool)
                 .writeBuffer(0, &bufferInfo)
-                .writeImage(1, descriptorImagesInfo.data(), TEXTUREARRAYSIZE)
                 .build(globalDescriptorSets[i]);
         }
 
@@ -352,12 +389,27 @@ namespace lth {
         }
 
 
-        // Game objects descriptor sets.
+        // Instance descriptor set, the InstanceData array of the frame is selected by a dynamic offset.
+        // The vertices of every model are pulled from the geometry pool.
 
-        for (auto& keyValue : scene.gameObjects()) {
-            auto& obj = keyValue.second;
-            obj->createDescriptorSet(lthDevice, setLayouts.gameObjectSetLayout.get(), generalDescriptorPool.get());
-        }
+        VkDescriptorBufferInfo instanceBufferInfo = frameRingBuffer.dynamicDescriptorInfo(INSTANCE_BUFFER_RANGE);
+        VkDescriptorBufferInfo vertexBufferInfo = scene.getGeometryPool().vertexDescriptorInfo();
+        LthDescriptorWriter(*setLayouts.instanceSetLayout, *generalDescriptorPool)
+            .writeBuffer(0, &instanceBufferInfo)
+            .writeBuffer(1, &vertexBufferInfo)
+            .build(instanceDescriptorSet);
+
+        // Cluster culling descriptor set, the jobs, the InstanceData and the draws of the frame are all in the frame ring buffer.
+
+        VkDescriptorBufferInfo clusterJobsBufferInfo = frameRingBuffer.dynamicDescriptorInfo(CLUSTER_JOBS_RANGE);
+        VkDescriptorBufferInfo clusterDrawsBufferInfo = frameRingBuffer.dynamicDescriptorInfo(CLUSTER_DRAWS_RANGE);
+        VkDescriptorBufferInfo meshletBufferInfo = scene.getGeometryPool().meshletDescriptorInfo();
+        LthDescriptorWriter(*setLayouts.clusterCullingSetLayout, *generalDescriptorPool)
+            .writeBuffer(0, &clusterJobsBufferInfo)
+            .writeBuffer(1, &instanceBufferInfo)
+            .writeBuffer(2, &clusterDrawsBufferInfo)
+            .writeBuffer(3, &meshletBufferInfo)
+            .build(clusterCullingDescriptorSet);
     }
 
     void App::initImGui() {
@@ -385,19 +437,142 @@ namespace lth {
         ImGui_ImplVulkan_DestroyFontsTexture();
     }
 
-    void App::showImGui() {
+    void App::showImGui(const LthCamera& camera) {
         ImGui::Begin("Frame manager");
 
         if (ImGui::Button("Update shaders")) {
             checkPipelineForUpdates = true;
         }
+        if (pipelineReloader.isReloading()) {
+            ImGui::SameLine();
+            ImGui::Text("Reloading...");
+        }
 
         ImGui::Checkbox("Update scene", &activateUpdate);
         ImGui::Checkbox("Compute particle system", &systemSet->particleSystem.activateCompute);
-        
+
+        if (ImGui::TreeNode("Memory heaps")) {
+            auto heapStats = lthDevice.getMemoryAllocator().getHeapStats();
+            for (size_t i = 0; i < heapStats.size(); i++) {
+                const auto& stats = heapStats[i];
+                ImGui::Text("Heap %zu: %.1f / %.1f MB used (%.1f MB heap), %u blocks, %u allocations",
+                    i, stats.usedBytes / 1048576.0, stats.reservedBytes / 1048576.0, stats.heapSize / 1048576.0,
+                    stats.blockCount, stats.allocationCount);
+            }
+            ImGui::Text("Frame ring buffer: %.1f / %.1f KB used", frameRingBuffer.getUsedSize() / 1024.0, frameRingBuffer.getSize() / 1024.0);
+            LthGeometryPool& geometryPool = scene.getGeometryPool();
+            ImGui::Text("Geometry pool: vertices %.1f / %.1f MB, indices %.1f / %.1f MB",
+                geometryPool.getUsedVertexBytes() / 1048576.0, geometryPool.getVertexBufferSize() / 1048576.0,
+                geometryPool.getUsedIndexBytes() / 1048576.0, geometryPool.getIndexBufferSize() / 1048576.0);
+            ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Instancing benchmark")) {
+            if (ImGui::Button("Spawn 10k instances")) {
+                spawnInstances(10000);
+            }
+            ImGui::Text("%zu instances, %u visible in %zu draws", scene.getInstanceArray().size(), scene.getVisibleInstanceCount(), scene.getInstanceDraws().size());
+            ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Frustum culling")) {
+            ImGui::Checkbox("Cull instances", &scene.enableFrustumCulling);
+            if (ImGui::Button("Benchmark culling")) {
+                cullingBenchmark = LthFrustumCuller::benchmark(camera.getFrustumPlanes());
+            }
+            if (cullingBenchmark.sphereCount > 0) {
+                ImGui::Text("%u spheres, %u visible", cullingBenchmark.sphereCount, cullingBenchmark.visibleCount);
+                ImGui::Text("SSE: %.0f instances/ms, scalar: %.0f instances/ms (one core)", cullingBenchmark.simdSpheresPerMs, cullingBenchmark.scalarSpheresPerMs);
+            }
+            ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Mesh optimization")) {
+            uint32_t unoptimizedModelCount = 0;
+            for (auto& kv : scene.models()) {
+                const LthMeshOptimizer::Report* report = kv.second->getOptimizationReport();
+                if (report == nullptr) {
+                    ++unoptimizedModelCount;
+                    continue;
+                }
+                ImGui::Text("Model %u: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overfetch %.3f -> %.3f (%.1f ms)", kv.first,
+                    report->before.acmr, report->after.acmr, report->before.atvr, report->after.atvr,
+                    report->before.overfetch, report->after.overfetch, report->milliseconds);
+            }
+            ImGui::Text("%u models loaded from the mesh cache or not optimized", unoptimizedModelCount);
+            ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Levels of detail")) {
+            ImGui::Checkbox("Select LODs", &scene.enableLodSelection);
+            ImGui::SliderFloat("Pixel error", &scene.lodPixelError, 0.25f, 16.f, "%.2f", ImGuiSliderFlags_Logarithmic);
+            std::vector<uint32_t> lodInstanceCounts{};
+            for (auto& draw : scene.getInstanceDraws()) {
+                lodInstanceCounts.resize(std::max<size_t>(lodInstanceCounts.size(), draw.lod + 1), 0);
+                lodInstanceCounts[draw.lod] += draw.instanceCount;
+            }
+            for (size_t lod = 0; lod < lodInstanceCounts.size(); ++lod) {
+                ImGui::Text("LOD %zu: %u instances", lod, lodInstanceCounts[lod]);
+            }
+            ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Cluster culling")) {
+            ImGui::Checkbox("Cull clusters", &scene.enableClusterCulling);
+            ImGui::Checkbox("Normal cone culling", &systemSet->renderSystem.enableConeCulling);
+            uint32_t clusterInstanceCount = 0;
+            for (auto& draw : scene.getClusterDraws()) {
+                clusterInstanceCount += draw.instanceCount;
+            }
+            ImGui::Text("%u instances drawn by meshlet", clusterInstanceCount);
+            ImGui::Text("Visible meshlets: %u / %u", systemSet->renderSystem.getVisibleMeshletCount(), systemSet->renderSystem.getClusterMeshletCount());
+            ImGui::Text("Draw count: %s", lthDevice.supportsDrawIndirectCount() ? "yes" : "no, culled meshlets are empty draws");
+            LthGeometryPool& geometryPool = scene.getGeometryPool();
+            ImGui::Text("Meshlets: %u / %u", geometryPool.getUsedMeshletCount(), geometryPool.getMeshletCapacity());
+            ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Texture streaming")) {
+            ImGui::Checkbox("Stream the next textures", &scene.enableTextureStreaming);
+            int frameBudget = static_cast<int>(scene.textureStreamingFrameBudget >> 10);
+            if (ImGui::SliderInt("Frame budget (KB)", &frameBudget, 64, 65536, "%d", ImGuiSliderFlags_Logarithmic)) {
+                scene.textureStreamingFrameBudget = static_cast<VkDeviceSize>(frameBudget) << 10;
+            }
+            int memoryBudget = static_cast<int>(scene.textureStreamingMemoryBudget >> 20);
+            if (ImGui::SliderInt("Memory budget (MB)", &memoryBudget, 1, 4096, "%d", ImGuiSliderFlags_Logarithmic)) {
+                scene.textureStreamingMemoryBudget = static_cast<VkDeviceSize>(memoryBudget) << 20;
+            }
+            ImGui::Text("%u streamed textures, %.1f MB resident", scene.getStreamedTextureCount(), scene.getStreamedTextureMemory() / 1048576.0);
+            ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Texture table")) {
+            LthTextureTable& textureTable = scene.getTextureTable();
+            ImGui::Text("%u / %u slots used (device limit %u)", textureTable.getUsedSlotCount(), textureTable.getCapacity(), textureTable.getMaxCapacity());
+            ImGui::Text("%u descriptors written this frame", textureTable.getLastWriteCount());
+            ImGui::Text("%u samplers in the device cache", lthDevice.getSamplerCache().getSamplerCount());
+            ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("OBJ loading")) {
+            if (ImGui::Button("Benchmark OBJ loading")) {
+                objLoadingBenchmarks.clear();
+                for (const char* modelFile : { "colored_cube.obj", "flat_vase.obj", "smooth_vase.obj", "viking_room.obj" }) {
+                    objLoadingBenchmarks.push_back(LthObjLoader::benchmark(MODELSFOLDERPATH(modelFile), lthDevice.getThreadPool()));
+                }
+            }
+            for (const auto& benchmark : objLoadingBenchmarks) {
+                ImGui::Text("%s: %u vertices, %u indices", benchmark.filePath.c_str(), benchmark.vertexCount, benchmark.indexCount);
+                ImGui::Text("    tinyobj: %.2f ms, parallel: %.2f ms (%u threads)%s", benchmark.referenceMs, benchmark.parallelMs,
+                    lthDevice.getThreadPool().getThreadCount() + 1, benchmark.identical ? "" : ", OUTPUT MISMATCH");
+            }
+            ImGui::TreePop();
+        }
+
         ImGui::BeginChild("Systems");
         ImGui::Text("Systems");
         ImGui::Checkbox("Render main system", &systemSet->renderSystem.activateRender);
+        ImGui::Checkbox("Indirect draws", &systemSet->renderSystem.useIndirectDraws);
         ImGui::Checkbox("Render point light system", &systemSet->pointLightSystem.activateRender);
         ImGui::Checkbox("Render particle system", &systemSet->particleSystem.activateRender);
         ImGui::Checkbox("Ray tracing system", &systemSet->rayTracingSystem.activateTrace);
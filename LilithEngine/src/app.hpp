@@ -8,8 +8,12 @@
 #include "lth_descriptors.hpp"
 #include "lth_texture.hpp"
 #include "lth_scene.hpp"
+#include "lth_frustum_culler.hpp"
+#include "lth_obj_loader.hpp"
+#include "lth_ring_buffer.hpp"
 #include "lth_shader_compiler.hpp"
 #include "systems/lth_system_set.hpp"
+#include "pipelines/lth_pipeline_reloader.hpp"
 #include "keyboard_movement_control.hpp"
 #include "gameObjects/lth_game_object.hpp"
 
@@ -34,9 +38,10 @@ namespace lth {
 	private:
 
 		void loadScene();
+		void spawnInstances(uint32_t count);
 		void createDescriptorSets();
 		void initImGui();
-		void showImGui();
+		void showImGui(const LthCamera& camera);
 
 		void update(float dt);
 
@@ -45,12 +50,15 @@ namespace lth {
 		LthRenderer lthRenderer{ lthWindow, lthDevice };
 		LthShaderCompiler lthShaderCompiler{ lthDevice };
 		std::unique_ptr<LthSystemSet> systemSet{};
+		LthPipelineReloader pipelineReloader{ lthDevice.getThreadPool(), lthShaderCompiler }; // After the systems, whose pipelines it reloads.
 
 		std::unique_ptr<LthDescriptorPool> generalDescriptorPool{};
 		DescriptorSetLayouts setLayouts{};
-		std::vector<std::unique_ptr<LthBuffer>> uboBuffers{};
+		LthRingBuffer frameRingBuffer{ lthDevice, FRAMERINGBUFFERSIZE };
 		std::vector<std::unique_ptr<LthBuffer>> cboBuffers{};
 		std::vector<VkDescriptorSet> globalDescriptorSets{};
+		VkDescriptorSet instanceDescriptorSet{};
+		VkDescriptorSet clusterCullingDescriptorSet{};
 		std::vector<VkDescriptorSet> computeDescriptorSets{};
 		std::vector<VkDescriptorSet> rayTracingDescriptorSets{};
 
@@ -67,6 +75,8 @@ namespace lth {
 
 		bool activateUpdate = true;
 		bool checkPipelineForUpdates = false;
+		LthFrustumCuller::BenchmarkResult cullingBenchmark{};
+		std::vector<LthObjLoader::BenchmarkResult> objLoadingBenchmarks{};
 	};
 }
 
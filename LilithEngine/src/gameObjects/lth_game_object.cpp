@@ -18,36 +18,16 @@ namespace lth {
 		return gameObj;
 	}
 
-	void LthGameObject::createDescriptorSet(LthDevice &lthDevice,
-        LthDescriptorSetLayout* gameObjectSetLayout,
-        LthDescriptorPool* generalDescriptorPool) {
-        gameObjectUboBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < gameObjectUboBuffers.size(); ++i) {
-            gameObjectUboBuffers[i] = std::make_unique<LthBuffer>(
-                lthDevice,
-                sizeof(GameObjectUBO),
-                1,
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-            gameObjectUboBuffers[i]->map();
-        }
-
-        gameObjectDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < gameObjectDescriptorSets.size(); ++i) {
-            VkDescriptorBufferInfo bufferInfo = gameObjectUboBuffers[i]->descriptorInfo();
-            LthDescriptorWriter(*gameObjectSetLayout, *generalDescriptorPool)
-                .writeBuffer(0, &bufferInfo)
-                .build(gameObjectDescriptorSets[i]);
-        }
-	}
-
-    void LthGameObject::updateUBO(int frameIndex) {
-        
-        //
-        // No update for now.
-        //
+    InstanceData LthGameObject::instanceData() {
+        return instanceData(transform.modelMatrix());
+    }
 
-        gameObjectUboBuffers[frameIndex]->writeToBuffer(&ubo);
-        gameObjectUboBuffers[frameIndex]->flush();
+    InstanceData LthGameObject::instanceData(const glm::mat4& modelMatrix) {
+        InstanceData data{};
+        data.modelMatrix = modelMatrix;
+        data.normalMatrix = transform.normalMatrix();
+        data.textureId = textureId;
+        data.flags = flags;
+        return data;
     }
 }
\ No newline at end of file
@@ -12,9 +12,18 @@
 
 namespace lth {
 
-	struct GameObjectUBO {
-		uint32_t usesColorTexture = 0;
+	enum LthInstanceFlags : uint32_t {
+		LTH_INSTANCE_FLAG_USES_COLOR_TEXTURE = 1u << 0,
+	};
+
+	// Per-instance record of the instance storage buffer, read by the shaders with gl_InstanceIndex (std430 layout).
+	struct InstanceData {
+		glm::mat4 modelMatrix{ 1.f };
+		glm::mat4 normalMatrix{ 1.f };
 		uint32_t textureId = 0;
+		uint32_t flags = 0;
+		uint32_t vertexOffset = 0; // First 32 bits word of the model vertices in the geometry pool, set by the scene.
+		uint32_t vertexFormat = 0; // LthVertexFormat of the model, set by the scene.
 	};
 	
 	struct PointLightComponent {
@@ -37,28 +46,29 @@ namespace lth {
 		LthGameObject(LthGameObject&&) = default;
 		LthGameObject &operator=(LthGameObject&&) = default;
 		
-		void setUsesColorTexture(bool usesColorTexture) { ubo.usesColorTexture = static_cast<uint32_t>(usesColorTexture); }
-		void setTexture(const std::shared_ptr<LthTexture> texture) { ubo.textureId = texture->getDescriptorId(); }
-		void setTexture(uint32_t textureId) { ubo.textureId = textureId; }
+		void setUsesColorTexture(bool usesColorTexture) {
+			flags = usesColorTexture ? (flags | LTH_INSTANCE_FLAG_USES_COLOR_TEXTURE) : (flags & ~LTH_INSTANCE_FLAG_USES_COLOR_TEXTURE);
+		}
+		void setTexture(const std::shared_ptr<LthTexture> texture) { textureId = texture->getDescriptorId(); }
+		void setTexture(uint32_t textureId) { this->textureId = textureId; }
 		uint32_t getModelId() const { return modelId; }
 
-		void createDescriptorSet(LthDevice &lthDevice,
-			LthDescriptorSetLayout* gameObjectSetLayout,
-			LthDescriptorPool* generalDescriptorPool);
-		void updateUBO(int frameIndex);
+		InstanceData instanceData();
+		InstanceData instanceData(const glm::mat4& modelMatrix); // When the model matrix has already been computed.
+		uint32_t getInstanceIndex() const { return instanceIndex; } // Index of the object in this frame's instance buffer.
 
 		glm::vec3 color{};
 		Transform transform{};
 
-		std::vector<VkDescriptorSet> gameObjectDescriptorSets{};
-		std::vector<std::unique_ptr<LthBuffer>> gameObjectUboBuffers{};
 		std::unique_ptr<PointLightComponent> pointLight = nullptr;
 
 	private:
 
 		//Id set to 0 if no model
 		uint32_t modelId = 0;
-		GameObjectUBO ubo{};
+		uint32_t textureId = 0;
+		uint32_t flags = 0;
+		uint32_t instanceIndex = 0;
 		void setModel(uint32_t modId) { modelId = modId; }
 
 		friend class LthScene;
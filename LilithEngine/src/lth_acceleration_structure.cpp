@@ -1,4 +1,5 @@
 #include "lth_acceleration_structure.hpp"
+#include "lth_upload_context.hpp"
 
 namespace lth {
 
@@ -30,19 +31,23 @@ namespace lth {
 
 		uint32_t scratchOffsetAlignment = device.accelStructProperties.minAccelerationStructureScratchOffsetAlignment;
 
-		LthBuffer scratchBuffer{
+		// The build is recorded in the current upload batch (or a batch of its own), the scratch buffer lives until it is executed.
+		LthUploadContext& uploadContext = device.getUploadContext();
+		LthUploadContext::Batch uploadBatch{ uploadContext };
+
+		auto scratchBuffer = std::make_unique<LthBuffer>(
 			device,
 			asBuildSizesInfo.buildScratchSize,
 			1,
 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			scratchOffsetAlignment
-		};
+		);
 
 		VkBufferDeviceAddressInfo scratchBufferDeviceAddressInfo{
 			.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
 			.pNext = nullptr,
-			.buffer = scratchBuffer.getBuffer(),
+			.buffer = scratchBuffer->getBuffer(),
 		};
 
 		auto scratchBufferDeviceAddress = vkGetBufferDeviceAddress(device.getDevice(), &scratchBufferDeviceAddressInfo);
@@ -65,7 +70,8 @@ namespace lth {
 		asBuildGeometryInfo.dstAccelerationStructure = accStruct.handle;
 		asBuildGeometryInfo.scratchData.deviceAddress = scratchBufferDeviceAddress;
 
-		device.buildAccelerationStructure(asBuildGeometryInfo, asBuildRangeInfo);
+		uploadContext.buildAccelerationStructure(asBuildGeometryInfo, asBuildRangeInfo);
+		uploadContext.keepAlive(std::move(scratchBuffer));
 
 		VkAccelerationStructureDeviceAddressInfoKHR asDeviceAddressInfo{};
 		asDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
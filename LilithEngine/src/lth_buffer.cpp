@@ -35,26 +35,31 @@ namespace lth {
         uint32_t instanceCount,
         VkBufferUsageFlags usageFlags,
         VkMemoryPropertyFlags memoryPropertyFlags,
-        VkDeviceSize minOffsetAlignment)
+        VkDeviceSize minOffsetAlignment,
+        bool sharedWithTransferQueue)
         : lthDevice{ device },
         instanceSize{ instanceSize },
         instanceCount{ instanceCount },
         usageFlags{ usageFlags },
-        memoryPropertyFlags{ memoryPropertyFlags } {
+        memoryPropertyFlags{ memoryPropertyFlags },
+        sharedWithTransferQueue{ sharedWithTransferQueue } {
         alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
         bufferSize = alignmentSize * instanceCount;
-        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation, minOffsetAlignment, sharedWithTransferQueue);
     }
 
     LthBuffer::~LthBuffer() {
         unmap();
         vkDestroyBuffer(lthDevice.getDevice(), buffer, nullptr);
-        vkFreeMemory(lthDevice.getDevice(), memory, nullptr);
+        lthDevice.freeMemory(allocation);
     }
 
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
      *
+     * @note Host visible memory blocks are persistently mapped by the allocator, this only exposes the pointer to the
+     * range, which must fit in the buffer.
+     *
      * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
      * buffer range.
      * @param offset (Optional) Byte offset from beginning
@@ -62,27 +67,31 @@ namespace lth {
      * @return VkResult of the buffer mapping call
      */
     VkResult LthBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(lthDevice.getDevice(), memory, offset, size, 0, &mapped);
+        assert(buffer && allocation.isValid() && "Called map on buffer before create");
+        assert(offset <= bufferSize && (size == VK_WHOLE_SIZE || size <= bufferSize - offset) && "Mapped range out of the buffer");
+        if (!allocation.mapped) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        mapped = static_cast<char*>(allocation.mapped) + offset;
+        mappedSize = size == VK_WHOLE_SIZE ? bufferSize - offset : size;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The memory block stays mapped until the allocator releases it
      */
     void LthBuffer::unmap() {
-        if (mapped) {
-            vkUnmapMemory(lthDevice.getDevice(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
+        mappedSize = 0;
     }
 
     /**
-     * Copies the specified data to the mapped buffer. Default value writes whole buffer range
+     * Copies the specified data to the mapped buffer. Default value writes whole mapped range
      *
      * @param data Pointer to the data to copy
-     * @param size (Optional) Size of the data to copy. Pass VK_WHOLE_SIZE to flush the complete buffer
+     * @param size (Optional) Size of the data to copy. Pass VK_WHOLE_SIZE to write the complete mapped
      * range.
      * @param offset (Optional) Byte offset from beginning of mapped region
      *
@@ -91,9 +100,10 @@ namespace lth {
         assert(mapped && "Cannot copy to unmapped buffer");
 
         if (size == VK_WHOLE_SIZE) {
-            memcpy(mapped, data, bufferSize);
+            memcpy(mapped, data, mappedSize);
         }
         else {
+            assert(offset <= mappedSize && size <= mappedSize - offset && "Write out of the mapped range");
             char* memOffset = (char*)mapped;
             memOffset += offset;
             memcpy(memOffset, data, size);
@@ -112,12 +122,7 @@ namespace lth {
      * @return VkResult of the flush call
      */
     VkResult LthBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkFlushMappedMemoryRanges(lthDevice.getDevice(), 1, &mappedRange);
+        return lthDevice.getMemoryAllocator().flush(allocation, size, offset);
     }
 
     /**
@@ -132,12 +137,7 @@ namespace lth {
      * @return VkResult of the invalidate call
      */
     VkResult LthBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(lthDevice.getDevice(), 1, &mappedRange);
+        return lthDevice.getMemoryAllocator().invalidate(allocation, size, offset);
     }
 
     /**
@@ -13,7 +13,8 @@ namespace lth {
             uint32_t instanceCount,
             VkBufferUsageFlags usageFlags,
             VkMemoryPropertyFlags memoryPropertyFlags,
-            VkDeviceSize minOffsetAlignment = 1);
+            VkDeviceSize minOffsetAlignment = 1,
+            bool sharedWithTransferQueue = false);
         ~LthBuffer();
 
         LthBuffer(const LthBuffer&) = delete;
@@ -39,6 +40,7 @@ namespace lth {
         VkDeviceSize getAlignmentSize() const { return instanceSize; }
         VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
         VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
+        bool isSharedWithTransferQueue() const { return sharedWithTransferQueue; }
         VkDeviceSize getBufferSize() const { return bufferSize; }
 
         static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
@@ -46,8 +48,9 @@ namespace lth {
 
         LthDevice& lthDevice;
         void* mapped = nullptr;
+        VkDeviceSize mappedSize = 0;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        LthAllocation allocation{};
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
@@ -55,6 +58,7 @@ namespace lth {
         VkDeviceSize alignmentSize;
         VkBufferUsageFlags usageFlags;
         VkMemoryPropertyFlags memoryPropertyFlags;
+        bool sharedWithTransferQueue;
     };
 
 }
@@ -130,4 +130,19 @@ namespace lth {
 		inverseViewMatrix[3][1] = position.y;
 		inverseViewMatrix[3][2] = position.z;
 	}
+
+	LthFrustumPlanes LthCamera::getFrustumPlanes() const {
+		// Gribb-Hartmann extraction from the rows of the view projection matrix, with a [0, 1] clip depth.
+		const glm::mat4 viewProjection = projectionMatrix * viewMatrix;
+		const glm::vec4 row0{ viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0] };
+		const glm::vec4 row1{ viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1] };
+		const glm::vec4 row2{ viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2] };
+		const glm::vec4 row3{ viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3] };
+
+		LthFrustumPlanes planes{ row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2 };
+		for (glm::vec4& plane : planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return planes;
+	}
 }
\ No newline at end of file
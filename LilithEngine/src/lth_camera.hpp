@@ -6,8 +6,12 @@
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
+#include <array>
+
 namespace lth {
 
+	using LthFrustumPlanes = std::array<glm::vec4, 6>; // Normalized planes pointing inside: dot(plane.xyz, p) + plane.w >= 0.
+
 	class LthCamera {
 	public:
 		void setOrthographicProjection(float left, float right, float top, float bottom, float near, float far);
@@ -22,6 +26,8 @@ namespace lth {
 		const glm::mat4 getView() const { return viewMatrix; }
 		const glm::mat4 getInverseView() const { return inverseViewMatrix; }
 		const glm::vec3 getPosition() const { return glm::vec3(inverseViewMatrix[3]); }
+		// World space left, right, bottom, top, near and far planes of the current projection and view.
+		LthFrustumPlanes getFrustumPlanes() const;
 
 	private:
 		glm::mat4 projectionMatrix{ 1.f };
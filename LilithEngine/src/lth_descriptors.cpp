@@ -12,7 +12,8 @@ namespace lth {
         uint32_t binding,
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
-        uint32_t count) {
+        uint32_t count,
+        VkDescriptorBindingFlags bindingFlags) {
         assert(bindings.count(binding) == 0 && "Binding already in use");
         VkDescriptorSetLayoutBinding layoutBinding{};
         layoutBinding.binding = binding;
@@ -21,27 +22,69 @@ namespace lth {
         layoutBinding.pImmutableSamplers = nullptr;
         layoutBinding.stageFlags = stageFlags;
         bindings[binding] = layoutBinding;
+        if (bindingFlags != 0) {
+            this->bindingFlags[binding] = bindingFlags;
+        }
+        return *this;
+    }
+
+    LthDescriptorSetLayout::Builder& LthDescriptorSetLayout::Builder::addImmutableSamplerBinding(
+        uint32_t binding,
+        VkDescriptorType descriptorType,
+        VkShaderStageFlags stageFlags,
+        VkSampler sampler,
+        uint32_t count,
+        VkDescriptorBindingFlags bindingFlags) {
+        assert((descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER || descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+            && "Immutable samplers need a sampler descriptor type");
+        addBinding(binding, descriptorType, stageFlags, count, bindingFlags);
+        immutableSamplers[binding] = std::vector<VkSampler>(count, sampler);
         return *this;
     }
 
     std::unique_ptr<LthDescriptorSetLayout> LthDescriptorSetLayout::Builder::build() const {
-        return std::make_unique<LthDescriptorSetLayout>(lthDevice, bindings);
+        return std::make_unique<LthDescriptorSetLayout>(lthDevice, bindings, bindingFlags, immutableSamplers);
     }
 
     // *************** Descriptor Set Layout *********************
 
     LthDescriptorSetLayout::LthDescriptorSetLayout(
-        LthDevice& lthDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+        LthDevice& lthDevice,
+        std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags,
+        const std::unordered_map<uint32_t, std::vector<VkSampler>>& immutableSamplers)
         : lthDevice{ lthDevice }, bindings{ bindings } {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
+        bool updateAfterBind = false;
         for (auto& kv : bindings) {
             setLayoutBindings.push_back(kv.second);
+            // Only needed by the layout creation, the bindings kept for the writer do not point to them.
+            auto samplers = immutableSamplers.find(kv.first);
+            if (samplers != immutableSamplers.end()) {
+                setLayoutBindings.back().pImmutableSamplers = samplers->second.data();
+            }
+            auto flags = bindingFlags.find(kv.first);
+            setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+            updateAfterBind = updateAfterBind || (setLayoutBindingFlags.back() & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT);
         }
 
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
         descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
+        if (!bindingFlags.empty()) {
+            descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+        }
+        // Update after bind bindings can only be allocated from update after bind pools.
+        if (updateAfterBind) {
+            descriptorSetLayoutInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        }
 
         if (vkCreateDescriptorSetLayout(
             lthDevice.getDevice(),
@@ -122,6 +165,23 @@ namespace lth {
         return true;
     }
 
+    bool LthDescriptorPool::allocateVariableDescriptorSet(
+        const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor, uint32_t variableDescriptorCount) const {
+        VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{};
+        variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+        variableCountInfo.descriptorSetCount = 1;
+        variableCountInfo.pDescriptorCounts = &variableDescriptorCount;
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.pNext = &variableCountInfo;
+        allocInfo.descriptorPool = descriptorPool;
+        allocInfo.pSetLayouts = &descriptorSetLayout;
+        allocInfo.descriptorSetCount = 1;
+
+        return vkAllocateDescriptorSets(lthDevice.getDevice(), &allocInfo, &descriptor) == VK_SUCCESS;
+    }
+
     void LthDescriptorPool::freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const {
         vkFreeDescriptorSets(
             lthDevice.getDevice(),
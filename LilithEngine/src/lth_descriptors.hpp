@@ -14,9 +14,11 @@ namespace lth {
 
     struct DescriptorSetLayouts {
         std::unique_ptr<LthDescriptorSetLayout> globalSetLayout{};
-        std::unique_ptr<LthDescriptorSetLayout> gameObjectSetLayout{};
+        std::unique_ptr<LthDescriptorSetLayout> instanceSetLayout{};
         std::unique_ptr<LthDescriptorSetLayout> computeSetLayout{};
         std::unique_ptr<LthDescriptorSetLayout> rayTracingSetLayout{};
+        std::unique_ptr<LthDescriptorSetLayout> clusterCullingSetLayout{};
+        const LthDescriptorSetLayout* textureSetLayout = nullptr; // Owned by the texture table of the scene.
     };
 
     class LthDescriptorSetLayout {
@@ -29,16 +31,32 @@ namespace lth {
                 uint32_t binding,
                 VkDescriptorType descriptorType,
                 VkShaderStageFlags stageFlags,
-                uint32_t count = 1);
+                uint32_t count = 1,
+                VkDescriptorBindingFlags bindingFlags = 0); // Descriptor indexing, a variable count binding must be the last one.
+            // SAMPLER or COMBINED_IMAGE_SAMPLER binding whose descriptors all use sampler, baked in the layout: the
+            // writes of the binding only set the image views. The sampler must outlive the layout, as the ones of the
+            // device sampler cache do.
+            Builder& addImmutableSamplerBinding(
+                uint32_t binding,
+                VkDescriptorType descriptorType,
+                VkShaderStageFlags stageFlags,
+                VkSampler sampler,
+                uint32_t count = 1,
+                VkDescriptorBindingFlags bindingFlags = 0);
             std::unique_ptr<LthDescriptorSetLayout> build() const;
 
         private:
             LthDevice& lthDevice;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
+            std::unordered_map<uint32_t, std::vector<VkSampler>> immutableSamplers{};
         };
 
         LthDescriptorSetLayout(
-            LthDevice& lthDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+            LthDevice& lthDevice,
+            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {},
+            const std::unordered_map<uint32_t, std::vector<VkSampler>>& immutableSamplers = {});
         ~LthDescriptorSetLayout();
         LthDescriptorSetLayout(const LthDescriptorSetLayout&) = delete;
         LthDescriptorSetLayout& operator=(const LthDescriptorSetLayout&) = delete;
@@ -82,6 +100,9 @@ namespace lth {
 
         bool allocateDescriptorSets(
             const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor, uint32_t count) const;
+        // For a layout ending with a variable count binding, allocated with variableDescriptorCount descriptors.
+        bool allocateVariableDescriptorSet(
+            const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor, uint32_t variableDescriptorCount) const;
 
         void freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const;
         VkDescriptorPool getDescriptorPool() { return descriptorPool; }
@@ -1,8 +1,16 @@
 #include "lth_device.hpp"
 #include "lth_compile_options.hpp"
+#include "lth_upload_context.hpp"
+#include "lth_thread_pool.hpp"
+#include "lth_sampler_cache.hpp"
+#include "lth_global_info.hpp"
+#include "lth_utils.hpp"
 
 // std headers
+#include <chrono>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -77,6 +85,7 @@ namespace lth {
 
     // class member functions
     LthDevice::LthDevice(LthWindow &window) : window{window} {
+        accelStructProperties.pNext = &physicalDeviceProperties1_2;
         rayTracingProperties.pNext = &accelStructProperties;
         physicalDeviceProperties.pNext = &rayTracingProperties;
 
@@ -87,6 +96,12 @@ namespace lth {
         physicalDeviceFeatures1_3.shaderDemoteToHelperInvocation = VK_TRUE;
         physicalDeviceFeatures1_2.pNext = &physicalDeviceFeatures1_3;
         physicalDeviceFeatures1_2.bufferDeviceAddress = VK_TRUE;
+        // Bindless texture table, see LthTextureTable.
+        physicalDeviceFeatures1_2.runtimeDescriptorArray = VK_TRUE;
+        physicalDeviceFeatures1_2.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        physicalDeviceFeatures1_2.descriptorBindingPartiallyBound = VK_TRUE;
+        physicalDeviceFeatures1_2.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        physicalDeviceFeatures1_2.descriptorBindingVariableDescriptorCount = VK_TRUE;
         physicalDeviceFeatures2.pNext = &physicalDeviceFeatures1_2;
         physicalDeviceFeatures2.features.samplerAnisotropy = VK_TRUE;
         physicalDeviceFeatures2.features.sampleRateShading = VK_TRUE;
@@ -106,9 +121,20 @@ namespace lth {
       pickPhysicalDevice();
       createLogicalDevice();
       createCommandPool();
+      createMemoryAllocator();
+      createUploadContext();
+      createPipelineCache();
+      threadPool = std::make_unique<LthThreadPool>();
+      samplerCache = std::make_unique<LthSamplerCache>(device);
     }
 
     LthDevice::~LthDevice() {
+      samplerCache.reset();
+      threadPool.reset();
+      uploadContext.reset();
+      savePipelineCache();
+      vkDestroyPipelineCache(device, pipelineCache, nullptr);
+      memoryAllocator.reset();
       vkDestroyCommandPool(device, commandPool, nullptr);
       vkDestroyDevice(device, nullptr);
 
@@ -196,15 +222,21 @@ namespace lth {
       // Section to print GPU properties. 
 
       std::cout << "Physical device: " << physicalDeviceProperties.properties.deviceName << std::endl;
+      queueFamilyIndices = findQueueFamilies(physicalDevice);
+      if (queueFamilyIndices.hasDedicatedTransferFamily()) {
+        std::cout << "Dedicated transfer queue family: " << queueFamilyIndices.transferFamily << std::endl;
+      } else {
+        std::cout << "No dedicated transfer queue family, uploads run on the graphics queue." << std::endl;
+      }
       
       //msaaSamples = getMaxUsableSampleCount();
     }
 
     void LthDevice::createLogicalDevice() {
-      QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+      const QueueFamilyIndices& indices = queueFamilyIndices;
 
       std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-      std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsAndComputeFamily, indices.presentFamily};
+      std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsAndComputeFamily, indices.presentFamily, indices.transferFamily};
 
       float queuePriority = 1.0f;
       for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -216,6 +248,13 @@ namespace lth {
         queueCreateInfos.push_back(queueCreateInfo);
       }
 
+      // Optional features, enabled only when the picked device supports them.
+      vkGetPhysicalDeviceFeatures2(physicalDevice, &physicalDeviceFeatures2_Get);
+      physicalDeviceFeatures2.features.multiDrawIndirect = physicalDeviceFeatures2_Get.features.multiDrawIndirect;
+      physicalDeviceFeatures2.features.drawIndirectFirstInstance = physicalDeviceFeatures2_Get.features.drawIndirectFirstInstance;
+      physicalDeviceFeatures1_2.drawIndirectCount = physicalDeviceFeatures1_2_Get.drawIndirectCount;
+      physicalDeviceFeatures2.features.textureCompressionBC = physicalDeviceFeatures2_Get.features.textureCompressionBC;
+
       VkDeviceCreateInfo createInfo{};
       createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
@@ -245,11 +284,10 @@ namespace lth {
       vkGetDeviceQueue(device, indices.graphicsAndComputeFamily, 0, &graphicsQueue);
       vkGetDeviceQueue(device, indices.presentFamily, 0, &presentQueue);
       vkGetDeviceQueue(device, indices.graphicsAndComputeFamily, 0, &computeQueue);
+      vkGetDeviceQueue(device, indices.transferFamily, 0, &transferQueue);
     }
 
     void LthDevice::createCommandPool() {
-      QueueFamilyIndices queueFamilyIndices = findPhysicalQueueFamilies();
-
       VkCommandPoolCreateInfo poolInfo = {};
       poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
       poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsAndComputeFamily;
@@ -261,6 +299,108 @@ namespace lth {
       }
     }
 
+    void LthDevice::createMemoryAllocator() {
+      memoryAllocator = std::make_unique<LthMemoryAllocator>(physicalDevice, device);
+    }
+
+    void LthDevice::createUploadContext() {
+      uploadContext = std::make_unique<LthUploadContext>(*this);
+    }
+
+    // Written before the data returned by vkGetPipelineCacheData, which drivers do not always check: a truncated or
+    // corrupted file, or one written by another driver version, is discarded instead of being handed to the driver.
+    struct PipelineCacheFileHeader {
+      uint32_t magic;
+      uint32_t driverVersion;
+      uint64_t dataSize;
+      uint64_t dataHash; // fnv1a of the data.
+    };
+    static constexpr uint32_t PIPELINECACHEFILEMAGIC = 0x5043544c; // "LTCP"
+
+    void LthDevice::createPipelineCache() {
+      auto start = std::chrono::high_resolution_clock::now();
+      const VkPhysicalDeviceProperties& properties = physicalDeviceProperties.properties;
+      std::vector<char> data;
+      std::ifstream file(CACHEFOLDERPATH(PIPELINECACHEFILE), std::ios::binary);
+      PipelineCacheFileHeader fileHeader{};
+      if (file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader))
+          && fileHeader.magic == PIPELINECACHEFILEMAGIC && fileHeader.driverVersion == properties.driverVersion
+          && fileHeader.dataSize >= sizeof(VkPipelineCacheHeaderVersionOne)) {
+        data.resize(static_cast<size_t>(fileHeader.dataSize));
+        if (!file.read(data.data(), data.size()) || fnv1a(data.data(), data.size()) != fileHeader.dataHash) {
+          data.clear();
+        }
+      }
+
+      // The header of the data itself identifies the device and the driver build that produced it.
+      if (!data.empty()) {
+        VkPipelineCacheHeaderVersionOne dataHeader;
+        std::memcpy(&dataHeader, data.data(), sizeof(dataHeader));
+        if (dataHeader.headerSize < sizeof(dataHeader)
+            || dataHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            || dataHeader.vendorID != properties.vendorID
+            || dataHeader.deviceID != properties.deviceID
+            || std::memcmp(dataHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+          data.clear();
+        }
+      }
+
+      VkPipelineCacheCreateInfo createInfo{};
+      createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+      createInfo.initialDataSize = data.size();
+      createInfo.pInitialData = data.empty() ? nullptr : data.data();
+      if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline cache!");
+      }
+
+      float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+      if (data.empty()) {
+        std::cout << "Pipeline cache: no valid cache on disk, every pipeline is compiled by the driver." << std::endl;
+      } else {
+        std::cout << "Pipeline cache: loaded " << data.size() / 1024 << " KiB in " << milliseconds << " ms" << std::endl;
+      }
+    }
+
+    void LthDevice::savePipelineCache() {
+      auto start = std::chrono::high_resolution_clock::now();
+      size_t dataSize = 0;
+      if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        return;
+      }
+      std::vector<char> data(dataSize);
+      if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+        std::cerr << "Failed to read the pipeline cache data" << std::endl;
+        return;
+      }
+      data.resize(dataSize);
+
+      PipelineCacheFileHeader fileHeader{};
+      fileHeader.magic = PIPELINECACHEFILEMAGIC;
+      fileHeader.driverVersion = physicalDeviceProperties.properties.driverVersion;
+      fileHeader.dataSize = data.size();
+      fileHeader.dataHash = fnv1a(data.data(), data.size());
+
+      // Written through a temporary file, so that an interrupted save leaves the previous cache.
+      const std::string filePath = CACHEFOLDERPATH(PIPELINECACHEFILE);
+      const std::string tmpFilePath = filePath + ".tmp";
+      std::error_code error;
+      std::filesystem::create_directories(std::filesystem::path(filePath).parent_path(), error);
+      {
+        std::ofstream file(tmpFilePath, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader)) || !file.write(data.data(), data.size())) {
+          std::cerr << "Failed to write the pipeline cache to " << tmpFilePath << std::endl;
+          return;
+        }
+      }
+      std::filesystem::rename(tmpFilePath, filePath, error);
+      if (error) {
+        std::cerr << "Failed to write the pipeline cache to " << filePath << ": " << error.message() << std::endl;
+        return;
+      }
+      std::cout << "Pipeline cache: saved " << data.size() / 1024 << " KiB in "
+        << std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+    }
+
     void LthDevice::createSurface() { window.createWindowSurface(instance, &surface); }
 
     bool LthDevice::isDeviceSuitable(VkPhysicalDevice device) {
@@ -276,8 +416,14 @@ namespace lth {
 
       vkGetPhysicalDeviceFeatures2(device, &physicalDeviceFeatures2_Get);
 
+      bool descriptorIndexingSupported = physicalDeviceFeatures1_2_Get.runtimeDescriptorArray &&
+          physicalDeviceFeatures1_2_Get.shaderSampledImageArrayNonUniformIndexing &&
+          physicalDeviceFeatures1_2_Get.descriptorBindingPartiallyBound &&
+          physicalDeviceFeatures1_2_Get.descriptorBindingSampledImageUpdateAfterBind &&
+          physicalDeviceFeatures1_2_Get.descriptorBindingVariableDescriptorCount;
+
       return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-          physicalDeviceFeatures2_Get.features.samplerAnisotropy;
+          physicalDeviceFeatures2_Get.features.samplerAnisotropy && descriptorIndexingSupported;
     }
 
     void LthDevice::populateDebugMessengerCreateInfo(
@@ -393,26 +539,42 @@ namespace lth {
       std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
       vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+      bool transferFamilyIsTransferOnly = false;
       int i = 0;
       for (const auto &queueFamily : queueFamilies) {
-        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
-            && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
-          indices.graphicsAndComputeFamily = i;
-          indices.graphicsAndComputeFamilyHasValue = true;
-        }
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-        if (queueFamily.queueCount > 0 && presentSupport) {
-          indices.presentFamily = i;
-          indices.presentFamilyHasValue = true;
+        if (!indices.isComplete()) {
+          if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+              && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+            indices.graphicsAndComputeFamily = i;
+            indices.graphicsAndComputeFamilyHasValue = true;
+          }
+          VkBool32 presentSupport = false;
+          vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+          if (queueFamily.queueCount > 0 && presentSupport) {
+            indices.presentFamily = i;
+            indices.presentFamilyHasValue = true;
+          }
         }
-        if (indices.isComplete()) {
-          break;
+
+        // Prefer a transfer only family (copy engine), then any non graphics family supporting transfers.
+        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT)
+            && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+          bool transferOnly = !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT);
+          if (!indices.transferFamilyHasValue || (transferOnly && !transferFamilyIsTransferOnly)) {
+            indices.transferFamily = i;
+            indices.transferFamilyHasValue = true;
+            transferFamilyIsTransferOnly = transferOnly;
+          }
         }
 
         i++;
       }
 
+      if (!indices.transferFamilyHasValue && indices.graphicsAndComputeFamilyHasValue) {
+        indices.transferFamily = indices.graphicsAndComputeFamily;
+        indices.transferFamilyHasValue = true;
+      }
+
       return indices;
     }
 
@@ -463,11 +625,10 @@ namespace lth {
         initInfo.Instance = instance;
         initInfo.PhysicalDevice = physicalDevice;
         initInfo.Device = device;
-        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
         assert(queueFamilyIndices.graphicsAndComputeFamilyHasValue && "Error: could not init ImGui, graphics queue has no family!");
         initInfo.QueueFamily = queueFamilyIndices.graphicsAndComputeFamily;
         initInfo.Queue = graphicsQueue;
-        initInfo.PipelineCache = VK_NULL_HANDLE;
+        initInfo.PipelineCache = pipelineCache;
         initInfo.DescriptorPool = descriptorPool;
         initInfo.Allocator = nullptr;
         initInfo.MinImageCount = imageCount;
@@ -477,16 +638,7 @@ namespace lth {
     }
 
     uint32_t LthDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-      VkPhysicalDeviceMemoryProperties memProperties;
-      vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-      for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) &&
-            (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-          return i;
-        }
-      }
-
-      throw std::runtime_error("Failed to find suitable memory type!");
+      return memoryAllocator->findMemoryType(typeFilter, properties);
     }
 
     void LthDevice::createBuffer(
@@ -494,35 +646,28 @@ namespace lth {
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer &buffer,
-        VkDeviceMemory &bufferMemory) {
+        LthAllocation &bufferAllocation,
+        VkDeviceSize minAlignment,
+        bool sharedWithTransferQueue) {
       VkBufferCreateInfo bufferInfo{};
       bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
       bufferInfo.size = size;
       bufferInfo.usage = usage;
       bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-      if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create buffer!");
+      // Long lived buffers updated piecewise by the transfer queue skip the queue family ownership transfers.
+      uint32_t sharedQueueFamilyIndices[] = { queueFamilyIndices.graphicsAndComputeFamily, queueFamilyIndices.transferFamily };
+      if (sharedWithTransferQueue && queueFamilyIndices.hasDedicatedTransferFamily()) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = sharedQueueFamilyIndices;
       }
 
-      VkMemoryRequirements memRequirements;
-      vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-      VkMemoryAllocateFlagsInfo allocFlagsInfo{};
-      allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
-      allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
-
-      VkMemoryAllocateInfo allocInfo{};
-      allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-      allocInfo.pNext = &allocFlagsInfo;
-      allocInfo.allocationSize = memRequirements.size;
-      allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-      if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate buffer memory!");
+      if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create buffer!");
       }
 
-      vkBindBufferMemory(device, buffer, bufferMemory, 0);
+      bufferAllocation = memoryAllocator->allocateForBuffer(buffer, properties, minAlignment);
     }
 
     VkCommandBuffer LthDevice::beginSingleTimeCommands() {
@@ -555,9 +700,18 @@ namespace lth {
       submitInfo.commandBufferCount = 1;
       submitInfo.pCommandBuffers = &commandBuffer;
 
-      vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-      vkQueueWaitIdle(graphicsQueue);
+      // Only wait for this submission, not for the whole graphics queue.
+      VkFenceCreateInfo fenceInfo{};
+      fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+      VkFence fence;
+      if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create single time commands fence!");
+      }
 
+      vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence);
+      vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+      vkDestroyFence(device, fence, nullptr);
       vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
     }
 
@@ -601,18 +755,6 @@ namespace lth {
     }
 
 
-    void LthDevice::buildAccelerationStructure(const VkAccelerationStructureBuildGeometryInfoKHR &asBuildGeometryInfo, const VkAccelerationStructureBuildRangeInfoKHR& asBuildRangeInfo) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-        auto asBuildRangeInfos = { &asBuildRangeInfo };
-        vkCmdBuildAccelerationStructuresKHR(
-            commandBuffer,
-            1,
-            &asBuildGeometryInfo,
-            asBuildRangeInfos.begin());
-
-        endSingleTimeCommands(commandBuffer);
-    }
-
     void LthDevice::createImage(uint32_t width,
         uint32_t height,
         VkFormat format,
@@ -620,7 +762,7 @@ namespace lth {
         VkImageUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkImage& image,
-        VkDeviceMemory& imageMemory,
+        LthAllocation& imageAllocation,
         uint32_t mipLevels,
         VkSampleCountFlagBits numSamples) {
         VkImageCreateInfo imageInfo{};
@@ -639,33 +781,19 @@ namespace lth {
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         imageInfo.flags = 0;
 
-        createImageWithInfo(imageInfo, properties, image, imageMemory);
+        createImageWithInfo(imageInfo, properties, image, imageAllocation);
     }
 
     void LthDevice::createImageWithInfo(
         const VkImageCreateInfo& imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage& image,
-        VkDeviceMemory& imageMemory) {
+        LthAllocation& imageAllocation) {
       if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create image!");
       }
 
-      VkMemoryRequirements memRequirements;
-      vkGetImageMemoryRequirements(device, image, &memRequirements);
-
-      VkMemoryAllocateInfo allocInfo{};
-      allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-      allocInfo.allocationSize = memRequirements.size;
-      allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-      if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate image memory!");
-      }
-
-      if (vkBindImageMemory(device, image, imageMemory, 0) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to bind image memory!");
-      }
+      imageAllocation = memoryAllocator->allocateForImage(image, properties, imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
     }
 
     void LthDevice::transitionImageLayout(
@@ -675,7 +803,17 @@ namespace lth {
         VkImageLayout newLayout,
         uint32_t mipLevels) {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        recordTransitionImageLayout(commandBuffer, image, format, oldLayout, newLayout, mipLevels);
+        endSingleTimeCommands(commandBuffer);
+    }
 
+    void LthDevice::recordTransitionImageLayout(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        VkFormat format,
+        VkImageLayout oldLayout,
+        VkImageLayout newLayout,
+        uint32_t mipLevels) {
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout = oldLayout;
@@ -748,8 +886,6 @@ namespace lth {
             0, nullptr,
             1, &barrier
         );
-
-        endSingleTimeCommands(commandBuffer);
     }
 
     VkImageView LthDevice::createImageView(
@@ -784,6 +920,19 @@ namespace lth {
         int32_t texHeight,
         uint32_t mipLevels,
         VkImageLayout newImageLayout) {
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        recordGenerateMipmaps(commandBuffer, image, format, texWidth, texHeight, mipLevels, newImageLayout);
+        endSingleTimeCommands(commandBuffer);
+    }
+
+    void LthDevice::recordGenerateMipmaps(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        VkFormat format,
+        int32_t texWidth,
+        int32_t texHeight,
+        uint32_t mipLevels,
+        VkImageLayout newImageLayout) {
 
         VkFormatProperties formatProperties;
         vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
@@ -792,8 +941,6 @@ namespace lth {
             throw std::runtime_error("Texture image format does not support linear blitting!");
         }
 
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.image = image;
@@ -867,8 +1014,6 @@ namespace lth {
             0, nullptr,
             0, nullptr,
             1, &barrier);
-
-        endSingleTimeCommands(commandBuffer);
     }
 
     VkSampleCountFlagBits LthDevice::getMaxUsableSampleCount() {
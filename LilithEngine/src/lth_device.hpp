@@ -2,14 +2,21 @@
 #define __LTH_DEVICE_HPP__
 
 #include "lth_window.hpp"
+#include "lth_memory_allocator.hpp"
 
 #include "backends/imgui_impl_vulkan.h"
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace lth {
 
+    class LthUploadContext;
+    class LthThreadPool;
+    class LthSamplerCache;
+
     struct SwapChainSupportDetails {
       VkSurfaceCapabilitiesKHR capabilities;
       std::vector<VkSurfaceFormatKHR> formats;
@@ -19,9 +26,12 @@ namespace lth {
     struct QueueFamilyIndices {
       uint32_t graphicsAndComputeFamily;
       uint32_t presentFamily;
+      uint32_t transferFamily; // Falls back to graphicsAndComputeFamily when there is no dedicated transfer family.
       bool graphicsAndComputeFamilyHasValue = false;
       bool presentFamilyHasValue = false;
+      bool transferFamilyHasValue = false;
       bool isComplete() { return graphicsAndComputeFamilyHasValue && presentFamilyHasValue; }
+      bool hasDedicatedTransferFamily() { return transferFamilyHasValue && transferFamily != graphicsAndComputeFamily; }
     };
 
     class LthDevice {
@@ -43,6 +53,13 @@ namespace lth {
       VkQueue getGraphicsQueue() { return graphicsQueue; }
       VkQueue getPresentQueue() { return presentQueue; }
       VkQueue getComputeQueue() { return computeQueue; }
+      VkQueue getTransferQueue() { return transferQueue; }
+      LthMemoryAllocator& getMemoryAllocator() { return *memoryAllocator; }
+      LthUploadContext& getUploadContext() { return *uploadContext; }
+      LthThreadPool& getThreadPool() { return *threadPool; } // CPU workers shared by the asset loaders.
+      LthSamplerCache& getSamplerCache() { return *samplerCache; }
+      // Loaded from the disk at startup and saved back on destruction, to be passed to every pipeline creation.
+      VkPipelineCache getPipelineCache() { return pipelineCache; }
 
       // ImGui methods
       ImGui_ImplVulkan_InitInfo getImGuiInitInfo(VkDescriptorPool descriptorPool, uint32_t imageCount);
@@ -50,7 +67,7 @@ namespace lth {
       // Swap chain creation methods
       SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
       uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-      QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
+      QueueFamilyIndices findPhysicalQueueFamilies() { return queueFamilyIndices; } // Queried once, when picking the physical device.
       VkFormat findSupportedFormat(
           const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
@@ -60,13 +77,15 @@ namespace lth {
           VkBufferUsageFlags usage,
           VkMemoryPropertyFlags properties,
           VkBuffer &buffer,
-          VkDeviceMemory &bufferMemory);
+          LthAllocation &bufferAllocation,
+          VkDeviceSize minAlignment = 1,
+          bool sharedWithTransferQueue = false);
+      void freeMemory(LthAllocation &allocation) { memoryAllocator->free(allocation); }
       VkCommandBuffer beginSingleTimeCommands();
       void endSingleTimeCommands(VkCommandBuffer commandBuffer);
       void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
       void copyBufferToImage(
           VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
-      void buildAccelerationStructure(const VkAccelerationStructureBuildGeometryInfoKHR& asBuildGeometryInfo, const VkAccelerationStructureBuildRangeInfoKHR& asBuildRangeInfo);
 
       // Image generation methods
       void createImage(uint32_t width,
@@ -76,20 +95,27 @@ namespace lth {
           VkImageUsageFlags usage,
           VkMemoryPropertyFlags properties,
           VkImage& image,
-          VkDeviceMemory& imageMemory,
+          LthAllocation& imageAllocation,
           uint32_t mipLevels = 1,
           VkSampleCountFlagBits numSamples = VK_SAMPLE_COUNT_1_BIT);
       void createImageWithInfo(
           const VkImageCreateInfo &imageInfo,
           VkMemoryPropertyFlags properties,
           VkImage &image,
-          VkDeviceMemory &imageMemory);
+          LthAllocation &imageAllocation);
       void transitionImageLayout(
           VkImage image,
           VkFormat format,
           VkImageLayout oldLayout,
           VkImageLayout newLayout,
           uint32_t mipLevels = 1);
+      void recordTransitionImageLayout(
+          VkCommandBuffer commandBuffer,
+          VkImage image,
+          VkFormat format,
+          VkImageLayout oldLayout,
+          VkImageLayout newLayout,
+          uint32_t mipLevels = 1);
       VkImageView createImageView(
           VkImage image,
           VkFormat format,
@@ -102,10 +128,29 @@ namespace lth {
           int32_t texHeight,
           uint32_t mipLevels,
           VkImageLayout newImageLayout);
+      void recordGenerateMipmaps(
+          VkCommandBuffer commandBuffer,
+          VkImage image,
+          VkFormat imageFormat,
+          int32_t texWidth,
+          int32_t texHeight,
+          uint32_t mipLevels,
+          VkImageLayout newImageLayout);
 
       // Properties helper methods
       VkSampleCountFlagBits getMsaaSamples() { return msaaSamples; }
       bool isMsaaEnabled() { return (msaaSamples != VK_SAMPLE_COUNT_1_BIT); }
+      bool supportsMultiDrawIndirect() { return physicalDeviceFeatures2.features.multiDrawIndirect == VK_TRUE; }
+      bool supportsDrawIndirectFirstInstance() { return physicalDeviceFeatures2.features.drawIndirectFirstInstance == VK_TRUE; }
+      bool supportsDrawIndirectCount() { return physicalDeviceFeatures1_2.drawIndirectCount == VK_TRUE; }
+      bool supportsTextureCompressionBC() { return physicalDeviceFeatures2.features.textureCompressionBC == VK_TRUE; }
+      uint32_t getMaxDrawIndirectCount() { return physicalDeviceProperties.properties.limits.maxDrawIndirectCount; }
+      uint32_t getMaxBindlessTextureCount() {
+        return std::min({ physicalDeviceProperties1_2.maxPerStageDescriptorUpdateAfterBindSamplers,
+            physicalDeviceProperties1_2.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            physicalDeviceProperties1_2.maxDescriptorSetUpdateAfterBindSamplers,
+            physicalDeviceProperties1_2.maxDescriptorSetUpdateAfterBindSampledImages });
+      }
 
 
       VkPhysicalDeviceProperties2 physicalDeviceProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
@@ -114,6 +159,8 @@ namespace lth {
         VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR };
       VkPhysicalDeviceAccelerationStructurePropertiesKHR accelStructProperties{
           VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR };
+      VkPhysicalDeviceVulkan12Properties physicalDeviceProperties1_2{
+          VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES };
 
       
       VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
@@ -143,6 +190,10 @@ namespace lth {
       void pickPhysicalDevice();
       void createLogicalDevice();
       void createCommandPool();
+      void createMemoryAllocator();
+      void createUploadContext();
+      void createPipelineCache();
+      void savePipelineCache();
 
       // helper methods
       bool isDeviceSuitable(VkPhysicalDevice device);
@@ -159,13 +210,18 @@ namespace lth {
       VkInstance instance;
       VkDebugUtilsMessengerEXT debugMessenger;
       VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+      QueueFamilyIndices queueFamilyIndices{};
       LthWindow &window;
       VkCommandPool commandPool;
-
+      std::unique_ptr<LthMemoryAllocator> memoryAllocator;
+      std::unique_ptr<LthUploadContext> uploadContext;
+      std::unique_ptr<LthThreadPool> threadPool;
+      std::unique_ptr<LthSamplerCache> samplerCache;
+      VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 
       VkDevice device;
       VkSurfaceKHR surface;
-      VkQueue graphicsQueue, presentQueue, computeQueue;
+      VkQueue graphicsQueue, presentQueue, computeQueue, transferQueue;
 
       VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
     };
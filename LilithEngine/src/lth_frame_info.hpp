@@ -3,6 +3,7 @@
 
 #include "lth_camera.hpp"
 #include "lth_scene.hpp"
+#include "lth_ring_buffer.hpp"
 
 
 #define MAX_LIGHTS 8
@@ -31,7 +32,12 @@ namespace lth {
 		VkCommandBuffer computeCommandBuffer;
 		LthCamera& camera;
 		VkDescriptorSet globalDescriptorSet;
+		uint32_t globalUboOffset; // Dynamic offset of the GlobalUBO in the frame ring buffer.
+		VkDescriptorSet instanceDescriptorSet;
+		uint32_t instanceBufferOffset; // Dynamic offset of the frame InstanceData array in the frame ring buffer.
+		VkDescriptorSet textureDescriptorSet; // Bindless texture table, see LthTextureTable.
 		LthScene& scene;
+		LthRingBuffer& frameRingBuffer;
 	};
 }
 
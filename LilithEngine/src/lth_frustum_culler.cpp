@@ -0,0 +1,130 @@
+#include "lth_frustum_culler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define LTH_FRUSTUM_CULLER_SSE
+#include <emmintrin.h>
+#endif
+
+namespace lth {
+
+	void LthFrustumCuller::clear() {
+		centersX.clear();
+		centersY.clear();
+		centersZ.clear();
+		radii.clear();
+	}
+
+	void LthFrustumCuller::reserve(size_t sphereCount) {
+		centersX.reserve(sphereCount);
+		centersY.reserve(sphereCount);
+		centersZ.reserve(sphereCount);
+		radii.reserve(sphereCount);
+	}
+
+	void LthFrustumCuller::addSphere(const glm::vec3& center, float radius) {
+		centersX.push_back(center.x);
+		centersY.push_back(center.y);
+		centersZ.push_back(center.z);
+		radii.push_back(radius);
+	}
+
+	bool LthFrustumCuller::isVisible(const LthFrustumPlanes& planes, size_t index) const {
+		for (const glm::vec4& plane : planes) {
+			float distance = plane.x * centersX[index] + plane.y * centersY[index] + plane.z * centersZ[index] + plane.w;
+			if (distance < -radii[index]) return false;
+		}
+		return true;
+	}
+
+	void LthFrustumCuller::cullScalar(const LthFrustumPlanes& planes, std::vector<uint32_t>& visibleIndices) const {
+		visibleIndices.clear();
+		for (size_t i = 0; i < radii.size(); ++i) {
+			if (isVisible(planes, i)) {
+				visibleIndices.push_back(static_cast<uint32_t>(i));
+			}
+		}
+	}
+
+	void LthFrustumCuller::cull(const LthFrustumPlanes& planes, std::vector<uint32_t>& visibleIndices) const {
+#ifdef LTH_FRUSTUM_CULLER_SSE
+		visibleIndices.clear();
+		const size_t count = radii.size();
+		const size_t simdCount = count & ~size_t(3);
+
+		std::array<__m128, 6> planesX, planesY, planesZ, planesW;
+		for (size_t p = 0; p < planes.size(); ++p) {
+			planesX[p] = _mm_set1_ps(planes[p].x);
+			planesY[p] = _mm_set1_ps(planes[p].y);
+			planesZ[p] = _mm_set1_ps(planes[p].z);
+			planesW[p] = _mm_set1_ps(planes[p].w);
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		for (size_t i = 0; i < simdCount; i += 4) {
+			__m128 x = _mm_loadu_ps(&centersX[i]);
+			__m128 y = _mm_loadu_ps(&centersY[i]);
+			__m128 z = _mm_loadu_ps(&centersZ[i]);
+			__m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(&radii[i]));
+
+			// A lane stays visible while its sphere is not fully behind any plane.
+			__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (size_t p = 0; p < planes.size(); ++p) {
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(planesX[p], x), _mm_mul_ps(planesY[p], y)),
+					_mm_add_ps(_mm_mul_ps(planesZ[p], z), planesW[p]));
+				visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negRadius));
+			}
+
+			int mask = _mm_movemask_ps(visible);
+			for (uint32_t lane = 0; mask != 0; ++lane, mask >>= 1) {
+				if (mask & 1) {
+					visibleIndices.push_back(static_cast<uint32_t>(i + lane));
+				}
+			}
+		}
+
+		for (size_t i = simdCount; i < count; ++i) {
+			if (isVisible(planes, i)) {
+				visibleIndices.push_back(static_cast<uint32_t>(i));
+			}
+		}
+#else
+		cullScalar(planes, visibleIndices);
+#endif
+	}
+
+	LthFrustumCuller::BenchmarkResult LthFrustumCuller::benchmark(const LthFrustumPlanes& planes, uint32_t sphereCount, uint32_t iterations) {
+		LthFrustumCuller culler{};
+		culler.reserve(sphereCount);
+		std::mt19937 generator{ 42 };
+		std::uniform_real_distribution<float> position{ -50.f, 50.f };
+		std::uniform_real_distribution<float> radius{ 0.1f, 2.f };
+		for (uint32_t i = 0; i < sphereCount; ++i) {
+			culler.addSphere({ position(generator), position(generator), position(generator) }, radius(generator));
+		}
+
+		std::vector<uint32_t> visibleIndices{};
+		visibleIndices.reserve(sphereCount);
+
+		auto measure = [&](auto cullFunction) {
+			auto start = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < iterations; ++i) {
+				cullFunction();
+			}
+			auto end = std::chrono::high_resolution_clock::now();
+			double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+			return static_cast<double>(sphereCount) * iterations / std::max(milliseconds, 1e-6);
+			};
+
+		BenchmarkResult result{};
+		result.sphereCount = sphereCount;
+		result.scalarSpheresPerMs = measure([&]() { culler.cullScalar(planes, visibleIndices); });
+		result.simdSpheresPerMs = measure([&]() { culler.cull(planes, visibleIndices); });
+		result.visibleCount = static_cast<uint32_t>(visibleIndices.size());
+		return result;
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef __LTH_FRUSTUM_CULLER_HPP__
+#define __LTH_FRUSTUM_CULLER_HPP__
+
+#include "lth_camera.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace lth {
+
+	// Tests world space bounding spheres against the camera frustum. The spheres are stored as structure of arrays
+	// so that the SSE path tests four of them per plane with a handful of instructions.
+	class LthFrustumCuller {
+	public:
+		struct BenchmarkResult {
+			uint32_t sphereCount = 0;
+			uint32_t visibleCount = 0;
+			double simdSpheresPerMs = 0.0;
+			double scalarSpheresPerMs = 0.0;
+		};
+
+		void clear();
+		void reserve(size_t sphereCount);
+		void addSphere(const glm::vec3& center, float radius);
+		size_t size() const { return radii.size(); }
+		glm::vec4 getSphere(size_t index) const { return { centersX[index], centersY[index], centersZ[index], radii[index] }; }
+
+		// Fills visibleIndices with the indices of the spheres intersecting the frustum, in increasing order.
+		void cull(const LthFrustumPlanes& planes, std::vector<uint32_t>& visibleIndices) const;
+		void cullScalar(const LthFrustumPlanes& planes, std::vector<uint32_t>& visibleIndices) const;
+
+		// Single threaded throughput of both paths over random spheres around the origin.
+		static BenchmarkResult benchmark(const LthFrustumPlanes& planes, uint32_t sphereCount = 1u << 20, uint32_t iterations = 16);
+
+	private:
+		bool isVisible(const LthFrustumPlanes& planes, size_t index) const;
+
+		std::vector<float> centersX{};
+		std::vector<float> centersY{};
+		std::vector<float> centersZ{};
+		std::vector<float> radii{};
+	};
+}
+
+#endif
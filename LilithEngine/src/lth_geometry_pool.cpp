@@ -0,0 +1,120 @@
+#include "lth_geometry_pool.hpp"
+#include "lth_upload_context.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace lth {
+
+	static VkDeviceAddress getBufferDeviceAddress(LthDevice& device, VkBuffer buffer) {
+		VkBufferDeviceAddressInfo bufferDeviceAddressInfo{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+			.pNext = nullptr,
+			.buffer = buffer,
+		};
+		return vkGetBufferDeviceAddress(device.getDevice(), &bufferDeviceAddressInfo);
+	}
+
+	LthGeometryPool::LthGeometryPool(LthDevice& device, VkDeviceSize vertexBufferSize, VkDeviceSize indexBufferSize, VkDeviceSize meshletBufferSize)
+		: lthDevice{ device }, vertexRanges{ vertexBufferSize }, indexRanges{ indexBufferSize }, meshletRanges{ meshletBufferSize / sizeof(LthMeshlet) } {
+
+		vertexBuffer = std::make_unique<LthBuffer>(
+			lthDevice,
+			vertexBufferSize,
+			1,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+			| VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			1,
+			true);
+
+		indexBuffer = std::make_unique<LthBuffer>(
+			lthDevice,
+			indexBufferSize,
+			1,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+			| VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			1,
+			true);
+
+		meshletBuffer = std::make_unique<LthBuffer>(
+			lthDevice,
+			sizeof(LthMeshlet),
+			static_cast<uint32_t>(meshletRanges.getSize()),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			1,
+			true);
+
+		vertexBufferAddress = getBufferDeviceAddress(lthDevice, vertexBuffer->getBuffer());
+		indexBufferAddress = getBufferDeviceAddress(lthDevice, indexBuffer->getBuffer());
+	}
+
+	LthGeometryRange LthGeometryPool::upload(
+		const void* vertices, uint32_t vertexCount, uint32_t vertexStride,
+		const void* indices, uint32_t indexCount, VkIndexType indexType,
+		const LthMeshlet* meshlets, uint32_t meshletCount) {
+		assert(vertexCount > 0 && "Cannot upload an empty mesh!");
+		assert(vertexStride % 4 == 0 && "Vertex strides must be a multiple of 4 bytes to be pulled as 32 bits words!");
+		assert((indexType == VK_INDEX_TYPE_UINT16 || indexType == VK_INDEX_TYPE_UINT32) && "Unsupported index type!");
+
+		LthGeometryRange range{};
+		range.vertexCount = vertexCount;
+		range.vertexStride = vertexStride;
+		range.indexType = indexType;
+
+		uint64_t vertexOffset = vertexRanges.allocate(static_cast<uint64_t>(vertexCount) * vertexStride, 4);
+		if (vertexOffset == LthRangeAllocator::INVALID_OFFSET) {
+			throw std::runtime_error("Failed to allocate vertices, the geometry pool is full!");
+		}
+		range.vertexOffset = static_cast<uint32_t>(vertexOffset);
+
+		const VkDeviceSize indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		if (indexCount > 0) {
+			// 4 bytes alignment, as acceleration structure builds require for their index data.
+			uint64_t indexOffset = indexRanges.allocate(indexSize * indexCount, 4);
+			if (indexOffset == LthRangeAllocator::INVALID_OFFSET) {
+				vertexRanges.free(vertexOffset);
+				throw std::runtime_error("Failed to allocate indices, the geometry pool is full!");
+			}
+			range.indexOffset = static_cast<uint32_t>(indexOffset);
+			range.indexCount = indexCount;
+		}
+
+		if (meshletCount > 0) {
+			uint64_t meshletOffset = meshletRanges.allocate(meshletCount);
+			if (meshletOffset == LthRangeAllocator::INVALID_OFFSET) {
+				free(range);
+				throw std::runtime_error("Failed to allocate meshlets, the geometry pool is full!");
+			}
+			range.meshletOffset = static_cast<uint32_t>(meshletOffset);
+			range.meshletCount = meshletCount;
+		}
+
+		LthUploadContext& uploadContext = lthDevice.getUploadContext();
+		LthUploadContext::Batch uploadBatch{ uploadContext };
+		uploadContext.uploadToBuffer(vertices, static_cast<VkDeviceSize>(vertexCount) * vertexStride, *vertexBuffer, range.vertexOffset);
+		if (indexCount > 0) {
+			uploadContext.uploadToBuffer(indices, indexSize * indexCount, *indexBuffer, range.indexOffset);
+		}
+		if (meshletCount > 0) {
+			uploadContext.uploadToBuffer(meshlets, sizeof(LthMeshlet) * meshletCount, *meshletBuffer, sizeof(LthMeshlet) * range.meshletOffset);
+		}
+		return range;
+	}
+
+	void LthGeometryPool::free(const LthGeometryRange& range) {
+		vertexRanges.free(range.vertexOffset);
+		if (range.indexCount > 0) {
+			indexRanges.free(range.indexOffset);
+		}
+		if (range.meshletCount > 0) {
+			meshletRanges.free(range.meshletOffset);
+		}
+	}
+
+	void LthGeometryPool::bindIndexBuffer(VkCommandBuffer commandBuffer, VkIndexType indexType) {
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
+	}
+}
@@ -0,0 +1,82 @@
+#ifndef __LTH_GEOMETRY_POOL_HPP__
+#define __LTH_GEOMETRY_POOL_HPP__
+
+#include "lth_device.hpp"
+#include "lth_buffer.hpp"
+#include "lth_range_allocator.hpp"
+#include "lth_meshlet_builder.hpp"
+
+#include <memory>
+
+namespace lth {
+
+	// Location of a mesh inside the geometry pool. Indices are relative to the first vertex of the mesh.
+	struct LthGeometryRange {
+		uint32_t vertexOffset = 0; // In bytes, multiple of 4.
+		uint32_t vertexCount = 0;
+		uint32_t vertexStride = 0;
+		uint32_t indexOffset = 0; // In bytes.
+		uint32_t indexCount = 0;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		uint32_t meshletOffset = 0; // In meshlets.
+		uint32_t meshletCount = 0;
+
+		uint32_t firstIndex() const { return indexOffset / (indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4); }
+	};
+
+	// Engine-wide vertex and index buffers shared by every model. The vertex buffer is read by the shaders as a storage
+	// buffer (vertex pulling), so meshes of different vertex layouts live side by side. 16 and 32 bits indices share
+	// the index buffer, which is bound once per index type. The meshlets of the models drawn with cluster culling have
+	// a storage buffer of their own. All are shared with the transfer queue so that meshes can be streamed in while the
+	// rest of the pool is in use.
+	class LthGeometryPool {
+	public:
+		static constexpr VkDeviceSize DEFAULT_VERTEX_BUFFER_SIZE = 48ull * 1024 * 1024;
+		static constexpr VkDeviceSize DEFAULT_INDEX_BUFFER_SIZE = 16ull * 1024 * 1024;
+		static constexpr VkDeviceSize DEFAULT_MESHLET_BUFFER_SIZE = 4ull * 1024 * 1024;
+
+		LthGeometryPool(LthDevice& device,
+			VkDeviceSize vertexBufferSize = DEFAULT_VERTEX_BUFFER_SIZE,
+			VkDeviceSize indexBufferSize = DEFAULT_INDEX_BUFFER_SIZE,
+			VkDeviceSize meshletBufferSize = DEFAULT_MESHLET_BUFFER_SIZE);
+
+		LthGeometryPool(const LthGeometryPool&) = delete;
+		LthGeometryPool& operator=(const LthGeometryPool&) = delete;
+
+		// Reserves the ranges and records their upload in the current upload batch (or a batch of its own).
+		LthGeometryRange upload(
+			const void* vertices, uint32_t vertexCount, uint32_t vertexStride,
+			const void* indices, uint32_t indexCount, VkIndexType indexType,
+			const LthMeshlet* meshlets = nullptr, uint32_t meshletCount = 0);
+		// The GPU must not use the range anymore.
+		void free(const LthGeometryRange& range);
+
+		void bindIndexBuffer(VkCommandBuffer commandBuffer, VkIndexType indexType);
+		VkDescriptorBufferInfo vertexDescriptorInfo() { return vertexBuffer->descriptorInfo(); }
+		VkDescriptorBufferInfo meshletDescriptorInfo() { return meshletBuffer->descriptorInfo(); }
+		VkDeviceAddress getVertexBufferAddress() const { return vertexBufferAddress; }
+		VkDeviceAddress getIndexBufferAddress() const { return indexBufferAddress; }
+
+		VkDeviceSize getVertexBufferSize() const { return vertexRanges.getSize(); }
+		VkDeviceSize getIndexBufferSize() const { return indexRanges.getSize(); }
+		VkDeviceSize getUsedVertexBytes() const { return vertexRanges.getUsedSize(); }
+		VkDeviceSize getUsedIndexBytes() const { return indexRanges.getUsedSize(); }
+		uint32_t getMeshletCapacity() const { return static_cast<uint32_t>(meshletRanges.getSize()); }
+		uint32_t getUsedMeshletCount() const { return static_cast<uint32_t>(meshletRanges.getUsedSize()); }
+
+	private:
+		LthDevice& lthDevice;
+
+		std::unique_ptr<LthBuffer> vertexBuffer;
+		std::unique_ptr<LthBuffer> indexBuffer;
+		std::unique_ptr<LthBuffer> meshletBuffer;
+		VkDeviceAddress vertexBufferAddress;
+		VkDeviceAddress indexBufferAddress;
+
+		LthRangeAllocator vertexRanges;
+		LthRangeAllocator indexRanges;
+		LthRangeAllocator meshletRanges; // In meshlets, so that offsets index the shader array.
+	};
+}
+
+#endif
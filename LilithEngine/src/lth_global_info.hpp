@@ -8,6 +8,8 @@
 #define TEXTURESFOLDERPATH(fileName) "textures/" + std::string(fileName)
 #define IMGUIFONTSFOLDERPATH(fileName) "src/libraries/imgui/misc/fonts/" fileName
 #define DEFAULTTEXTURE "white_pixel.png"
+#define CACHEFOLDERPATH(fileName) "cache/" + std::string(fileName) // Generated at run time, safe to delete.
+#define PIPELINECACHEFILE "pipeline_cache.bin"
 
 namespace lth {
 	static constexpr int WIDTH = 1200;
@@ -15,7 +17,10 @@ namespace lth {
 
 	static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 	static constexpr uint32_t GLOBALPOOLMAXSETS = 100;
-	static constexpr uint32_t TEXTUREARRAYSIZE = 10;
+	static constexpr uint32_t TEXTURETABLEINITIALCAPACITY = 256; // Slots of the bindless texture table, doubled when full.
+	static constexpr uint32_t TEXTURETABLEMAXCAPACITY = 65536; // Or the device limit, if lower.
+	static constexpr uint64_t FRAMERINGBUFFERSIZE = 64ull * 1024 * 1024; // Fits the InstanceData of 100k objects for every frame in flight.
+	static constexpr uint32_t FRAMEMAXINSTANCECOUNT = 100000; // Visible instances per frame, bounds the range of the instance buffer binding.
 
 	enum LTH_UPDATE_DT_MODE {
 		LTH_UPDATE_DT_MODE_CONSTANT_DT_ONE_CALL,
@@ -32,6 +37,7 @@ namespace lth {
 	static constexpr float UPDATE_DT_HALF = UPDATE_DT / 2.f;
 
 	static constexpr uint32_t MAX_RAY_RECURSION_DEPTH = 3U;
+	static constexpr uint32_t SLANGMAXGLOBALSESSIONS = 4; // Compiling concurrently, each one loads its own Slang core module.
 }
 
 #endif
\ No newline at end of file
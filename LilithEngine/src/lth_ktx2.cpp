@@ -0,0 +1,279 @@
+#include "lth_ktx2.hpp"
+#include "lth_mapped_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+namespace lth {
+
+	namespace {
+
+		constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+		struct Ktx2Header {
+			uint8_t identifier[12];
+			uint32_t vkFormat;
+			uint32_t typeSize;
+			uint32_t pixelWidth;
+			uint32_t pixelHeight;
+			uint32_t pixelDepth;
+			uint32_t layerCount;
+			uint32_t faceCount;
+			uint32_t levelCount;
+			uint32_t supercompressionScheme;
+			uint32_t dfdByteOffset;
+			uint32_t dfdByteLength;
+			uint32_t kvdByteOffset;
+			uint32_t kvdByteLength;
+			uint64_t sgdByteOffset;
+			uint64_t sgdByteLength;
+		};
+		static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header must match the KTX 2.0 header layout!");
+
+		struct Ktx2LevelIndex {
+			uint64_t byteOffset;
+			uint64_t byteLength;
+			uint64_t uncompressedByteLength;
+		};
+
+		// Khronos Data Format descriptor values (khr_df.h).
+		enum DfdModel : uint8_t {
+			DFD_MODEL_RGBSDA = 1,
+			DFD_MODEL_BC1A = 128,
+			DFD_MODEL_BC5 = 132,
+			DFD_MODEL_BC7 = 134,
+		};
+		constexpr uint8_t DFD_PRIMARIES_BT709 = 1;
+		constexpr uint8_t DFD_TRANSFER_LINEAR = 1;
+		constexpr uint8_t DFD_TRANSFER_SRGB = 2;
+		constexpr uint8_t DFD_CHANNEL_ALPHA = 15;
+
+		struct DfdSample {
+			uint16_t bitOffset;
+			uint8_t bitLength; // Minus one.
+			uint8_t channelType;
+			uint8_t samplePosition[4];
+			uint32_t sampleLower;
+			uint32_t sampleUpper;
+		};
+
+		bool isSrgb(VkFormat format) {
+			return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK
+				|| format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+		}
+
+		void append(std::vector<uint8_t>& bytes, const void* data, size_t size) {
+			const uint8_t* begin = static_cast<const uint8_t*>(data);
+			bytes.insert(bytes.end(), begin, begin + size);
+		}
+
+		void alignTo(std::vector<uint8_t>& bytes, size_t alignment) {
+			bytes.resize((bytes.size() + alignment - 1) / alignment * alignment, 0);
+		}
+
+		// Basic data format descriptor block, which KTX 2.0 requires even though the vkFormat already says it all.
+		std::vector<uint8_t> createDataFormatDescriptor(VkFormat format) {
+			std::vector<DfdSample> samples{};
+			uint8_t model = DFD_MODEL_RGBSDA;
+			uint8_t blockDimension = 0;
+			switch (format) {
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+				model = DFD_MODEL_BC1A;
+				blockDimension = 3;
+				samples.push_back({ 0, 63, 0, {}, 0, UINT32_MAX });
+				break;
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+				model = DFD_MODEL_BC5;
+				blockDimension = 3;
+				samples.push_back({ 0, 63, 0, {}, 0, UINT32_MAX });
+				samples.push_back({ 64, 63, 1, {}, 0, UINT32_MAX });
+				break;
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+				model = DFD_MODEL_BC7;
+				blockDimension = 3;
+				samples.push_back({ 0, 127, 0, {}, 0, UINT32_MAX });
+				break;
+			default:
+				for (uint8_t channel = 0; channel < 4; ++channel) {
+					samples.push_back({ static_cast<uint16_t>(channel * 8), 7, channel == 3 ? DFD_CHANNEL_ALPHA : channel, {}, 0, 255 });
+				}
+				break;
+			}
+
+			const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+			const uint32_t totalSize = 4 + blockSize;
+			const uint32_t vendorAndType = 0; // Khronos, basic format.
+			const uint32_t versionAndSize = 2u | (blockSize << 16);
+			const uint8_t modelInfo[4] = { model, DFD_PRIMARIES_BT709, isSrgb(format) ? DFD_TRANSFER_SRGB : DFD_TRANSFER_LINEAR, 0 };
+			const uint8_t texelBlockDimension[4] = { blockDimension, blockDimension, 0, 0 };
+			uint8_t bytesPlanes[8]{};
+			bytesPlanes[0] = static_cast<uint8_t>(LthKtx2::getBlockSize(format));
+
+			std::vector<uint8_t> descriptor{};
+			append(descriptor, &totalSize, sizeof(totalSize));
+			append(descriptor, &vendorAndType, sizeof(vendorAndType));
+			append(descriptor, &versionAndSize, sizeof(versionAndSize));
+			append(descriptor, modelInfo, sizeof(modelInfo));
+			append(descriptor, texelBlockDimension, sizeof(texelBlockDimension));
+			append(descriptor, bytesPlanes, sizeof(bytesPlanes));
+			for (const DfdSample& sample : samples) {
+				append(descriptor, &sample, sizeof(sample));
+			}
+			return descriptor;
+		}
+	}
+
+	const uint8_t* LthKtx2Image::getData() const {
+		return file ? file->data() : data.data();
+	}
+
+	uint32_t LthKtx2::getBlockSize(VkFormat format) {
+		switch (format) {
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+			return 4;
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			return 8;
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	bool LthKtx2::isBlockCompressed(VkFormat format) {
+		return getBlockSize(format) > 4;
+	}
+
+	uint64_t LthKtx2::getLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+		if (isBlockCompressed(format)) {
+			return uint64_t{ (width + 3) / 4 } * ((height + 3) / 4) * getBlockSize(format);
+		}
+		return uint64_t{ width } * height * getBlockSize(format);
+	}
+
+	bool LthKtx2::read(const std::string& filePath, LthKtx2Image& image) {
+		auto mappedFile = std::make_shared<LthMappedFile>();
+		if (!mappedFile->open(filePath) || mappedFile->size() < sizeof(Ktx2Header)) {
+			return false;
+		}
+		const LthMappedFile& file = *mappedFile;
+
+		Ktx2Header header{};
+		std::memcpy(&header, file.data(), sizeof(header));
+		const VkFormat format = static_cast<VkFormat>(header.vkFormat);
+		const uint32_t levelCount = std::max(header.levelCount, 1u); // 0 asks the loader to generate the mips.
+		bool valid = std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0
+			&& getBlockSize(format) > 0
+			&& header.pixelWidth > 0 && header.pixelHeight > 0 && header.pixelDepth == 0
+			&& header.layerCount <= 1 && header.faceCount == 1
+			&& header.supercompressionScheme == 0
+			&& levelCount <= 32 && (std::max(header.pixelWidth, header.pixelHeight) >> (levelCount - 1)) > 0
+			&& sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * levelCount <= file.size();
+		if (!valid) {
+			return false;
+		}
+
+		std::vector<Ktx2LevelIndex> levelIndices(levelCount);
+		std::memcpy(levelIndices.data(), file.data() + sizeof(Ktx2Header), sizeof(Ktx2LevelIndex) * levelCount);
+
+		image.format = format;
+		image.width = header.pixelWidth;
+		image.height = header.pixelHeight;
+		image.levels.clear();
+		for (uint32_t level = 0; level < levelCount; ++level) {
+			const uint32_t width = std::max(header.pixelWidth >> level, 1u);
+			const uint32_t height = std::max(header.pixelHeight >> level, 1u);
+			const uint64_t size = getLevelSize(format, width, height);
+			const Ktx2LevelIndex& levelIndex = levelIndices[level];
+			if (levelIndex.byteLength != size || levelIndex.byteOffset > file.size() || size > file.size() - levelIndex.byteOffset) {
+				return false;
+			}
+			image.levels.push_back({ levelIndex.byteOffset, size, width, height });
+		}
+
+		// The levels are copied straight from the mapping to the staging buffer of their upload.
+		image.data.clear();
+		image.file = std::move(mappedFile);
+		return true;
+	}
+
+	bool LthKtx2::write(const std::string& filePath, const LthKtx2Image& image) {
+		const uint32_t levelCount = static_cast<uint32_t>(image.levels.size());
+		if (getBlockSize(image.format) == 0 || levelCount == 0) {
+			return false;
+		}
+
+		Ktx2Header header{};
+		std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+		header.vkFormat = static_cast<uint32_t>(image.format);
+		header.typeSize = 1;
+		header.pixelWidth = image.width;
+		header.pixelHeight = image.height;
+		header.faceCount = 1;
+		header.levelCount = levelCount;
+
+		std::vector<uint8_t> dataFormatDescriptor = createDataFormatDescriptor(image.format);
+		const char writer[] = "KTXwriter\0Lilith";
+		const uint32_t writerLength = sizeof(writer);
+
+		// Header, level index, descriptor and key/value data, then the levels from the smallest one to level 0, each
+		// aligned on its block size.
+		std::vector<uint8_t> bytes(sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * levelCount, 0);
+		header.dfdByteOffset = static_cast<uint32_t>(bytes.size());
+		header.dfdByteLength = static_cast<uint32_t>(dataFormatDescriptor.size());
+		append(bytes, dataFormatDescriptor.data(), dataFormatDescriptor.size());
+		header.kvdByteOffset = static_cast<uint32_t>(bytes.size());
+		append(bytes, &writerLength, sizeof(writerLength));
+		append(bytes, writer, writerLength);
+		alignTo(bytes, 4);
+		header.kvdByteLength = static_cast<uint32_t>(bytes.size()) - header.kvdByteOffset;
+
+		std::vector<Ktx2LevelIndex> levelIndices(levelCount);
+		const size_t levelAlignment = std::max<size_t>(getBlockSize(image.format), 4);
+		for (uint32_t level = levelCount; level-- > 0;) {
+			alignTo(bytes, levelAlignment);
+			const LthTextureLevel& textureLevel = image.levels[level];
+			levelIndices[level] = { bytes.size(), textureLevel.size, textureLevel.size };
+			append(bytes, image.getData() + textureLevel.offset, textureLevel.size);
+		}
+		std::memcpy(bytes.data(), &header, sizeof(header));
+		std::memcpy(bytes.data() + sizeof(header), levelIndices.data(), sizeof(Ktx2LevelIndex) * levelCount);
+
+		// Per thread, the same texture can be converted by two loads at once.
+		const std::string temporaryPath = filePath + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+		{
+			std::ofstream file{ temporaryPath, std::ios::binary | std::ios::trunc };
+			if (!file.is_open()) return false;
+			file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+			if (!file.good()) {
+				file.close();
+				std::error_code error;
+				std::filesystem::remove(temporaryPath, error);
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, filePath, error);
+		if (error) {
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef __LTH_KTX2_HPP__
+#define __LTH_KTX2_HPP__
+
+#include <volk.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lth {
+
+	class LthMappedFile;
+
+	// Mip level of an image, rows of texels (or of 4x4 blocks) tightly packed.
+	struct LthTextureLevel {
+		uint64_t offset; // In the image data (LthKtx2Image::getData).
+		uint64_t size;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	// 2D image with its mip chain, level 0 first, in the layout of a buffer to image copy. An image read from a file keeps
+	// the file mapped and its levels point in the mapping, the levels of any other image are in data.
+	struct LthKtx2Image {
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<LthTextureLevel> levels{};
+		std::vector<uint8_t> data{};
+		std::shared_ptr<const LthMappedFile> file{};
+
+		const uint8_t* getData() const;
+	};
+
+	// Reader and writer of the KTX 2.0 container (Khronos), limited to what the engine uploads: a single 2D image in one of
+	// the formats of getBlockSize, without supercompression.
+	class LthKtx2 {
+	public:
+		// Returns false if the file cannot be read or holds something else than a supported 2D image.
+		static bool read(const std::string& filePath, LthKtx2Image& image);
+		// Writes through a temporary file, so that a file is never left half written.
+		static bool write(const std::string& filePath, const LthKtx2Image& image);
+
+		// Size in bytes of a 4x4 block of the block compressed formats, of a texel otherwise. 0 for unsupported formats.
+		static uint32_t getBlockSize(VkFormat format);
+		static bool isBlockCompressed(VkFormat format);
+		static uint64_t getLevelSize(VkFormat format, uint32_t width, uint32_t height);
+	};
+}
+
+#endif
@@ -0,0 +1,85 @@
+#include "lth_mapped_file.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lth {
+
+#ifdef _WIN32
+	bool LthMappedFile::open(const std::string& filePath) {
+		close();
+
+		HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			CloseHandle(file);
+			return false;
+		}
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		fileHandle = file;
+		mappingHandle = mapping;
+		mappedData = view;
+		mappedSize = static_cast<size_t>(fileSize.QuadPart);
+		return true;
+	}
+
+	void LthMappedFile::close() {
+		if (mappedData) UnmapViewOfFile(mappedData);
+		if (mappingHandle) CloseHandle(mappingHandle);
+		if (fileHandle) CloseHandle(fileHandle);
+		mappedData = nullptr;
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+		mappedSize = 0;
+	}
+#else
+	bool LthMappedFile::open(const std::string& filePath) {
+		close();
+
+		int file = ::open(filePath.c_str(), O_RDONLY);
+		if (file < 0) return false;
+
+		struct stat fileStat{};
+		if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0) {
+			::close(file);
+			return false;
+		}
+
+		// The mapping keeps its own reference to the file.
+		void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		::close(file);
+		if (view == MAP_FAILED) return false;
+
+		mappedData = view;
+		mappedSize = static_cast<size_t>(fileStat.st_size);
+		return true;
+	}
+
+	void LthMappedFile::close() {
+		if (mappedData) munmap(mappedData, mappedSize);
+		mappedData = nullptr;
+		mappedSize = 0;
+	}
+#endif
+}
@@ -0,0 +1,37 @@
+#ifndef __LTH_MAPPED_FILE_HPP__
+#define __LTH_MAPPED_FILE_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lth {
+
+	// Read-only memory mapping of a whole file. The pages are loaded by the OS on first access, nothing is copied.
+	class LthMappedFile {
+	public:
+		LthMappedFile() = default;
+		~LthMappedFile() { close(); }
+
+		LthMappedFile(const LthMappedFile&) = delete;
+		LthMappedFile& operator=(const LthMappedFile&) = delete;
+
+		// Returns false if the file cannot be opened or is empty.
+		bool open(const std::string& filePath);
+		void close();
+
+		bool isOpen() const { return mappedData != nullptr; }
+		const uint8_t* data() const { return static_cast<const uint8_t*>(mappedData); }
+		size_t size() const { return mappedSize; }
+
+	private:
+		void* mappedData = nullptr;
+		size_t mappedSize = 0;
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#endif
+	};
+}
+
+#endif
@@ -0,0 +1,264 @@
+#include "lth_memory_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace lth {
+
+	LthMemoryBlock::LthMemoryBlock(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, bool linear, bool dedicated, void* mapped)
+		: memory{ memory }, size{ size }, memoryTypeIndex{ memoryTypeIndex }, linear{ linear }, dedicated{ dedicated }, mapped{ mapped }, ranges{ size } {}
+
+	LthMemoryAllocator::LthMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device) : device{ device } {
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		bufferImageGranularity = properties.limits.bufferImageGranularity;
+		nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+	}
+
+	LthMemoryAllocator::~LthMemoryAllocator() {
+		for (auto& block : blocks) {
+			if (!block->ranges.isEmpty() || block->dedicated) {
+				std::cerr << "Memory allocator destroyed with live allocations in memory type " << block->memoryTypeIndex << "!" << std::endl;
+			}
+			if (block->mapped) {
+				vkUnmapMemory(device, block->memory);
+			}
+			vkFreeMemory(device, block->memory, nullptr);
+		}
+		blocks.clear();
+	}
+
+	LthAllocation LthMemoryAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, VkDeviceSize minAlignment) {
+		VkBufferMemoryRequirementsInfo2 requirementsInfo{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2 };
+		requirementsInfo.buffer = buffer;
+		VkMemoryDedicatedRequirements dedicatedRequirements{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+		VkMemoryRequirements2 requirements{ VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+		requirements.pNext = &dedicatedRequirements;
+		vkGetBufferMemoryRequirements2(device, &requirementsInfo, &requirements);
+
+		// Device addresses of sub-allocated buffers inherit the block offset, some uses (scratch, SBT) need a stronger alignment.
+		requirements.memoryRequirements.alignment = std::max(requirements.memoryRequirements.alignment, minAlignment);
+
+		bool dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation;
+		LthAllocation allocation = allocate(requirements.memoryRequirements, properties, true, dedicated, buffer, VK_NULL_HANDLE);
+
+		if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+			free(allocation);
+			throw std::runtime_error("Failed to bind buffer memory!");
+		}
+		return allocation;
+	}
+
+	LthAllocation LthMemoryAllocator::allocateForImage(VkImage image, VkMemoryPropertyFlags properties, bool linearTiling) {
+		VkImageMemoryRequirementsInfo2 requirementsInfo{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2 };
+		requirementsInfo.image = image;
+		VkMemoryDedicatedRequirements dedicatedRequirements{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+		VkMemoryRequirements2 requirements{ VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+		requirements.pNext = &dedicatedRequirements;
+		vkGetImageMemoryRequirements2(device, &requirementsInfo, &requirements);
+
+		bool dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation;
+		LthAllocation allocation = allocate(requirements.memoryRequirements, properties, linearTiling, dedicated, VK_NULL_HANDLE, image);
+
+		if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+			free(allocation);
+			throw std::runtime_error("Failed to bind image memory!");
+		}
+		return allocation;
+	}
+
+	LthAllocation LthMemoryAllocator::allocate(
+		const VkMemoryRequirements& requirements,
+		VkMemoryPropertyFlags properties,
+		bool linear,
+		bool dedicated,
+		VkBuffer dedicatedBuffer,
+		VkImage dedicatedImage) {
+		uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+		VkDeviceSize blockSize = preferredBlockSize(memoryTypeIndex);
+		// Without granularity constraint, buffers and images can share the same blocks.
+		if (bufferImageGranularity <= 1) linear = true;
+
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		LthMemoryBlock* block = nullptr;
+		uint64_t offset = LthRangeAllocator::INVALID_OFFSET;
+
+		if (dedicated || requirements.size > blockSize / 2) {
+			block = createBlock(memoryTypeIndex, requirements.size, linear, true, dedicatedBuffer, dedicatedImage);
+			if (!block) {
+				throw std::runtime_error("Failed to allocate dedicated device memory!");
+			}
+			offset = block->ranges.allocate(requirements.size, requirements.alignment);
+		}
+		else {
+			for (auto& candidate : blocks) {
+				if (candidate->dedicated || candidate->memoryTypeIndex != memoryTypeIndex || candidate->linear != linear) continue;
+				offset = candidate->ranges.allocate(requirements.size, requirements.alignment);
+				if (offset != LthRangeAllocator::INVALID_OFFSET) {
+					block = candidate.get();
+					break;
+				}
+			}
+
+			if (!block) {
+				block = createBlock(memoryTypeIndex, blockSize, linear, false, VK_NULL_HANDLE, VK_NULL_HANDLE);
+				if (!block) {
+					// The heap may be too fragmented or too full for a whole block, try a block fitting the request only.
+					block = createBlock(memoryTypeIndex, requirements.size, linear, false, VK_NULL_HANDLE, VK_NULL_HANDLE);
+				}
+				if (!block) {
+					throw std::runtime_error("Failed to allocate device memory block!");
+				}
+				offset = block->ranges.allocate(requirements.size, requirements.alignment);
+			}
+		}
+		assert(offset != LthRangeAllocator::INVALID_OFFSET && "Memory block too small for its allocation!");
+
+		LthAllocation allocation{};
+		allocation.memory = block->memory;
+		allocation.offset = offset;
+		allocation.size = requirements.size;
+		allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + offset : nullptr;
+		allocation.memoryTypeIndex = memoryTypeIndex;
+		allocation.block = block;
+		return allocation;
+	}
+
+	void LthMemoryAllocator::free(LthAllocation& allocation) {
+		if (!allocation.isValid()) return;
+
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		LthMemoryBlock* block = allocation.block;
+		block->ranges.free(allocation.offset);
+		allocation = LthAllocation{};
+
+		if (!block->ranges.isEmpty()) return;
+		if (block->dedicated) {
+			destroyBlock(block);
+			return;
+		}
+
+		// Keep the last block of a kind alive so that alternating create/destroy patterns don't hit the driver each time.
+		for (auto& other : blocks) {
+			if (other.get() != block && !other->dedicated &&
+				other->memoryTypeIndex == block->memoryTypeIndex && other->linear == block->linear) {
+				destroyBlock(block);
+				return;
+			}
+		}
+	}
+
+	LthMemoryBlock* LthMemoryAllocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool linear, bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage) {
+		VkMemoryDedicatedAllocateInfo dedicatedInfo{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+		dedicatedInfo.buffer = dedicatedBuffer;
+		dedicatedInfo.image = dedicatedImage;
+
+		VkMemoryAllocateFlagsInfo allocFlagsInfo{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO };
+		allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+		if (dedicatedBuffer != VK_NULL_HANDLE || dedicatedImage != VK_NULL_HANDLE) {
+			allocFlagsInfo.pNext = &dedicatedInfo;
+		}
+
+		VkMemoryAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+		allocInfo.pNext = &allocFlagsInfo;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+			return nullptr;
+		}
+
+		void* mapped = nullptr;
+		if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+				vkFreeMemory(device, memory, nullptr);
+				return nullptr;
+			}
+		}
+
+		blocks.push_back(std::make_unique<LthMemoryBlock>(memory, size, memoryTypeIndex, linear, dedicated, mapped));
+		return blocks.back().get();
+	}
+
+	void LthMemoryAllocator::destroyBlock(LthMemoryBlock* block) {
+		if (block->mapped) {
+			vkUnmapMemory(device, block->memory);
+		}
+		vkFreeMemory(device, block->memory, nullptr);
+
+		blocks.erase(std::find_if(blocks.begin(), blocks.end(),
+			[block](const std::unique_ptr<LthMemoryBlock>& candidate) { return candidate.get() == block; }));
+	}
+
+	VkDeviceSize LthMemoryAllocator::preferredBlockSize(uint32_t memoryTypeIndex) const {
+		VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+		// Small heaps (e.g. the 256MB host visible device local heap) would be exhausted by a few default blocks.
+		if (heapSize <= 1024ull * 1024 * 1024) {
+			return std::min(DEFAULT_BLOCK_SIZE, heapSize / 8);
+		}
+		return DEFAULT_BLOCK_SIZE;
+	}
+
+	VkMappedMemoryRange LthMemoryAllocator::mappedRange(const LthAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const {
+		if (size == VK_WHOLE_SIZE) {
+			size = allocation.size - offset;
+		}
+		// Ranges of non coherent memory must be aligned on nonCoherentAtomSize, and must not overflow the block.
+		VkDeviceSize begin = (allocation.offset + offset) / nonCoherentAtomSize * nonCoherentAtomSize;
+		VkDeviceSize end = (allocation.offset + offset + size + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize;
+		end = std::min(end, allocation.block->size);
+
+		VkMappedMemoryRange range{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+		range.memory = allocation.memory;
+		range.offset = begin;
+		range.size = (end == allocation.block->size) ? VK_WHOLE_SIZE : end - begin;
+		return range;
+	}
+
+	VkResult LthMemoryAllocator::flush(const LthAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) {
+		assert(allocation.isValid() && "Flushing an invalid allocation!");
+		VkMappedMemoryRange range = mappedRange(allocation, size, offset);
+		return vkFlushMappedMemoryRanges(device, 1, &range);
+	}
+
+	VkResult LthMemoryAllocator::invalidate(const LthAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) {
+		assert(allocation.isValid() && "Invalidating an invalid allocation!");
+		VkMappedMemoryRange range = mappedRange(allocation, size, offset);
+		return vkInvalidateMappedMemoryRanges(device, 1, &range);
+	}
+
+	uint32_t LthMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) &&
+				(memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		throw std::runtime_error("Failed to find suitable memory type!");
+	}
+
+	std::vector<LthMemoryHeapStats> LthMemoryAllocator::getHeapStats() {
+		std::vector<LthMemoryHeapStats> stats(memoryProperties.memoryHeapCount);
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+			stats[i].heapSize = memoryProperties.memoryHeaps[i].size;
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		for (auto& block : blocks) {
+			LthMemoryHeapStats& heapStats = stats[memoryProperties.memoryTypes[block->memoryTypeIndex].heapIndex];
+			heapStats.reservedBytes += block->size;
+			heapStats.usedBytes += block->ranges.getUsedSize();
+			heapStats.blockCount++;
+			heapStats.allocationCount += block->ranges.getAllocationCount();
+		}
+		return stats;
+	}
+}
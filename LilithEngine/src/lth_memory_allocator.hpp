@@ -0,0 +1,88 @@
+#ifndef __LTH_MEMORY_ALLOCATOR_HPP__
+#define __LTH_MEMORY_ALLOCATOR_HPP__
+
+#include "lth_compile_options.hpp"
+#include "lth_range_allocator.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lth {
+
+	class LthMemoryBlock;
+
+	// A sub-allocation inside one of the allocator's device memory blocks.
+	struct LthAllocation {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr; // Persistent mapping of the allocation start, only for host visible memory.
+		uint32_t memoryTypeIndex = 0;
+		LthMemoryBlock* block = nullptr;
+
+		bool isValid() const { return block != nullptr; }
+	};
+
+	struct LthMemoryHeapStats {
+		VkDeviceSize heapSize = 0;
+		VkDeviceSize reservedBytes = 0; // Bytes allocated from the driver.
+		VkDeviceSize usedBytes = 0; // Bytes handed out to resources.
+		uint32_t blockCount = 0;
+		uint32_t allocationCount = 0;
+	};
+
+	class LthMemoryBlock {
+	public:
+		LthMemoryBlock(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, bool linear, bool dedicated, void* mapped);
+
+		VkDeviceMemory memory;
+		VkDeviceSize size;
+		uint32_t memoryTypeIndex;
+		bool linear;
+		bool dedicated;
+		void* mapped;
+		LthRangeAllocator ranges;
+	};
+
+	// Sub-allocates resources from large per memory type blocks instead of calling vkAllocateMemory for each of them.
+	// Linear (buffers) and optimal (images) resources live in separate blocks when bufferImageGranularity requires it.
+	class LthMemoryAllocator {
+	public:
+		static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+		LthMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+		~LthMemoryAllocator();
+
+		LthMemoryAllocator(const LthMemoryAllocator&) = delete;
+		LthMemoryAllocator& operator=(const LthMemoryAllocator&) = delete;
+
+		LthAllocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, VkDeviceSize minAlignment = 1);
+		LthAllocation allocateForImage(VkImage image, VkMemoryPropertyFlags properties, bool linearTiling);
+		void free(LthAllocation& allocation);
+
+		VkResult flush(const LthAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+		VkResult invalidate(const LthAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+		const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties; }
+		std::vector<LthMemoryHeapStats> getHeapStats();
+
+	private:
+		LthAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage);
+		LthMemoryBlock* createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool linear, bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage);
+		void destroyBlock(LthMemoryBlock* block);
+		VkDeviceSize preferredBlockSize(uint32_t memoryTypeIndex) const;
+		VkMappedMemoryRange mappedRange(const LthAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const;
+
+		VkDevice device;
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+		VkDeviceSize bufferImageGranularity;
+		VkDeviceSize nonCoherentAtomSize;
+
+		std::mutex mutex;
+		std::vector<std::unique_ptr<LthMemoryBlock>> blocks{};
+	};
+}
+
+#endif
@@ -0,0 +1,203 @@
+#include "lth_mesh_cache.hpp"
+#include "lth_utils.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace lth {
+
+	namespace {
+
+		struct SourceStamp {
+			uint64_t size;
+			int64_t writeTime;
+		};
+
+		bool getSourceStamp(const std::string& sourcePath, SourceStamp& stamp) {
+			std::error_code error;
+			stamp.size = std::filesystem::file_size(sourcePath, error);
+			if (error) return false;
+			stamp.writeTime = static_cast<int64_t>(std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count());
+			return !error;
+		}
+
+		bool hashSource(const std::string& sourcePath, uint64_t& hash) {
+			LthMappedFile source{};
+			if (!source.open(sourcePath)) return false;
+			hash = fnv1a(source.data(), source.size());
+			return true;
+		}
+
+		uint32_t getVertexStride(LthVertexFormat vertexFormat) {
+			return vertexFormat == LTH_VERTEX_FORMAT_PACKED ? sizeof(LthModel::PackedVertex) : sizeof(LthModel::Vertex);
+		}
+
+		uint64_t getIndexSize(uint32_t indexType) {
+			return indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+		}
+
+		uint64_t alignBlobOffset(uint64_t offset) {
+			return (offset + 15) & ~15ull;
+		}
+	}
+
+	bool LthMeshCache::open(const std::string& sourcePath, LthVertexFormat vertexFormat, uint32_t flags, uint64_t lodSettingsHash) {
+		header = nullptr;
+		file.close();
+
+		SourceStamp stamp{};
+		if (!getSourceStamp(sourcePath, stamp) || !file.open(getCachePath(sourcePath))) {
+			return false;
+		}
+
+		const LthMeshFileHeader* candidate = reinterpret_cast<const LthMeshFileHeader*>(file.data());
+		bool valid = file.size() >= sizeof(LthMeshFileHeader)
+			&& candidate->magic == MAGIC
+			&& candidate->version == VERSION
+			&& candidate->flags == flags
+			&& candidate->vertexFormat == vertexFormat
+			&& candidate->vertexStride == getVertexStride(vertexFormat)
+			&& (candidate->indexType == VK_INDEX_TYPE_UINT16 || candidate->indexType == VK_INDEX_TYPE_UINT32)
+			&& candidate->vertexDataOffset + uint64_t{ candidate->vertexCount } * candidate->vertexStride <= file.size()
+			&& candidate->indexDataOffset + uint64_t{ candidate->indexCount } * getIndexSize(candidate->indexType) <= file.size()
+			&& candidate->lodDataOffset + uint64_t{ candidate->lodCount } * sizeof(LthModel::Lod) <= file.size()
+			&& candidate->meshletDataOffset + uint64_t{ candidate->meshletCount } * sizeof(LthMeshlet) <= file.size()
+			&& candidate->lodSettingsHash == lodSettingsHash
+			&& candidate->sourceSize == stamp.size;
+
+		if (valid) {
+			const LthModel::Lod* lods = reinterpret_cast<const LthModel::Lod*>(file.data() + candidate->lodDataOffset);
+			for (uint32_t i = 0; i < candidate->lodCount && valid; ++i) {
+				valid = uint64_t{ lods[i].firstIndex } + lods[i].indexCount <= candidate->indexCount;
+			}
+			const LthMeshlet* meshlets = reinterpret_cast<const LthMeshlet*>(file.data() + candidate->meshletDataOffset);
+			for (uint32_t i = 0; i < candidate->meshletCount && valid; ++i) {
+				valid = uint64_t{ meshlets[i].firstIndex } + meshlets[i].indexCount <= candidate->indexCount;
+			}
+		}
+
+		if (valid && candidate->sourceWriteTime != stamp.writeTime) {
+			uint64_t sourceHash = 0;
+			valid = hashSource(sourcePath, sourceHash) && sourceHash == candidate->sourceHash;
+			if (valid) {
+				// Same content under a new write time: the stamp is updated so that the next loads skip the hash. The mapping
+				// does not share writes, it is reopened afterwards.
+				file.close();
+				updateSourceWriteTime(getCachePath(sourcePath), stamp.writeTime);
+				if (!file.open(getCachePath(sourcePath)) || file.size() < sizeof(LthMeshFileHeader)) {
+					file.close();
+					return false;
+				}
+				candidate = reinterpret_cast<const LthMeshFileHeader*>(file.data());
+			}
+		}
+
+		if (!valid) {
+			file.close();
+			return false;
+		}
+		header = candidate;
+		return true;
+	}
+
+	bool LthMeshCache::updateSourceWriteTime(const std::string& cachePath, int64_t sourceWriteTime) {
+		std::fstream cacheFile{ cachePath, std::ios::binary | std::ios::in | std::ios::out };
+		if (!cacheFile.is_open()) return false;
+		cacheFile.seekp(offsetof(LthMeshFileHeader, sourceWriteTime));
+		cacheFile.write(reinterpret_cast<const char*>(&sourceWriteTime), sizeof(sourceWriteTime));
+		return cacheFile.good();
+	}
+
+	LthModel::MeshData LthMeshCache::getMeshData() const {
+		LthModel::MeshData meshData{};
+		meshData.vertexFormat = static_cast<LthVertexFormat>(header->vertexFormat);
+		meshData.vertices = file.data() + header->vertexDataOffset;
+		meshData.vertexCount = header->vertexCount;
+		meshData.vertexStride = header->vertexStride;
+		meshData.indices = file.data() + header->indexDataOffset;
+		meshData.indexCount = header->indexCount;
+		meshData.indexType = static_cast<VkIndexType>(header->indexType);
+		meshData.bounds.aabbMin = { header->aabbMin[0], header->aabbMin[1], header->aabbMin[2] };
+		meshData.bounds.aabbMax = { header->aabbMax[0], header->aabbMax[1], header->aabbMax[2] };
+		meshData.bounds.sphereCenter = { header->sphereCenter[0], header->sphereCenter[1], header->sphereCenter[2] };
+		meshData.bounds.sphereRadius = header->sphereRadius;
+		meshData.lods = reinterpret_cast<const LthModel::Lod*>(file.data() + header->lodDataOffset);
+		meshData.lodCount = header->lodCount;
+		meshData.meshlets = reinterpret_cast<const LthMeshlet*>(file.data() + header->meshletDataOffset);
+		meshData.meshletCount = header->meshletCount;
+		return meshData;
+	}
+
+	bool LthMeshCache::write(const std::string& sourcePath, const LthModel::MeshData& meshData, uint32_t flags, uint64_t lodSettingsHash) {
+		SourceStamp stamp{};
+		uint64_t sourceHash = 0;
+		if (!getSourceStamp(sourcePath, stamp) || !hashSource(sourcePath, sourceHash)) {
+			return false;
+		}
+
+		LthMeshFileHeader fileHeader{};
+		fileHeader.magic = MAGIC;
+		fileHeader.version = VERSION;
+		fileHeader.sourceHash = sourceHash;
+		fileHeader.sourceSize = stamp.size;
+		fileHeader.sourceWriteTime = stamp.writeTime;
+		fileHeader.flags = flags;
+		fileHeader.vertexFormat = meshData.vertexFormat;
+		fileHeader.vertexStride = meshData.vertexStride;
+		fileHeader.vertexCount = meshData.vertexCount;
+		fileHeader.indexType = static_cast<uint32_t>(meshData.indexType);
+		fileHeader.indexCount = meshData.indexCount;
+		for (int i = 0; i < 3; ++i) {
+			fileHeader.aabbMin[i] = meshData.bounds.aabbMin[i];
+			fileHeader.aabbMax[i] = meshData.bounds.aabbMax[i];
+			fileHeader.sphereCenter[i] = meshData.bounds.sphereCenter[i];
+		}
+		fileHeader.sphereRadius = meshData.bounds.sphereRadius;
+		fileHeader.lodCount = meshData.lodCount;
+		fileHeader.lodSettingsHash = lodSettingsHash;
+		fileHeader.meshletCount = meshData.meshletCount;
+
+		uint64_t vertexDataSize = uint64_t{ meshData.vertexCount } * meshData.vertexStride;
+		uint64_t indexDataSize = uint64_t{ meshData.indexCount } * getIndexSize(meshData.indexType);
+		fileHeader.vertexDataOffset = alignBlobOffset(sizeof(LthMeshFileHeader));
+		fileHeader.indexDataOffset = alignBlobOffset(fileHeader.vertexDataOffset + vertexDataSize);
+		uint64_t lodDataSize = uint64_t{ meshData.lodCount } * sizeof(LthModel::Lod);
+		fileHeader.lodDataOffset = alignBlobOffset(fileHeader.indexDataOffset + indexDataSize);
+		uint64_t meshletDataSize = uint64_t{ meshData.meshletCount } * sizeof(LthMeshlet);
+		fileHeader.meshletDataOffset = alignBlobOffset(fileHeader.lodDataOffset + lodDataSize);
+
+		std::string cachePath = getCachePath(sourcePath);
+		std::string temporaryPath = cachePath + ".tmp";
+		{
+			std::ofstream cacheFile{ temporaryPath, std::ios::binary | std::ios::trunc };
+			if (!cacheFile.is_open()) return false;
+
+			const char padding[16]{};
+			cacheFile.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+			cacheFile.write(padding, fileHeader.vertexDataOffset - sizeof(fileHeader));
+			cacheFile.write(static_cast<const char*>(meshData.vertices), vertexDataSize);
+			cacheFile.write(padding, fileHeader.indexDataOffset - fileHeader.vertexDataOffset - vertexDataSize);
+			cacheFile.write(static_cast<const char*>(meshData.indices), indexDataSize);
+			cacheFile.write(padding, fileHeader.lodDataOffset - fileHeader.indexDataOffset - indexDataSize);
+			cacheFile.write(reinterpret_cast<const char*>(meshData.lods), lodDataSize);
+			cacheFile.write(padding, fileHeader.meshletDataOffset - fileHeader.lodDataOffset - lodDataSize);
+			cacheFile.write(reinterpret_cast<const char*>(meshData.meshlets), meshletDataSize);
+			if (!cacheFile.good()) {
+				cacheFile.close();
+				std::error_code error;
+				std::filesystem::remove(temporaryPath, error);
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, cachePath, error);
+		if (error) {
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef __LTH_MESH_CACHE_HPP__
+#define __LTH_MESH_CACHE_HPP__
+
+#include "lth_model.hpp"
+#include "lth_mapped_file.hpp"
+
+#include <string>
+
+namespace lth {
+
+	enum LthMeshFileFlags : uint32_t {
+		LTH_MESH_FILE_FLAG_OPTIMIZED_INDEX_ORDER = 1u << 0, // The indices were reordered for the vertex cache.
+		LTH_MESH_FILE_FLAG_LODS = 1u << 1, // The index blob holds a LOD chain, generated with the settings of lodSettingsHash.
+		LTH_MESH_FILE_FLAG_MESHLETS = 1u << 2, // LOD 0 was split into meshlets.
+	};
+
+	// Header of a .lthmesh file, followed by the vertex and index blobs in their device layout, the LOD table and the
+	// meshlets (16 bytes aligned).
+	// The source is identified by its size and write time, and by a FNV-1a hash of its content when the time differs
+	// (fresh checkout, copy...).
+	struct LthMeshFileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceHash;
+		uint64_t sourceSize;
+		int64_t sourceWriteTime;
+		uint32_t flags;
+		uint32_t vertexFormat;
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexType;
+		uint32_t indexCount;
+		uint64_t vertexDataOffset;
+		uint64_t indexDataOffset;
+		float aabbMin[3];
+		float aabbMax[3];
+		float sphereCenter[3];
+		float sphereRadius;
+		uint32_t lodCount;
+		uint32_t meshletCount;
+		uint64_t lodDataOffset;
+		uint64_t meshletDataOffset;
+		uint64_t lodSettingsHash;
+	};
+
+	// Binary cache of a model source file, written next to it. A valid cache is memory mapped and its blobs are copied
+	// straight into the staging buffers, without any parsing.
+	class LthMeshCache {
+	public:
+		static constexpr uint32_t MAGIC = 0x4d48544c; // "LTHM"
+		static constexpr uint32_t VERSION = 3;
+
+		static std::string getCachePath(const std::string& sourcePath) { return sourcePath + ".lthmesh"; }
+
+		// Maps the cache of the source if it was written from this very source, in this vertex format and with these flags.
+		bool open(const std::string& sourcePath, LthVertexFormat vertexFormat, uint32_t flags = 0, uint64_t lodSettingsHash = 0);
+		// Points into the mapping, valid while the cache stays open.
+		LthModel::MeshData getMeshData() const;
+		uint32_t getFlags() const { return header->flags; }
+
+		// Writes through a temporary file, so that a cache is never left half written. The cache being optional, a failure
+		// is only reported by the return value.
+		static bool write(const std::string& sourcePath, const LthModel::MeshData& meshData, uint32_t flags = 0, uint64_t lodSettingsHash = 0);
+
+	private:
+		// Rewrites the write time stamp of a cache in place, the cache must not be mapped.
+		static bool updateSourceWriteTime(const std::string& cachePath, int64_t sourceWriteTime);
+
+		LthMappedFile file{};
+		const LthMeshFileHeader* header = nullptr;
+	};
+}
+
+#endif
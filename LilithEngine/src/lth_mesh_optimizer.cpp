@@ -0,0 +1,281 @@
+#include "lth_mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace lth {
+
+	namespace {
+
+		// Post-transform FIFO cache: a vertex is a hit if it entered the cache in the last cacheSize misses.
+		class VertexCacheSimulation {
+		public:
+			VertexCacheSimulation(size_t vertexCount, uint32_t cacheSize) : cacheSize{ cacheSize }, entryTimes(vertexCount, 0) {}
+
+			// Returns true on a miss.
+			bool access(uint32_t vertex) {
+				if (time - entryTimes[vertex] < cacheSize) return false;
+				entryTimes[vertex] = time++;
+				return true;
+			}
+
+			uint32_t accessTriangle(const uint32_t* triangle) {
+				return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+			}
+
+			void flush() { time += cacheSize; }
+
+		private:
+			uint32_t cacheSize;
+			uint64_t time = ~0ull / 2; // Far enough from the initial entry times for every vertex to miss first.
+			std::vector<uint64_t> entryTimes;
+		};
+
+		// Triangles using each vertex, in CSR form.
+		struct VertexTriangles {
+			std::vector<uint32_t> offsets;
+			std::vector<uint32_t> triangles;
+
+			VertexTriangles(const std::vector<uint32_t>& indices, size_t vertexCount) : offsets(vertexCount + 1, 0), triangles(indices.size()) {
+				for (uint32_t index : indices) {
+					offsets[index + 1]++;
+				}
+				std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+				std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+				for (size_t i = 0; i < indices.size(); ++i) {
+					triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+		};
+	}
+
+	LthMeshOptimizer::Statistics LthMeshOptimizer::analyze(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t vertexSize, uint32_t cacheSize) {
+		Statistics statistics{};
+		if (indices.size() < 3 || vertexCount == 0) return statistics;
+
+		// Vertices are fetched on post-transform misses, through a small cache of 64 bytes lines (4 KB, FIFO).
+		constexpr uint64_t LINE_SIZE = 64;
+		constexpr uint32_t LINE_CACHE_SIZE = 64;
+		VertexCacheSimulation transformCache{ vertexCount, cacheSize };
+		VertexCacheSimulation lineCache{ (vertexCount * vertexSize + LINE_SIZE - 1) / LINE_SIZE, LINE_CACHE_SIZE };
+		std::vector<bool> used(vertexCount, false);
+
+		uint64_t transforms = 0;
+		uint64_t fetchedLines = 0;
+		size_t usedVertexCount = 0;
+		for (uint32_t index : indices) {
+			if (!used[index]) {
+				used[index] = true;
+				usedVertexCount++;
+			}
+			if (!transformCache.access(index)) continue;
+			transforms++;
+
+			uint64_t firstLine = uint64_t{ index } * vertexSize / LINE_SIZE;
+			uint64_t lastLine = (uint64_t{ index } * vertexSize + vertexSize - 1) / LINE_SIZE;
+			for (uint64_t line = firstLine; line <= lastLine; ++line) {
+				fetchedLines += lineCache.access(static_cast<uint32_t>(line));
+			}
+		}
+
+		statistics.acmr = static_cast<float>(transforms) / static_cast<float>(indices.size() / 3);
+		statistics.atvr = static_cast<float>(transforms) / static_cast<float>(usedVertexCount);
+		statistics.overfetch = static_cast<float>(fetchedLines * LINE_SIZE) / static_cast<float>(usedVertexCount * vertexSize);
+		return statistics;
+	}
+
+	void LthMeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) return;
+
+		VertexTriangles vertexTriangles{ indices, vertexCount };
+		std::vector<uint32_t> liveTriangles(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+			liveTriangles[vertex] = vertexTriangles.offsets[vertex + 1] - vertexTriangles.offsets[vertex];
+		}
+
+		std::vector<uint64_t> cacheTimes(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEnds{};
+		std::vector<uint32_t> candidates{};
+		std::vector<uint32_t> output{};
+		output.reserve(indices.size());
+		uint64_t time = cacheSize + 1;
+		size_t cursor = 0;
+
+		// Next vertex to fan around: among the candidates that still have triangles, the oldest one whose fan would not
+		// push it out of the cache. Falls back on the dead-end stack, then on the input order.
+		auto nextVertex = [&]() -> int64_t {
+			int64_t best = -1;
+			int64_t bestPriority = -1;
+			for (uint32_t vertex : candidates) {
+				if (liveTriangles[vertex] == 0) continue;
+				int64_t priority = 0;
+				if (time - cacheTimes[vertex] + 2 * uint64_t{ liveTriangles[vertex] } <= cacheSize) {
+					priority = static_cast<int64_t>(time - cacheTimes[vertex]);
+				}
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					best = vertex;
+				}
+			}
+			if (best >= 0) return best;
+
+			while (!deadEnds.empty()) {
+				uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[vertex] > 0) return vertex;
+			}
+			while (cursor < vertexCount) {
+				if (liveTriangles[cursor] > 0) return static_cast<int64_t>(cursor);
+				cursor++;
+			}
+			return -1;
+		};
+
+		int64_t fanVertex = 0;
+		while (fanVertex >= 0) {
+			candidates.clear();
+			uint32_t begin = vertexTriangles.offsets[fanVertex];
+			uint32_t end = vertexTriangles.offsets[fanVertex + 1];
+			for (uint32_t i = begin; i < end; ++i) {
+				uint32_t triangle = vertexTriangles.triangles[i];
+				if (emitted[triangle]) continue;
+				emitted[triangle] = true;
+
+				for (uint32_t corner = 0; corner < 3; ++corner) {
+					uint32_t vertex = indices[3 * triangle + corner];
+					output.push_back(vertex);
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+					if (time - cacheTimes[vertex] > cacheSize) {
+						cacheTimes[vertex] = time++;
+					}
+				}
+			}
+			fanVertex = nextVertex();
+		}
+
+		indices.swap(output);
+	}
+
+	void LthMeshOptimizer::optimizeOverdraw(
+		std::vector<uint32_t>& indices,
+		const glm::vec3* positions, size_t positionStride, size_t vertexCount,
+		float threshold, uint32_t cacheSize) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount < 2) return;
+
+		auto position = [positions, positionStride](uint32_t vertex) -> const glm::vec3& {
+			return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const uint8_t*>(positions) + positionStride * vertex);
+		};
+
+		// Hard boundaries: triangles that miss on all their vertices, where the cache order jumped anyway.
+		std::vector<uint32_t> hardClusters{};
+		{
+			VertexCacheSimulation cache{ vertexCount, cacheSize };
+			for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+				if (cache.accessTriangle(&indices[3 * triangle]) == 3) {
+					hardClusters.push_back(static_cast<uint32_t>(triangle));
+				}
+			}
+			if (hardClusters.empty() || hardClusters[0] != 0) {
+				hardClusters.insert(hardClusters.begin(), 0);
+			}
+		}
+
+		// Soft boundaries: a hard cluster is cut again as soon as its beginning has an ACMR within the threshold of the
+		// whole cluster's, which costs a few more misses (the cache restarts cold) for more freedom in the sort.
+		std::vector<uint32_t> clusters{};
+		VertexCacheSimulation cache{ vertexCount, cacheSize };
+		for (size_t hardCluster = 0; hardCluster < hardClusters.size(); ++hardCluster) {
+			uint32_t begin = hardClusters[hardCluster];
+			uint32_t end = hardCluster + 1 < hardClusters.size() ? hardClusters[hardCluster + 1] : static_cast<uint32_t>(triangleCount);
+
+			cache.flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t triangle = begin; triangle < end; ++triangle) {
+				clusterMisses += cache.accessTriangle(&indices[3 * triangle]);
+			}
+			float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+			cache.flush();
+			clusters.push_back(begin);
+			uint32_t softBegin = begin;
+			uint32_t softMisses = 0;
+			for (uint32_t triangle = begin; triangle < end; ++triangle) {
+				softMisses += cache.accessTriangle(&indices[3 * triangle]);
+				if (triangle + 1 < end && static_cast<float>(softMisses) / static_cast<float>(triangle + 1 - softBegin) <= clusterThreshold) {
+					clusters.push_back(triangle + 1);
+					softBegin = triangle + 1;
+					softMisses = 0;
+					cache.flush();
+				}
+			}
+		}
+
+		// Sort key: how much the cluster faces away from the mesh center, the outer surfaces are drawn first.
+		glm::vec3 meshCenter{ 0.f };
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+			meshCenter += position(static_cast<uint32_t>(vertex));
+		}
+		meshCenter /= static_cast<float>(std::max<size_t>(vertexCount, 1));
+
+		std::vector<float> sortKeys(clusters.size());
+		for (size_t cluster = 0; cluster < clusters.size(); ++cluster) {
+			uint32_t begin = clusters[cluster];
+			uint32_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : static_cast<uint32_t>(triangleCount);
+
+			glm::vec3 centroid{ 0.f };
+			glm::vec3 normal{ 0.f }; // Area weighted.
+			float area = 0.f;
+			for (uint32_t triangle = begin; triangle < end; ++triangle) {
+				const glm::vec3& p0 = position(indices[3 * triangle]);
+				const glm::vec3& p1 = position(indices[3 * triangle + 1]);
+				const glm::vec3& p2 = position(indices[3 * triangle + 2]);
+				glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+				float triangleArea = glm::length(triangleNormal);
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+				normal += triangleNormal;
+				area += triangleArea;
+			}
+
+			float normalLength = glm::length(normal);
+			if (area <= 0.f || normalLength <= 0.f) {
+				sortKeys[cluster] = 0.f;
+				continue;
+			}
+			sortKeys[cluster] = glm::dot(centroid / area - meshCenter, normal / normalLength);
+		}
+
+		std::vector<uint32_t> clusterOrder(clusters.size());
+		std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+		std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> output{};
+		output.reserve(indices.size());
+		for (uint32_t cluster : clusterOrder) {
+			uint32_t begin = clusters[cluster];
+			uint32_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : static_cast<uint32_t>(triangleCount);
+			output.insert(output.end(), indices.begin() + 3 * size_t{ begin }, indices.begin() + 3 * size_t{ end });
+		}
+		indices.swap(output);
+	}
+
+	std::vector<uint32_t> LthMeshOptimizer::optimizeVertexFetchRemap(std::vector<uint32_t>& indices, size_t vertexCount) {
+		constexpr uint32_t UNUSED = ~0u;
+		std::vector<uint32_t> remap(vertexCount, UNUSED);
+		uint32_t nextVertex = 0;
+		for (uint32_t& index : indices) {
+			if (remap[index] == UNUSED) {
+				remap[index] = nextVertex++;
+			}
+			index = remap[index];
+		}
+		for (uint32_t& newIndex : remap) {
+			if (newIndex == UNUSED) newIndex = nextVertex++;
+		}
+		return remap;
+	}
+}
@@ -0,0 +1,356 @@
+#include "lth_mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+
+namespace lth {
+
+	namespace {
+
+		// Symmetric 4x4 quadric of the squared distances to a set of weighted planes: Q(p) = pT A p + 2 bT p + c.
+		struct Quadric {
+			double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+			double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+			double c = 0.0;
+			double weight = 0.0;
+
+			static Quadric fromPlane(const glm::dvec3& normal, double distance, double weight) {
+				Quadric quadric{};
+				quadric.a00 = weight * normal.x * normal.x;
+				quadric.a01 = weight * normal.x * normal.y;
+				quadric.a02 = weight * normal.x * normal.z;
+				quadric.a11 = weight * normal.y * normal.y;
+				quadric.a12 = weight * normal.y * normal.z;
+				quadric.a22 = weight * normal.z * normal.z;
+				quadric.b0 = weight * normal.x * distance;
+				quadric.b1 = weight * normal.y * distance;
+				quadric.b2 = weight * normal.z * distance;
+				quadric.c = weight * distance * distance;
+				quadric.weight = weight;
+				return quadric;
+			}
+
+			Quadric& operator+=(const Quadric& other) {
+				a00 += other.a00; a01 += other.a01; a02 += other.a02;
+				a11 += other.a11; a12 += other.a12; a22 += other.a22;
+				b0 += other.b0; b1 += other.b1; b2 += other.b2;
+				c += other.c;
+				weight += other.weight;
+				return *this;
+			}
+
+			double evaluate(const glm::dvec3& p) const {
+				return a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+					+ 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+					+ 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z)
+					+ c;
+			}
+		};
+
+		// Candidate collapse of a position group onto another, outdated as soon as one of them changed.
+		struct Collapse {
+			double cost;
+			uint32_t from;
+			uint32_t to;
+			uint32_t fromVersion;
+			uint32_t toVersion;
+
+			bool operator>(const Collapse& other) const { return cost > other.cost; }
+		};
+
+		constexpr double BORDER_WEIGHT = 10.0; // Border constraint planes over the face planes.
+		constexpr double MIN_FLIP_COSINE = 0.25; // Collapses may turn a triangle by 75 degrees at most.
+	}
+
+	std::vector<LthMeshSimplifier::Lod> LthMeshSimplifier::generateLods(const std::vector<uint32_t>& indices, const VertexStreams& vertices, const Settings& settings) {
+		std::vector<Lod> lods{};
+		size_t triangleCount = indices.size() / 3;
+		size_t vertexCount = vertices.vertexCount;
+		if (triangleCount == 0 || vertexCount == 0 || vertices.positions == nullptr || settings.maxLodCount < 2) return lods;
+
+		auto attribute = [&vertices](const auto* stream, uint32_t vertex) -> const auto& {
+			return *reinterpret_cast<decltype(stream)>(reinterpret_cast<const uint8_t*>(stream) + vertices.stride * vertex);
+		};
+
+		// Position groups: the vertices sorted by position, a group per run of equal positions.
+		std::vector<uint32_t> groupVertices(vertexCount);
+		std::iota(groupVertices.begin(), groupVertices.end(), 0);
+		std::sort(groupVertices.begin(), groupVertices.end(), [&](uint32_t a, uint32_t b) {
+			const glm::vec3& pa = attribute(vertices.positions, a);
+			const glm::vec3& pb = attribute(vertices.positions, b);
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			return pa.z < pb.z;
+			});
+
+		std::vector<uint32_t> vertexGroups(vertexCount);
+		std::vector<uint32_t> groupOffsets{};
+		std::vector<glm::dvec3> groupPositions{};
+		glm::vec3 aabbMin{ attribute(vertices.positions, groupVertices[0]) };
+		glm::vec3 aabbMax{ aabbMin };
+		for (size_t i = 0; i < vertexCount; ++i) {
+			const glm::vec3& position = attribute(vertices.positions, groupVertices[i]);
+			if (i == 0 || position != attribute(vertices.positions, groupVertices[i - 1])) {
+				groupOffsets.push_back(static_cast<uint32_t>(i));
+				groupPositions.push_back(glm::dvec3{ position });
+			}
+			vertexGroups[groupVertices[i]] = static_cast<uint32_t>(groupPositions.size() - 1);
+			aabbMin = glm::min(aabbMin, position);
+			aabbMax = glm::max(aabbMax, position);
+		}
+		uint32_t groupCount = static_cast<uint32_t>(groupPositions.size());
+		groupOffsets.push_back(static_cast<uint32_t>(vertexCount));
+		double maxErrorDistance = settings.maxError * glm::length(glm::dvec3{ aabbMax - aabbMin });
+
+		// Collapsed groups point to the group they were moved onto.
+		std::vector<uint32_t> collapsedInto(groupCount);
+		std::iota(collapsedInto.begin(), collapsedInto.end(), 0);
+		auto findGroup = [&collapsedInto](uint32_t group) {
+			while (collapsedInto[group] != group) {
+				collapsedInto[group] = collapsedInto[collapsedInto[group]];
+				group = collapsedInto[group];
+			}
+			return group;
+		};
+		auto triangleGroup = [&](size_t triangle, uint32_t corner) {
+			return findGroup(vertexGroups[indices[3 * triangle + corner]]);
+		};
+
+		// Face quadrics, weighted by the triangle areas. Triangles degenerate in position are dropped from every LOD.
+		std::vector<Quadric> quadrics(groupCount);
+		std::vector<std::vector<uint32_t>> groupTriangles(groupCount);
+		std::vector<bool> triangleAlive(triangleCount, false);
+		size_t aliveTriangleCount = 0;
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+			uint32_t g0 = triangleGroup(triangle, 0);
+			uint32_t g1 = triangleGroup(triangle, 1);
+			uint32_t g2 = triangleGroup(triangle, 2);
+			if (g0 == g1 || g1 == g2 || g2 == g0) continue;
+
+			triangleAlive[triangle] = true;
+			aliveTriangleCount++;
+			for (uint32_t group : { g0, g1, g2 }) {
+				groupTriangles[group].push_back(static_cast<uint32_t>(triangle));
+			}
+
+			glm::dvec3 normal = glm::cross(groupPositions[g1] - groupPositions[g0], groupPositions[g2] - groupPositions[g0]);
+			double length = glm::length(normal);
+			if (length <= 0.0) continue;
+			normal /= length;
+			Quadric quadric = Quadric::fromPlane(normal, -glm::dot(normal, groupPositions[g0]), 0.5 * length);
+			for (uint32_t group : { g0, g1, g2 }) {
+				quadrics[group] += quadric;
+			}
+		}
+
+		// Edges, sorted to find the borders (one triangle) and the non-manifold edges (more than two), whose vertices are locked.
+		struct Edge {
+			uint64_t key;
+			uint32_t triangle;
+		};
+		std::vector<Edge> edges{};
+		edges.reserve(3 * aliveTriangleCount);
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+			if (!triangleAlive[triangle]) continue;
+			for (uint32_t corner = 0; corner < 3; ++corner) {
+				uint32_t a = triangleGroup(triangle, corner);
+				uint32_t b = triangleGroup(triangle, (corner + 1) % 3);
+				edges.push_back({ (uint64_t{ std::min(a, b) } << 32) | std::max(a, b), static_cast<uint32_t>(triangle) });
+			}
+		}
+		std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.key < b.key; });
+
+		std::vector<bool> borderGroups(groupCount, false);
+		std::vector<bool> lockedGroups(groupCount, false);
+		for (size_t begin = 0, end = 0; begin < edges.size(); begin = end) {
+			while (end < edges.size() && edges[end].key == edges[begin].key) end++;
+			uint32_t a = static_cast<uint32_t>(edges[begin].key >> 32);
+			uint32_t b = static_cast<uint32_t>(edges[begin].key & 0xffffffffu);
+
+			if (end - begin > 2) {
+				lockedGroups[a] = lockedGroups[b] = true;
+			}
+			else if (end - begin == 1) {
+				// Constraint plane through the edge, perpendicular to its triangle.
+				size_t triangle = edges[begin].triangle;
+				glm::dvec3 faceNormal = glm::cross(
+					groupPositions[triangleGroup(triangle, 1)] - groupPositions[triangleGroup(triangle, 0)],
+					groupPositions[triangleGroup(triangle, 2)] - groupPositions[triangleGroup(triangle, 0)]);
+				glm::dvec3 edgeVector = groupPositions[b] - groupPositions[a];
+				glm::dvec3 normal = glm::cross(edgeVector, faceNormal);
+				double length = glm::length(normal);
+				borderGroups[a] = borderGroups[b] = true;
+				if (length <= 0.0) continue;
+				normal /= length;
+				Quadric quadric = Quadric::fromPlane(normal, -glm::dot(normal, groupPositions[a]), BORDER_WEIGHT * glm::dot(edgeVector, edgeVector));
+				quadrics[a] += quadric;
+				quadrics[b] += quadric;
+			}
+		}
+
+		// Squared distance to the merged planes, normalized by their weight.
+		auto collapseCost = [&](uint32_t from, uint32_t to) {
+			Quadric quadric = quadrics[from];
+			quadric += quadrics[to];
+			if (quadric.weight <= 0.0) return 0.0;
+			return std::max(quadric.evaluate(groupPositions[to]) / quadric.weight, 0.0);
+		};
+		// A border vertex may only slide along the border.
+		auto canMove = [&](uint32_t from, uint32_t to) {
+			return !lockedGroups[from] && (!borderGroups[from] || borderGroups[to]);
+		};
+
+		std::vector<uint32_t> groupVersions(groupCount, 0);
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses{};
+		auto pushEdge = [&](uint32_t a, uint32_t b) {
+			bool moveA = canMove(a, b);
+			bool moveB = canMove(b, a);
+			if (!moveA && !moveB) return;
+			double costA = moveA ? collapseCost(a, b) : INFINITY;
+			double costB = moveB ? collapseCost(b, a) : INFINITY;
+			if (costA <= costB) {
+				collapses.push({ costA, a, b, groupVersions[a], groupVersions[b] });
+			}
+			else {
+				collapses.push({ costB, b, a, groupVersions[b], groupVersions[a] });
+			}
+		};
+		for (size_t begin = 0, end = 0; begin < edges.size(); begin = end) {
+			while (end < edges.size() && edges[end].key == edges[begin].key) end++;
+			pushEdge(static_cast<uint32_t>(edges[begin].key >> 32), static_cast<uint32_t>(edges[begin].key & 0xffffffffu));
+		}
+		std::vector<Edge>().swap(edges);
+
+		// Rejects the collapse if a remaining triangle of the moved group would flip or degenerate.
+		auto isCollapseValid = [&](uint32_t from, uint32_t to) {
+			const glm::dvec3& target = groupPositions[to];
+			for (uint32_t triangle : groupTriangles[from]) {
+				if (!triangleAlive[triangle]) continue;
+				uint32_t groups[3] = { triangleGroup(triangle, 0), triangleGroup(triangle, 1), triangleGroup(triangle, 2) };
+				if (groups[0] == to || groups[1] == to || groups[2] == to) continue;
+
+				glm::dvec3 before[3]{};
+				glm::dvec3 after[3]{};
+				for (uint32_t corner = 0; corner < 3; ++corner) {
+					before[corner] = groupPositions[groups[corner]];
+					after[corner] = groups[corner] == from ? target : before[corner];
+				}
+				glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				double lengthBefore = glm::length(normalBefore);
+				double lengthAfter = glm::length(normalAfter);
+				if (lengthAfter <= 0.0) return false;
+				if (lengthBefore > 0.0 && glm::dot(normalBefore, normalAfter) < MIN_FLIP_COSINE * lengthBefore * lengthAfter) return false;
+			}
+			return true;
+		};
+
+		auto applyCollapse = [&](uint32_t from, uint32_t to) {
+			collapsedInto[from] = to;
+			quadrics[to] += quadrics[from];
+			borderGroups[to] = borderGroups[to] || borderGroups[from];
+			groupVersions[to]++;
+
+			std::vector<uint32_t>& targetTriangles = groupTriangles[to];
+			for (uint32_t triangle : groupTriangles[from]) {
+				if (!triangleAlive[triangle]) continue;
+				if (triangleGroup(triangle, 0) == triangleGroup(triangle, 1)
+					|| triangleGroup(triangle, 1) == triangleGroup(triangle, 2)
+					|| triangleGroup(triangle, 2) == triangleGroup(triangle, 0)) {
+					triangleAlive[triangle] = false;
+					aliveTriangleCount--;
+				}
+				else {
+					targetTriangles.push_back(triangle);
+				}
+			}
+			std::vector<uint32_t>().swap(groupTriangles[from]);
+			targetTriangles.erase(
+				std::remove_if(targetTriangles.begin(), targetTriangles.end(), [&triangleAlive](uint32_t triangle) { return !triangleAlive[triangle]; }),
+				targetTriangles.end());
+
+			for (uint32_t triangle : targetTriangles) {
+				for (uint32_t corner = 0; corner < 3; ++corner) {
+					uint32_t neighbour = triangleGroup(triangle, corner);
+					if (neighbour != to) pushEdge(to, neighbour);
+				}
+			}
+		};
+
+		// The remaining corners are moved onto the vertex of their group with the closest normal and uv.
+		std::vector<uint32_t> vertexRemap(vertexCount);
+		auto snapshot = [&](float error) {
+			constexpr uint32_t UNMAPPED = ~0u;
+			std::fill(vertexRemap.begin(), vertexRemap.end(), UNMAPPED);
+			auto remapVertex = [&](uint32_t vertex) {
+				if (vertexRemap[vertex] != UNMAPPED) return vertexRemap[vertex];
+				uint32_t group = findGroup(vertexGroups[vertex]);
+				uint32_t best = vertex;
+				if (group != vertexGroups[vertex]) {
+					float bestScore = -INFINITY;
+					for (uint32_t i = groupOffsets[group]; i < groupOffsets[group + 1]; ++i) {
+						uint32_t candidate = groupVertices[i];
+						float score = 0.f;
+						if (vertices.normals != nullptr) {
+							score += glm::dot(attribute(vertices.normals, vertex), attribute(vertices.normals, candidate));
+						}
+						if (vertices.uvs != nullptr) {
+							score -= glm::length(attribute(vertices.uvs, vertex) - attribute(vertices.uvs, candidate));
+						}
+						if (score > bestScore) {
+							bestScore = score;
+							best = candidate;
+						}
+					}
+				}
+				return vertexRemap[vertex] = best;
+			};
+
+			Lod& lod = lods.emplace_back();
+			lod.error = error;
+			lod.indices.reserve(3 * aliveTriangleCount);
+			for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+				if (!triangleAlive[triangle]) continue;
+				for (uint32_t corner = 0; corner < 3; ++corner) {
+					lod.indices.push_back(remapVertex(indices[3 * triangle + corner]));
+				}
+			}
+		};
+
+		// A single collapse sequence, snapshotted each time the triangle count reaches the next target.
+		double error = 0.0;
+		size_t previousTriangleCount = aliveTriangleCount;
+		bool exhausted = false;
+		while (!exhausted && lods.size() + 1 < settings.maxLodCount) {
+			size_t targetTriangleCount = static_cast<size_t>(static_cast<double>(previousTriangleCount) * settings.triangleRatio);
+			while (aliveTriangleCount > targetTriangleCount) {
+				if (collapses.empty()) {
+					exhausted = true;
+					break;
+				}
+				Collapse collapse = collapses.top();
+				collapses.pop();
+				if (findGroup(collapse.from) != collapse.from || findGroup(collapse.to) != collapse.to
+					|| groupVersions[collapse.from] != collapse.fromVersion || groupVersions[collapse.to] != collapse.toVersion) {
+					continue;
+				}
+				if (std::sqrt(collapse.cost) > maxErrorDistance) {
+					exhausted = true;
+					break;
+				}
+				if (!canMove(collapse.from, collapse.to) || !isCollapseValid(collapse.from, collapse.to)) continue;
+
+				applyCollapse(collapse.from, collapse.to);
+				error = std::max(error, std::sqrt(collapse.cost));
+			}
+
+			// A LOD that stopped short of half its reduction is not worth its index memory.
+			if (aliveTriangleCount == 0 || aliveTriangleCount * 2 > previousTriangleCount + targetTriangleCount) break;
+			snapshot(static_cast<float>(error));
+			previousTriangleCount = aliveTriangleCount;
+		}
+		return lods;
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef __LTH_MESH_SIMPLIFIER_HPP__
+#define __LTH_MESH_SIMPLIFIER_HPP__
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace lth {
+
+	// Level of detail chain by quadric edge collapse (Garland and Heckbert 1997). Collapses move a vertex onto one of its
+	// neighbours, so every LOD indexes the vertices of the original mesh and they all share its vertex buffer.
+	// Vertices at the same position (attribute seams) collapse together, each one onto the most similar vertex of the
+	// target position. Borders are kept by constraint planes, collapses that would flip a triangle are rejected.
+	class LthMeshSimplifier {
+	public:
+		struct Settings {
+			uint32_t maxLodCount = 5; // Including the full resolution mesh.
+			float triangleRatio = 0.5f; // Triangle count of a LOD over the one of the previous LOD.
+			float maxError = 0.05f; // Fraction of the mesh extent, coarser LODs are not generated.
+		};
+
+		// Vertex attributes, read with a common stride. Normals and uvs are optional, they only drive the seams.
+		struct VertexStreams {
+			const glm::vec3* positions = nullptr;
+			const glm::vec3* normals = nullptr;
+			const glm::vec2* uvs = nullptr;
+			size_t stride = 0;
+			size_t vertexCount = 0;
+		};
+
+		struct Lod {
+			std::vector<uint32_t> indices{};
+			float error = 0.f; // Object space distance to the full resolution surface (RMS over the collapsed quadrics).
+		};
+
+		// Returns the coarser LODs only, the full resolution mesh being LOD 0.
+		static std::vector<Lod> generateLods(const std::vector<uint32_t>& indices, const VertexStreams& vertices, const Settings& settings);
+	};
+}
+
+#endif
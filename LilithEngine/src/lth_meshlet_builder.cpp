@@ -0,0 +1,114 @@
+#include "lth_meshlet_builder.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lth {
+
+	namespace {
+
+		// Cone axis and cutoff tighter than this are not worth the test (meshoptimizer's threshold).
+		constexpr float MIN_CONE_COSINE = 0.1f;
+
+		void computeMeshletBounds(
+			LthMeshlet& meshlet, const uint32_t* indices,
+			const glm::vec3* positions, size_t positionStride) {
+			auto position = [positions, positionStride](uint32_t vertex) -> const glm::vec3& {
+				return *reinterpret_cast<const glm::vec3*>(reinterpret_cast<const uint8_t*>(positions) + positionStride * vertex);
+			};
+
+			const uint32_t* meshletIndices = indices + meshlet.firstIndex;
+			glm::vec3 aabbMin{ position(meshletIndices[0]) };
+			glm::vec3 aabbMax{ aabbMin };
+			glm::vec3 normalSum{ 0.f };
+			for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+				const glm::vec3& p0 = position(meshletIndices[i]);
+				const glm::vec3& p1 = position(meshletIndices[i + 1]);
+				const glm::vec3& p2 = position(meshletIndices[i + 2]);
+				aabbMin = glm::min(aabbMin, glm::min(p0, glm::min(p1, p2)));
+				aabbMax = glm::max(aabbMax, glm::max(p0, glm::max(p1, p2)));
+
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				float length = glm::length(normal);
+				if (length > 0.f) normalSum += normal / length;
+			}
+
+			// Centered on the box, the radius reaches the farthest vertex.
+			meshlet.center = (aabbMin + aabbMax) * 0.5f;
+			float squaredRadius = 0.f;
+			for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+				glm::vec3 offset = position(meshletIndices[i]) - meshlet.center;
+				squaredRadius = std::max(squaredRadius, glm::dot(offset, offset));
+			}
+			meshlet.radius = std::sqrt(squaredRadius);
+
+			meshlet.coneAxis = glm::vec3{ 0.f };
+			meshlet.coneCutoff = 1.f;
+			float normalSumLength = glm::length(normalSum);
+			if (normalSumLength <= 0.f) return;
+			glm::vec3 axis = normalSum / normalSumLength;
+
+			float minCosine = 1.f;
+			for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+				const glm::vec3& p0 = position(meshletIndices[i]);
+				glm::vec3 normal = glm::cross(position(meshletIndices[i + 1]) - p0, position(meshletIndices[i + 2]) - p0);
+				float length = glm::length(normal);
+				if (length > 0.f) minCosine = std::min(minCosine, glm::dot(axis, normal) / length);
+			}
+			meshlet.coneAxis = axis;
+			if (minCosine > MIN_CONE_COSINE) {
+				meshlet.coneCutoff = std::sqrt(1.f - minCosine * minCosine);
+			}
+		}
+	}
+
+	std::vector<LthMeshlet> LthMeshletBuilder::build(
+		const uint32_t* indices, size_t indexCount,
+		const glm::vec3* positions, size_t positionStride, size_t vertexCount,
+		uint32_t maxVertices, uint32_t maxTriangles) {
+		std::vector<LthMeshlet> meshlets{};
+		if (indexCount < 3) return meshlets;
+
+		// Vertices are marked with the meshlet that last used them.
+		constexpr uint32_t NO_MESHLET = ~0u;
+		std::vector<uint32_t> vertexMeshlets(vertexCount, NO_MESHLET);
+
+		LthMeshlet meshlet{};
+		uint32_t meshletId = 0;
+		auto countNewVertices = [&](size_t firstIndex) {
+			uint32_t newVertexCount = 0;
+			for (uint32_t corner = 0; corner < 3; ++corner) {
+				uint32_t vertex = indices[firstIndex + corner];
+				bool seen = vertexMeshlets[vertex] == meshletId;
+				for (uint32_t previous = 0; previous < corner && !seen; ++previous) {
+					seen = indices[firstIndex + previous] == vertex;
+				}
+				newVertexCount += seen ? 0 : 1;
+			}
+			return newVertexCount;
+		};
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3) {
+			uint32_t newVertexCount = countNewVertices(i);
+			if (meshlet.indexCount > 0
+				&& (meshlet.vertexCount + newVertexCount > maxVertices || meshlet.indexCount / 3 + 1 > maxTriangles)) {
+				computeMeshletBounds(meshlet, indices, positions, positionStride);
+				meshlets.push_back(meshlet);
+				meshlet = LthMeshlet{};
+				meshlet.firstIndex = static_cast<uint32_t>(i);
+				meshletId++;
+				newVertexCount = countNewVertices(i);
+			}
+
+			for (uint32_t corner = 0; corner < 3; ++corner) {
+				vertexMeshlets[indices[i + corner]] = meshletId;
+			}
+			meshlet.vertexCount += newVertexCount;
+			meshlet.indexCount += 3;
+		}
+
+		computeMeshletBounds(meshlet, indices, positions, positionStride);
+		meshlets.push_back(meshlet);
+		return meshlets;
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef __LTH_MESHLET_BUILDER_HPP__
+#define __LTH_MESHLET_BUILDER_HPP__
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace lth {
+
+	// Cluster of triangles with its culling data, in the layout of clusterCull.comp (std430).
+	struct LthMeshlet {
+		glm::vec3 center{ 0.f }; // Object space bounding sphere.
+		float radius = 0.f;
+		glm::vec3 coneAxis{ 0.f }; // Normal cone: every triangle faces away from a viewer in it.
+		float coneCutoff = 1.f; // Sine of the cone half angle, 1 when the cone is too wide to ever cull.
+		uint32_t firstIndex = 0; // Relative to the first index of the model.
+		uint32_t indexCount = 0;
+		uint32_t vertexCount = 0;
+		uint32_t padding = 0;
+	};
+
+	// Splits a triangle list into meshlets of a bounded size. The triangles are taken in order, so every meshlet is a
+	// contiguous index range and the index buffer is left untouched: on an index list optimized for the vertex cache,
+	// consecutive triangles are already close to each other.
+	class LthMeshletBuilder {
+	public:
+		static constexpr uint32_t MAX_VERTICES = 64;
+		static constexpr uint32_t MAX_TRIANGLES = 124;
+
+		static std::vector<LthMeshlet> build(
+			const uint32_t* indices, size_t indexCount,
+			const glm::vec3* positions, size_t positionStride, size_t vertexCount,
+			uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+	};
+
+	static_assert(sizeof(LthMeshlet) == 48, "The culling shader reads the meshlets with this stride.");
+}
+
+#endif
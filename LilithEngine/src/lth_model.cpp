@@ -1,11 +1,17 @@
 #include "lth_model.hpp"
+#include "lth_upload_context.hpp"
+#include "lth_obj_loader.hpp"
+#include "lth_mesh_cache.hpp"
 #include "lth_utils.hpp"
 
-#define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstring>
+#include <limits>
 #include <unordered_map>
 #include <iostream>
 
@@ -22,13 +28,26 @@ namespace std {
 
 namespace lth {
 
-	LthModel::LthModel(id_t modId, LthDevice& device, const LthModel::Builder &builder) : LthSceneElement(modId), lthDevice{ device } {
-		createVertexBuffer(builder.vertices);
-		createIndexBuffer(builder.indices);
+	LthModel::LthModel(id_t modId, LthDevice& device, LthGeometryPool& geometryPool, const MeshData& meshData)
+		: LthSceneElement(modId), lthDevice{ device }, lthGeometryPool{ geometryPool }, vertexFormat{ meshData.vertexFormat }, bounds{ meshData.bounds } {
+		// All the model uploads and its BLAS build go in one submission (or in the caller's batch).
+		LthUploadContext::Batch uploadBatch{ lthDevice.getUploadContext() };
+
+		assert(meshData.vertexCount >= 3 && "Vertex count must be at least 3");
+		geometryRange = lthGeometryPool.upload(
+			meshData.vertices, meshData.vertexCount, meshData.vertexStride,
+			meshData.indices, meshData.indexCount, meshData.indexType,
+			meshData.meshlets, meshData.meshletCount);
+
+		if (meshData.lodCount > 0) {
+			lods.assign(meshData.lods, meshData.lods + meshData.lodCount);
+		}
+		else {
+			lods.push_back({ 0, meshData.indexCount, 0.f });
+		}
 
 		// Ray tracing part
-		createPositionBuffer(builder.positions);
-		createASGeometry(builder);
+		createASGeometry();
 		createBLAS();
 	}
 
@@ -36,9 +55,15 @@ namespace lth {
 		if (accStruct.handle) {
 			vkDestroyAccelerationStructureKHR(lthDevice.getDevice(), accStruct.handle, nullptr);
 		}
+		lthGeometryPool.free(geometryRange);
 	}
 
-	bool LthModel::Builder::loadModel(const std::string& filePath) {
+	bool LthModel::Builder::loadModel(const std::string& filePath, LthThreadPool* threadPool) {
+		if (threadPool && LthObjLoader::load(filePath, *threadPool, vertices, indices)) {
+			computeBounds();
+			return true;
+		}
+
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
 		std::vector<tinyobj::material_t> materials;
@@ -49,7 +74,6 @@ namespace lth {
 			return false;
 		}
 
-		positions.clear();
 		vertices.clear();
 		indices.clear();
 
@@ -90,136 +114,214 @@ namespace lth {
 
 				if (uniqueVertices.count(vertex) == 0) {
 					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					positions.push_back(vertex.position);
 					vertices.push_back(vertex);
 				}
 
 				indices.push_back(uniqueVertices[vertex]);
 			}
 		}
+
+		computeBounds();
 		return true;
 	}
 
-	std::shared_ptr<LthModel> LthModel::createModelFromFile(id_t modId, LthDevice& device, const std::string& filePath) {
-		Builder builder{};
-		builder.loadModel(filePath);
-		return std::shared_ptr<LthModel>(new LthModel(modId, device, builder));
-	}
+	void LthModel::Builder::computeBounds() {
+		bounds = Bounds{};
+		if (vertices.empty()) return;
 
-	void LthModel::createVertexBuffer(const std::vector<Vertex>& vertices) {
-		vertexCount = static_cast<uint32_t>(vertices.size());
-		assert(vertexCount >= 3 && "Vertex count must be at least 3");
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-		uint32_t vertexSize = sizeof(vertices[0]);
-
-		LthBuffer stagingBuffer{
-			lthDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
-
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data());
-
-		vertexBuffer = std::make_unique<LthBuffer>(
-			lthDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		bounds.aabbMin = vertices[0].position;
+		bounds.aabbMax = vertices[0].position;
+		for (const auto& vertex : vertices) {
+			bounds.aabbMin = glm::min(bounds.aabbMin, vertex.position);
+			bounds.aabbMax = glm::max(bounds.aabbMax, vertex.position);
+		}
 
-		lthDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+		// Centered on the box, the radius reaches the farthest vertex (tighter than the half diagonal).
+		bounds.sphereCenter = (bounds.aabbMin + bounds.aabbMax) * 0.5f;
+		float squaredRadius = 0.f;
+		for (const auto& vertex : vertices) {
+			glm::vec3 offset = vertex.position - bounds.sphereCenter;
+			squaredRadius = std::max(squaredRadius, glm::dot(offset, offset));
+		}
+		bounds.sphereRadius = std::sqrt(squaredRadius);
 	}
 
-	void LthModel::createPositionBuffer(const std::vector<glm::vec3>& positions) {
-		uint32_t positionCount = static_cast<uint32_t>(positions.size());
-		assert(positionCount >= 3 && "Positioncount must be at least 3");
-		VkDeviceSize bufferSize = sizeof(positions[0]) * positionCount;
-		uint32_t positionSize = sizeof(positions[0]);
-
-		LthBuffer stagingBuffer{
-			lthDevice,
-			positionSize,
-			positionCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
-
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)positions.data());
+	void LthModel::Builder::generateLods(const LthMeshSimplifier::Settings& settings) {
+		// The indices may already hold LODs: the chain is always simplified from LOD 0.
+		if (!lods.empty()) {
+			indices.resize(lods[0].indexCount);
+			lods.clear();
+		}
+		if (vertices.empty() || indices.empty()) return;
+
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.f });
+
+		LthMeshSimplifier::VertexStreams streams{};
+		streams.positions = &vertices[0].position;
+		streams.normals = &vertices[0].normal;
+		streams.uvs = &vertices[0].uv;
+		streams.stride = sizeof(Vertex);
+		streams.vertexCount = vertices.size();
+		for (auto& lod : LthMeshSimplifier::generateLods(indices, streams, settings)) {
+			lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod.indices.size()), lod.error });
+			indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+		}
+	}
 
-		positionBuffer = std::make_unique<LthBuffer>(
-			lthDevice,
-			positionSize,
-			positionCount,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	LthMeshOptimizer::Report LthModel::Builder::optimizeMesh(uint32_t vertexStride) {
+		auto start = std::chrono::high_resolution_clock::now();
+		LthMeshOptimizer::Report report{};
+		if (vertices.empty()) return report;
+
+		// Each LOD is drawn on its own, so each one is reordered on its own. The vertex order follows LOD 0 first.
+		std::vector<Lod> lodRanges = lods.empty() ? std::vector<Lod>{ { 0, static_cast<uint32_t>(indices.size()), 0.f } } : lods;
+		std::vector<uint32_t> lodIndices{};
+		auto lodBegin = [this](const Lod& lod) { return indices.begin() + lod.firstIndex; };
+		lodIndices.assign(lodBegin(lodRanges[0]), lodBegin(lodRanges[0]) + lodRanges[0].indexCount);
+		report.before = LthMeshOptimizer::analyze(lodIndices, vertices.size(), vertexStride);
+
+		for (const Lod& lod : lodRanges) {
+			lodIndices.assign(lodBegin(lod), lodBegin(lod) + lod.indexCount);
+			LthMeshOptimizer::optimizeVertexCache(lodIndices, vertices.size());
+			LthMeshOptimizer::optimizeOverdraw(lodIndices, &vertices[0].position, sizeof(Vertex), vertices.size());
+			std::copy(lodIndices.begin(), lodIndices.end(), lodBegin(lod));
+		}
+		LthMeshOptimizer::remapVertices(vertices, LthMeshOptimizer::optimizeVertexFetchRemap(indices, vertices.size()));
 
-		lthDevice.copyBuffer(stagingBuffer.getBuffer(), positionBuffer->getBuffer(), bufferSize);
+		lodIndices.assign(lodBegin(lodRanges[0]), lodBegin(lodRanges[0]) + lodRanges[0].indexCount);
+		report.after = LthMeshOptimizer::analyze(lodIndices, vertices.size(), vertexStride);
+		report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		return report;
 	}
 
-	void LthModel::createIndexBuffer(const std::vector<uint32_t>& indices) {
-		indexCount = static_cast<uint32_t>(indices.size());
+	void LthModel::Builder::buildMeshlets() {
+		meshlets.clear();
+		if (vertices.empty() || indices.empty()) return;
 
-		hasIndexBuffer = (indexCount > 0);
-
-		if (!hasIndexBuffer) return;
+		uint32_t lod0IndexCount = lods.empty() ? static_cast<uint32_t>(indices.size()) : lods[0].indexCount;
+		meshlets = LthMeshletBuilder::build(indices.data(), lod0IndexCount, &vertices[0].position, sizeof(Vertex), vertices.size());
+	}
 
-		uint32_t indexSize = sizeof(indices[0]);
+	LthModel::MeshData LthModel::Builder::prepareMeshData(LthVertexFormat vertexFormat) {
+		MeshData meshData{};
+		meshData.vertexFormat = vertexFormat;
+		meshData.vertexCount = static_cast<uint32_t>(vertices.size());
+		meshData.indexCount = static_cast<uint32_t>(indices.size());
+		meshData.bounds = bounds;
+		meshData.lods = lods.data();
+		meshData.lodCount = static_cast<uint32_t>(lods.size());
+		meshData.meshlets = meshlets.data();
+		meshData.meshletCount = static_cast<uint32_t>(meshlets.size());
+
+		meshData.vertices = vertices.data();
+		meshData.vertexStride = sizeof(Vertex);
+		if (vertexFormat == LTH_VERTEX_FORMAT_PACKED) {
+			packedVertices.clear();
+			packedVertices.reserve(vertices.size());
+			for (const auto& vertex : vertices) {
+				packedVertices.push_back(PackedVertex::pack(vertex));
+			}
+			meshData.vertices = packedVertices.data();
+			meshData.vertexStride = sizeof(PackedVertex);
+		}
 
-		LthBuffer stagingBuffer{
-			lthDevice,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
+		// 16 bits indices whenever every vertex can be addressed with them.
+		meshData.indices = indices.data();
+		meshData.indexType = VK_INDEX_TYPE_UINT32;
+		if (vertices.size() <= std::numeric_limits<uint16_t>::max()) {
+			shortIndices.assign(indices.begin(), indices.end());
+			meshData.indices = shortIndices.data();
+			meshData.indexType = VK_INDEX_TYPE_UINT16;
+		}
+		return meshData;
+	}
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
-		stagingBuffer.unmap();
+	std::shared_ptr<LthModel> LthModel::createModelFromFile(
+		id_t modId,
+		LthDevice& device,
+		LthGeometryPool& geometryPool,
+		const std::string& filePath,
+		const LthModelLoadOptions& options) {
+		const LthVertexFormat vertexFormat = options.vertexFormat;
+		const LthMeshSimplifier::Settings& lodSettings = options.lodSettings;
+		uint32_t meshFileFlags = (options.optimizeMesh ? LTH_MESH_FILE_FLAG_OPTIMIZED_INDEX_ORDER : 0)
+			| (options.generateLods ? LTH_MESH_FILE_FLAG_LODS : 0)
+			| (options.buildMeshlets ? LTH_MESH_FILE_FLAG_MESHLETS : 0);
+		uint64_t lodSettingsHash = 0;
+		if (options.generateLods) {
+			lodSettingsHash = fnv1a(&lodSettings.maxLodCount, sizeof(lodSettings.maxLodCount));
+			lodSettingsHash = fnv1a(&lodSettings.triangleRatio, sizeof(lodSettings.triangleRatio), lodSettingsHash);
+			lodSettingsHash = fnv1a(&lodSettings.maxError, sizeof(lodSettings.maxError), lodSettingsHash);
+		}
+		LthMeshCache meshCache{};
+		if (meshCache.open(filePath, vertexFormat, meshFileFlags, lodSettingsHash)) {
+			return std::shared_ptr<LthModel>(new LthModel(modId, device, geometryPool, meshCache.getMeshData()));
+		}
 
-		indexBuffer = std::make_unique<LthBuffer>(
-			lthDevice,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
-			| VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		Builder builder{};
+		builder.loadModel(filePath, &device.getThreadPool());
+		if (options.generateLods) {
+			auto start = std::chrono::high_resolution_clock::now();
+			builder.generateLods(lodSettings);
+			if (options.verbose) {
+				std::cout << "Generated " << builder.lods.size() - 1 << " LODs of " << filePath << " in "
+					<< std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms:";
+				for (const Lod& lod : builder.lods) {
+					std::cout << " " << lod.indexCount / 3;
+				}
+				std::cout << " triangles" << std::endl;
+			}
+		}
+		LthMeshOptimizer::Report report{};
+		if (options.optimizeMesh) {
+			uint32_t vertexStride = vertexFormat == LTH_VERTEX_FORMAT_PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+			report = builder.optimizeMesh(vertexStride);
+			if (options.verbose) {
+				std::cout << "Optimized " << filePath << " in " << report.milliseconds << " ms: ACMR "
+					<< report.before.acmr << " -> " << report.after.acmr << ", ATVR "
+					<< report.before.atvr << " -> " << report.after.atvr << ", overfetch "
+					<< report.before.overfetch << " -> " << report.after.overfetch << std::endl;
+			}
+		}
+		if (options.buildMeshlets) {
+			builder.buildMeshlets();
+		}
+		MeshData meshData = builder.prepareMeshData(vertexFormat);
+		if (!LthMeshCache::write(filePath, meshData, meshFileFlags, lodSettingsHash)) {
+			std::cerr << "Failed to write the mesh cache of " << filePath << std::endl;
+		}
+		auto model = std::shared_ptr<LthModel>(new LthModel(modId, device, geometryPool, meshData));
+		model->optimized = options.optimizeMesh;
+		model->optimizationReport = report;
+		return model;
+	}
 
-		lthDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), stagingBuffer.getBufferSize());
+	LthModel::PackedVertex LthModel::PackedVertex::pack(const Vertex& vertex) {
+		PackedVertex packedVertex{};
+		packedVertex.position = vertex.position;
+		packedVertex.normal = vertex_packing::packOctahedralNormal(vertex.normal);
+		packedVertex.uv = vertex_packing::packHalfUv(vertex.uv);
+		packedVertex.color = vertex_packing::packUnormColor(vertex.color);
+		return packedVertex;
 	}
 
-	void LthModel::createASGeometry(const Builder& builder) {
-		if (!positionBuffer || !indexBuffer) {
+	void LthModel::createASGeometry() {
+		if (geometryRange.vertexCount == 0 || geometryRange.indexCount == 0) {
 			throw std::runtime_error("AS geometry cannot be created if the model buffers are not set correctly.");
 		}
 
-		VkBufferDeviceAddressInfo positionBufferDeviceAddressInfo{
-			.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
-			.pNext = nullptr,
-			.buffer = positionBuffer->getBuffer(),
-		};
-
-		auto positionBufferDeviceAddress = vkGetBufferDeviceAddress(lthDevice.getDevice(), &positionBufferDeviceAddressInfo);
-
-		VkBufferDeviceAddressInfo indexBufferDeviceAddressInfo{
-			.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
-			.pNext = nullptr,
-			.buffer = indexBuffer->getBuffer(),
-		};
-
-		auto indexBufferDeviceAddress = vkGetBufferDeviceAddress(lthDevice.getDevice(), &indexBufferDeviceAddressInfo);
+		// The position is the first attribute of both vertex layouts, so the BLAS reads it straight from the pool vertex
+		// buffer by striding over the other attributes. Indices are relative to the model's first vertex.
+		auto vertexBufferDeviceAddress = lthGeometryPool.getVertexBufferAddress() + geometryRange.vertexOffset;
+		auto indexBufferDeviceAddress = lthGeometryPool.getIndexBufferAddress() + geometryRange.indexOffset;
 
 		VkAccelerationStructureGeometryTrianglesDataKHR triangles{
 		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
 		.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,
-		.vertexData = {.deviceAddress = positionBufferDeviceAddress},
-		.vertexStride = sizeof(glm::vec3),
-		.maxVertex = vertexCount - 1,
-		.indexType = VK_INDEX_TYPE_UINT32,
+		.vertexData = {.deviceAddress = vertexBufferDeviceAddress},
+		.vertexStride = geometryRange.vertexStride,
+		.maxVertex = geometryRange.vertexCount - 1,
+		.indexType = geometryRange.indexType,
 		.indexData = {.deviceAddress = indexBufferDeviceAddress},
 		};
 
@@ -228,7 +330,8 @@ namespace lth {
 		asGeometry.geometry = { .triangles = triangles };
 		asGeometry.flags = VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR | VK_GEOMETRY_OPAQUE_BIT_KHR;
 
-		asBuildRangeInfo.primitiveCount = indexCount / 3;
+		// The LODs are only rasterized, rays are traced against LOD 0 (the first indices).
+		asBuildRangeInfo.primitiveCount = lods[0].indexCount / 3;
 		asBuildRangeInfo.primitiveOffset = 0;
 		asBuildRangeInfo.firstVertex = 0;
 		asBuildRangeInfo.transformOffset = 0;
@@ -246,42 +349,13 @@ namespace lth {
 		buildAccelerationStructure(lthDevice, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, asGeometry, asBuildRangeInfo, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR, accStruct);
 	}
 
-	void LthModel::draw(VkCommandBuffer commandBuffer) {
-		if (hasIndexBuffer) {
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+	void LthModel::draw(VkCommandBuffer commandBuffer, uint32_t firstInstance, uint32_t instanceCount, uint32_t lod) {
+		if (geometryRange.indexCount > 0) {
+			const Lod& lodRange = lods[std::min<size_t>(lod, lods.size() - 1)];
+			vkCmdDrawIndexed(commandBuffer, lodRange.indexCount, instanceCount, geometryRange.firstIndex() + lodRange.firstIndex, 0, firstInstance);
 		}
 		else {
-			vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+			vkCmdDraw(commandBuffer, geometryRange.vertexCount, instanceCount, 0, firstInstance);
 		}
 	}
-
-	void LthModel::bind(VkCommandBuffer commandBuffer) {
-		VkBuffer buffers[] = { vertexBuffer->getBuffer()};
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-
-		if (hasIndexBuffer) {
-			vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
-		}
-	}
-
-
-	std::vector<VkVertexInputBindingDescription> LthModel::Vertex::getBindingDescriptions() {
-		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
-		bindingDescriptions[0].binding = 0;
-		bindingDescriptions[0].stride = sizeof(Vertex);
-		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		return bindingDescriptions;
-	}
-
-	std::vector<VkVertexInputAttributeDescription> LthModel::Vertex::getAttributeDescriptions() {
-		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
-
-		attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) });
-		attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color) });
-		attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) });
-		attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv) });
-
-		return attributeDescriptions;
-	}
 }
\ No newline at end of file
@@ -3,6 +3,11 @@
 
 #include "lth_device.hpp"
 #include "lth_buffer.hpp"
+#include "lth_geometry_pool.hpp"
+#include "lth_vertex_layout.hpp"
+#include "lth_mesh_optimizer.hpp"
+#include "lth_mesh_simplifier.hpp"
+#include "lth_meshlet_builder.hpp"
 #include "lth_acceleration_structure.hpp"
 #include "lth_scene_element.hpp"
 
@@ -14,6 +19,22 @@
 
 namespace lth {
 
+	// Vertex layout of a model in the geometry pool, decoded by the vertex shader (see standard.vert).
+	enum LthVertexFormat : uint32_t {
+		LTH_VERTEX_FORMAT_FULL = 0, // LthModel::Vertex, 44 bytes.
+		LTH_VERTEX_FORMAT_PACKED = 1, // LthModel::PackedVertex, 24 bytes.
+	};
+
+	// Processing of a model file, every field is part of the key of its mesh cache.
+	struct LthModelLoadOptions {
+		LthVertexFormat vertexFormat = LTH_VERTEX_FORMAT_PACKED;
+		bool optimizeMesh = true;
+		bool generateLods = true;
+		bool buildMeshlets = true;
+		LthMeshSimplifier::Settings lodSettings{};
+		bool verbose = false; // Prints the LOD triangle counts and the optimizer statistics of the processed meshes.
+	};
+
 	class LthModel : public LthSceneElement {
 	public:
 		struct Vertex {
@@ -21,9 +42,6 @@ namespace lth {
 			glm::vec3 color{};
 			glm::vec3 normal{};
 			glm::vec2 uv{};
-
-			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 		
 			bool operator==(const Vertex& otherVertex) const {
 				return position == otherVertex.position
@@ -33,51 +51,140 @@ namespace lth {
 			}
 		};
 
+		// Octahedral normal (snorm16x2), half float uv and unorm8 color. The position stays in full precision for the BLAS.
+		struct PackedVertex {
+			glm::vec3 position{};
+			uint32_t normal = 0;
+			uint32_t uv = 0;
+			uint32_t color = 0;
+
+			static PackedVertex pack(const Vertex& vertex);
+		};
+
+		// Object space bounding volumes, used for culling.
+		struct Bounds {
+			glm::vec3 aabbMin{ 0.f };
+			glm::vec3 aabbMax{ 0.f };
+			glm::vec3 sphereCenter{ 0.f };
+			float sphereRadius = 0.f;
+		};
+
+		// Index sub-range of a level of detail, relative to the model's first index. LOD 0 is the full resolution mesh.
+		struct Lod {
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			float error = 0.f; // Object space distance to the full resolution surface.
+		};
+
+		// Geometry in its device layout: vertices in the given format, 16 or 32 bits indices. Does not own the data.
+		struct MeshData {
+			LthVertexFormat vertexFormat = LTH_VERTEX_FORMAT_PACKED;
+			const void* vertices = nullptr;
+			uint32_t vertexCount = 0;
+			uint32_t vertexStride = 0;
+			const void* indices = nullptr;
+			uint32_t indexCount = 0;
+			VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+			Bounds bounds{};
+			const Lod* lods = nullptr; // Without LODs, the whole index range is LOD 0.
+			uint32_t lodCount = 0;
+			const LthMeshlet* meshlets = nullptr; // Partition of LOD 0, for cluster culling.
+			uint32_t meshletCount = 0;
+		};
+
 		struct Builder {
-			std::vector<glm::vec3> positions{};
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
-
-			bool loadModel(const std::string& filepath);
+			Bounds bounds{};
+			std::vector<Lod> lods{};
+			std::vector<LthMeshlet> meshlets{};
+
+			// With a thread pool, OBJ files go through the parallel LthObjLoader, which gives the same result.
+			bool loadModel(const std::string& filepath, LthThreadPool* threadPool = nullptr);
+			void computeBounds();
+			// Appends the indices of the coarser LODs after the full resolution ones. They share the same vertices.
+			void generateLods(const LthMeshSimplifier::Settings& settings);
+			// Reorders the triangles of each LOD for the vertex cache then for overdraw, and the vertices in order of first use.
+			// vertexStride is the stride in the vertex buffer, for the reported statistics (of LOD 0).
+			LthMeshOptimizer::Report optimizeMesh(uint32_t vertexStride);
+			// Splits LOD 0 into meshlets, in its current index order: to run once the indices are final.
+			void buildMeshlets();
+			// Converts the geometry to its device layout. The result points into the builder, valid until it changes.
+			MeshData prepareMeshData(LthVertexFormat vertexFormat);
+
+			std::vector<PackedVertex> packedVertices{};
+			std::vector<uint16_t> shortIndices{};
 		};
 
-		LthModel(id_t modId, LthDevice& device, const LthModel::Builder& builder);
+		LthModel(id_t modId, LthDevice& device, LthGeometryPool& geometryPool, const MeshData& meshData);
+		LthModel(id_t modId, LthDevice& device, LthGeometryPool& geometryPool, LthModel::Builder& builder, LthVertexFormat vertexFormat = LTH_VERTEX_FORMAT_PACKED)
+			: LthModel(modId, device, geometryPool, builder.prepareMeshData(vertexFormat)) {}
 		~LthModel();
 		
-		static std::shared_ptr<LthModel> createModelFromFile(id_t modId, LthDevice& device, const std::string& filePath);
+		// Loads the mesh cache next to the file when it is up to date, else loads the file and writes the cache.
+		static std::shared_ptr<LthModel> createModelFromFile(
+			id_t modId,
+			LthDevice& device,
+			LthGeometryPool& geometryPool,
+			const std::string& filePath,
+			const LthModelLoadOptions& options = {});
 
 		LthModel(const LthModel&) = delete;
 		LthModel& operator=(const LthModel&) = delete;
-		LthModel(LthModel&&) = default;
-		LthModel& operator=(LthModel&&) = default;
 
 		VkDeviceAddress getBLASAddress() const { return accStruct.deviceAddress; }
-
-		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
+		const LthGeometryRange& getGeometryRange() const { return geometryRange; }
+		const Bounds& getBounds() const { return bounds; }
+		LthVertexFormat getVertexFormat() const { return vertexFormat; }
+		const std::vector<Lod>& getLods() const { return lods; }
+		bool hasMeshlets() const { return geometryRange.meshletCount > 0; }
+		// Statistics of the mesh optimization, null when the model was not optimized in this run (mesh cache, options).
+		const LthMeshOptimizer::Report* getOptimizationReport() const { return optimized ? &optimizationReport : nullptr; }
+
+		// The geometry pool index buffer must be bound with the index type of the model. Vertices are pulled from the pool
+		// vertex buffer, at the offset given by the InstanceData.
+		void draw(VkCommandBuffer commandBuffer, uint32_t firstInstance = 0, uint32_t instanceCount = 1, uint32_t lod = 0);
 	private:
-		void createVertexBuffer(const std::vector<Vertex>& vertices);
-		void createPositionBuffer(const std::vector<glm::vec3>& positions);
-		void createIndexBuffer(const std::vector<uint32_t>& indices);
-		void createASGeometry(const Builder& builder);
+		void createASGeometry();
 		void createBLAS();
 
 
 		LthDevice& lthDevice;
-		
-		std::unique_ptr<LthBuffer> vertexBuffer;
-		uint32_t vertexCount;
-
-		std::unique_ptr<LthBuffer> positionBuffer;
-
-		bool hasIndexBuffer = false;
-		std::unique_ptr<LthBuffer> indexBuffer;
-		uint32_t indexCount;
+		LthGeometryPool& lthGeometryPool;
+		LthGeometryRange geometryRange{};
+		LthVertexFormat vertexFormat;
+		Bounds bounds{};
+		std::vector<Lod> lods{};
+		bool optimized = false;
+		LthMeshOptimizer::Report optimizationReport{};
 
 		VkAccelerationStructureGeometryKHR asGeometry;
 		VkAccelerationStructureBuildRangeInfoKHR asBuildRangeInfo;
 		AccelerationStructure accStruct{};
 	};
+
+	template<>
+	struct LthVertexLayout<LthModel::Vertex> {
+		static constexpr std::array<VkVertexInputAttributeDescription, 4> attributes{ {
+			{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LthModel::Vertex, position) },
+			{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LthModel::Vertex, color) },
+			{ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LthModel::Vertex, normal) },
+			{ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(LthModel::Vertex, uv) } } };
+	};
+
+	// The normal still needs the octahedral decoding in the shader.
+	template<>
+	struct LthVertexLayout<LthModel::PackedVertex> {
+		static constexpr std::array<VkVertexInputAttributeDescription, 4> attributes{ {
+			{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LthModel::PackedVertex, position) },
+			{ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(LthModel::PackedVertex, color) },
+			{ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(LthModel::PackedVertex, normal) },
+			{ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(LthModel::PackedVertex, uv) } } };
+	};
+
+	static_assert(sizeof(LthModel::Vertex) == 44 && sizeof(LthModel::PackedVertex) == 24, "The vertex shader pulls the vertices with these strides.");
+	static_assert(sizeof(LthModel::Lod) == 12, "The LOD table is stored as is in the mesh cache.");
+	static_assert(offsetof(LthModel::Vertex, position) == 0 && offsetof(LthModel::PackedVertex, position) == 0, "The BLAS reads the positions in place.");
 }
 
 #endif
\ No newline at end of file
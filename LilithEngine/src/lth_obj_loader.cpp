@@ -0,0 +1,419 @@
+#include "lth_obj_loader.hpp"
+
+// The parallel parser calls the tinyobj number and index parsers so that both paths give the exact same floats.
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace lth {
+
+	namespace {
+
+		// Resolved, 0 based, attribute indices of a face corner. -1 when the attribute is absent.
+		struct ObjCorner {
+			int32_t position;
+			int32_t texcoord;
+			int32_t normal;
+		};
+
+		// A run of whole lines of the file. Line breaks have been replaced by '\0', so the tinyobj parsers stop at the
+		// end of each line as they do on its line buffer.
+		struct ObjChunk {
+			char* begin;
+			char* end;
+
+			// First pass: attribute counts, turned into the index of the chunk's first attribute by a prefix sum.
+			size_t positionCount = 0;
+			size_t normalCount = 0;
+			size_t texcoordCount = 0;
+			size_t faceCount = 0;
+			size_t firstPosition = 0;
+			size_t firstNormal = 0;
+			size_t firstTexcoord = 0;
+
+			// Second pass: faces in file order.
+			std::vector<ObjCorner> faceCorners{};
+			std::vector<uint32_t> faceSizes{};
+
+			// Third pass: triangles, and the hash of the vertex of each corner.
+			std::vector<ObjCorner> triangleCorners{};
+			std::vector<uint32_t> cornerHashes{};
+			bool unsupportedPolygon = false;
+		};
+
+		struct ObjAttributes {
+			std::vector<float> positions{};
+			std::vector<float> colors{};
+			std::vector<float> normals{};
+			std::vector<float> texcoords{};
+		};
+
+		const char* skipSpaces(const char* token) {
+			return token + strspn(token, " \t");
+		}
+
+		template<typename F>
+		void forEachLine(const ObjChunk& chunk, F&& function) {
+			const char* line = chunk.begin;
+			while (line < chunk.end) {
+				size_t length = strlen(line);
+				function(skipSpaces(line));
+				line += length + 1;
+			}
+		}
+
+		// Same rules as tinyobj fixIndex: 1 based, negative values are relative to the attributes defined so far.
+		bool fixIndex(int index, size_t definedCount, bool allowZero, int32_t& fixedIndex) {
+			if (index > 0) {
+				fixedIndex = index - 1;
+				return true;
+			}
+			if (index == 0) {
+				fixedIndex = -1;
+				return allowZero;
+			}
+			int64_t relativeIndex = static_cast<int64_t>(definedCount) + index;
+			fixedIndex = static_cast<int32_t>(relativeIndex);
+			return relativeIndex >= 0;
+		}
+
+		void countAttributes(ObjChunk& chunk) {
+			forEachLine(chunk, [&chunk](const char* token) {
+				if (token[0] == 'v') {
+					if (IS_SPACE(token[1])) chunk.positionCount++;
+					else if (token[1] == 'n' && IS_SPACE(token[2])) chunk.normalCount++;
+					else if (token[1] == 't' && IS_SPACE(token[2])) chunk.texcoordCount++;
+				}
+				else if (token[0] == 'f' && IS_SPACE(token[1])) {
+					chunk.faceCount++;
+				}
+			});
+		}
+
+		void parseChunk(ObjChunk& chunk, ObjAttributes& attributes) {
+			float* position = attributes.positions.data() + 3 * chunk.firstPosition;
+			float* color = attributes.colors.data() + 3 * chunk.firstPosition;
+			float* normal = attributes.normals.data() + 3 * chunk.firstNormal;
+			float* texcoord = attributes.texcoords.data() + 2 * chunk.firstTexcoord;
+			size_t positionCount = chunk.firstPosition;
+			size_t normalCount = chunk.firstNormal;
+			size_t texcoordCount = chunk.firstTexcoord;
+
+			chunk.faceSizes.reserve(chunk.faceCount);
+			chunk.faceCorners.reserve(chunk.faceCount * 3);
+
+			forEachLine(chunk, [&](const char* token) {
+				if (token[0] == 'v' && IS_SPACE(token[1])) {
+					token += 2;
+					tinyobj::parseVertexWithColor(&position[0], &position[1], &position[2], &color[0], &color[1], &color[2], &token);
+					position += 3;
+					color += 3;
+					positionCount++;
+				}
+				else if (token[0] == 'v' && token[1] == 'n' && IS_SPACE(token[2])) {
+					token += 3;
+					tinyobj::parseReal3(&normal[0], &normal[1], &normal[2], &token);
+					normal += 3;
+					normalCount++;
+				}
+				else if (token[0] == 'v' && token[1] == 't' && IS_SPACE(token[2])) {
+					token += 3;
+					tinyobj::parseReal2(&texcoord[0], &texcoord[1], &token);
+					texcoord += 2;
+					texcoordCount++;
+				}
+				else if (token[0] == 'f' && IS_SPACE(token[1])) {
+					token = skipSpaces(token + 2);
+					uint32_t faceSize = 0;
+					while (!IS_NEW_LINE(token[0])) {
+						tinyobj::vertex_index_t rawIndex = tinyobj::parseRawTriple(&token);
+						ObjCorner corner{};
+						if (!fixIndex(rawIndex.v_idx, positionCount, false, corner.position)
+							|| !fixIndex(rawIndex.vt_idx, texcoordCount, true, corner.texcoord)
+							|| !fixIndex(rawIndex.vn_idx, normalCount, true, corner.normal)) {
+							throw std::runtime_error("Failed to load model! Invalid face index.");
+						}
+						chunk.faceCorners.push_back(corner);
+						faceSize++;
+						token += strspn(token, " \t\r");
+					}
+					chunk.faceSizes.push_back(faceSize);
+				}
+			});
+		}
+
+		// Word hash over the bytes of the vertex. Both zeros hash the same, as they compare equal.
+		uint32_t hashVertex(const LthModel::Vertex& vertex) {
+			constexpr size_t WORD_COUNT = sizeof(LthModel::Vertex) / sizeof(uint32_t);
+			uint32_t words[WORD_COUNT];
+			memcpy(words, &vertex, sizeof(words));
+
+			uint64_t hash = 0x9e3779b97f4a7c15ull;
+			for (uint32_t word : words) {
+				if ((word & 0x7fffffffu) == 0) word = 0;
+				hash = ((hash << 5) | (hash >> 59)) ^ word;
+				hash *= 0xff51afd7ed558ccdull;
+			}
+			hash ^= hash >> 33;
+			hash *= 0xc4ceb9fe1a85ec53ull;
+			hash ^= hash >> 33;
+			return static_cast<uint32_t>(hash);
+		}
+
+		LthModel::Vertex makeVertex(const ObjAttributes& attributes, const ObjCorner& corner) {
+			LthModel::Vertex vertex{};
+			const float* position = &attributes.positions[3 * static_cast<size_t>(corner.position)];
+			const float* color = &attributes.colors[3 * static_cast<size_t>(corner.position)];
+			vertex.position = { position[0], position[1], position[2] };
+			vertex.color = { color[0], color[1], color[2] };
+			if (corner.normal >= 0) {
+				const float* normal = &attributes.normals[3 * static_cast<size_t>(corner.normal)];
+				vertex.normal = { normal[0], normal[1], normal[2] };
+			}
+			if (corner.texcoord >= 0) {
+				const float* texcoord = &attributes.texcoords[2 * static_cast<size_t>(corner.texcoord)];
+				vertex.uv = { texcoord[0], 1.0f - texcoord[1] };
+			}
+			return vertex;
+		}
+
+		// Same split as tinyobj: triangles are kept, quads are cut along their shortest diagonal.
+		void triangulateChunk(ObjChunk& chunk, const ObjAttributes& attributes) {
+			size_t positionCount = attributes.positions.size() / 3;
+			size_t normalCount = attributes.normals.size() / 3;
+			size_t texcoordCount = attributes.texcoords.size() / 2;
+
+			chunk.triangleCorners.reserve(chunk.faceCorners.size() * 3 / 2);
+			const ObjCorner* face = chunk.faceCorners.data();
+			for (uint32_t faceSize : chunk.faceSizes) {
+				const ObjCorner* corners = face;
+				face += faceSize;
+
+				if (faceSize < 3) continue;
+				if (faceSize > 4) {
+					chunk.unsupportedPolygon = true;
+					return;
+				}
+
+				if (faceSize == 3) {
+					chunk.triangleCorners.insert(chunk.triangleCorners.end(), corners, corners + 3);
+					continue;
+				}
+
+				bool validQuad = true;
+				for (uint32_t i = 0; i < 4; ++i) {
+					validQuad &= static_cast<size_t>(corners[i].position) < positionCount;
+				}
+				if (!validQuad) continue; // tinyobj drops it with a warning.
+
+				const float* v0 = &attributes.positions[3 * static_cast<size_t>(corners[0].position)];
+				const float* v1 = &attributes.positions[3 * static_cast<size_t>(corners[1].position)];
+				const float* v2 = &attributes.positions[3 * static_cast<size_t>(corners[2].position)];
+				const float* v3 = &attributes.positions[3 * static_cast<size_t>(corners[3].position)];
+				float e02x = v2[0] - v0[0];
+				float e02y = v2[1] - v0[1];
+				float e02z = v2[2] - v0[2];
+				float e13x = v3[0] - v1[0];
+				float e13y = v3[1] - v1[1];
+				float e13z = v3[2] - v1[2];
+				float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+				float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+				const uint32_t split02[6] = { 0, 1, 2, 0, 2, 3 };
+				const uint32_t split13[6] = { 0, 1, 3, 1, 2, 3 };
+				const uint32_t* split = sqr02 < sqr13 ? split02 : split13;
+				for (uint32_t i = 0; i < 6; ++i) {
+					chunk.triangleCorners.push_back(corners[split[i]]);
+				}
+			}
+
+			chunk.cornerHashes.resize(chunk.triangleCorners.size());
+			for (size_t i = 0; i < chunk.triangleCorners.size(); ++i) {
+				const ObjCorner& corner = chunk.triangleCorners[i];
+				if (static_cast<size_t>(corner.position) >= positionCount
+					|| (corner.normal >= 0 && static_cast<size_t>(corner.normal) >= normalCount)
+					|| (corner.texcoord >= 0 && static_cast<size_t>(corner.texcoord) >= texcoordCount)) {
+					throw std::runtime_error("Failed to load model! Face index out of bounds.");
+				}
+				chunk.cornerHashes[i] = hashVertex(makeVertex(attributes, corner));
+			}
+		}
+
+		// Open addressing (linear probing) table from vertex to index in the output vertices, which hold the keys.
+		// Kept at most half full so that probe sequences stay short.
+		class VertexWeldTable {
+		public:
+			VertexWeldTable(std::vector<LthModel::Vertex>& vertices, size_t expectedVertexCount) : vertices{ vertices } {
+				size_t capacity = 1024;
+				while (capacity < expectedVertexCount * 2) capacity *= 2;
+				slots.assign(capacity, Slot{});
+				mask = capacity - 1;
+			}
+
+			uint32_t findOrInsert(const LthModel::Vertex& vertex, uint32_t hash) {
+				size_t slot = hash & mask;
+				while (slots[slot].vertexIndex != EMPTY_SLOT) {
+					if (slots[slot].hash == hash && vertices[slots[slot].vertexIndex] == vertex) {
+						return slots[slot].vertexIndex;
+					}
+					slot = (slot + 1) & mask;
+				}
+
+				uint32_t vertexIndex = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(vertex);
+				slots[slot] = { hash, vertexIndex };
+				if (vertices.size() * 2 > slots.size()) {
+					grow();
+				}
+				return vertexIndex;
+			}
+
+		private:
+			static constexpr uint32_t EMPTY_SLOT = ~0u;
+
+			struct Slot {
+				uint32_t hash = 0;
+				uint32_t vertexIndex = EMPTY_SLOT;
+			};
+
+			void grow() {
+				std::vector<Slot> oldSlots(slots.size() * 2, Slot{});
+				oldSlots.swap(slots);
+				mask = slots.size() - 1;
+				for (const Slot& oldSlot : oldSlots) {
+					if (oldSlot.vertexIndex == EMPTY_SLOT) continue;
+					size_t slot = oldSlot.hash & mask;
+					while (slots[slot].vertexIndex != EMPTY_SLOT) {
+						slot = (slot + 1) & mask;
+					}
+					slots[slot] = oldSlot;
+				}
+			}
+
+			std::vector<LthModel::Vertex>& vertices;
+			std::vector<Slot> slots;
+			size_t mask;
+		};
+	}
+
+	bool LthObjLoader::load(
+		const std::string& filePath,
+		LthThreadPool& threadPool,
+		std::vector<LthModel::Vertex>& vertices,
+		std::vector<uint32_t>& indices) {
+		std::ifstream file{ filePath, std::ios::ate | std::ios::binary };
+		if (!file.is_open()) {
+			throw std::runtime_error("Failed to load model! Cannot open " + filePath);
+		}
+		size_t fileSize = static_cast<size_t>(file.tellg());
+		std::string text(fileSize, '\0');
+		file.seekg(0);
+		file.read(text.data(), fileSize);
+		file.close();
+
+		// Chunks end right after a line break, so that every line belongs to exactly one of them.
+		constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+		size_t chunkCount = std::clamp<size_t>(fileSize / MIN_CHUNK_SIZE, 1, static_cast<size_t>(threadPool.getThreadCount() + 1) * 4);
+		std::vector<ObjChunk> chunks{};
+		chunks.reserve(chunkCount);
+		char* textBegin = text.data();
+		char* textEnd = textBegin + fileSize;
+		char* chunkBegin = textBegin;
+		for (size_t i = 1; i <= chunkCount && chunkBegin < textEnd; ++i) {
+			char* chunkEnd = textEnd;
+			if (i < chunkCount) {
+				char* target = std::max(chunkBegin, textBegin + fileSize * i / chunkCount);
+				char* lineBreak = static_cast<char*>(memchr(target, '\n', textEnd - target));
+				chunkEnd = lineBreak ? lineBreak + 1 : textEnd;
+			}
+			chunks.push_back(ObjChunk{ chunkBegin, chunkEnd });
+			chunkBegin = chunkEnd;
+		}
+
+		// Counting pass, which also ends the lines. A lone '\r' ends a line for tinyobj too.
+		threadPool.parallelFor(chunks.size(), 1, [&chunks](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				for (char* character = chunks[i].begin; character < chunks[i].end; ++character) {
+					if (*character == '\n' || *character == '\r') *character = '\0';
+				}
+				countAttributes(chunks[i]);
+			}
+		});
+
+		ObjAttributes attributes{};
+		size_t positionCount = 0, normalCount = 0, texcoordCount = 0;
+		for (ObjChunk& chunk : chunks) {
+			chunk.firstPosition = positionCount;
+			chunk.firstNormal = normalCount;
+			chunk.firstTexcoord = texcoordCount;
+			positionCount += chunk.positionCount;
+			normalCount += chunk.normalCount;
+			texcoordCount += chunk.texcoordCount;
+		}
+		attributes.positions.resize(3 * positionCount);
+		attributes.colors.resize(3 * positionCount);
+		attributes.normals.resize(3 * normalCount);
+		attributes.texcoords.resize(2 * texcoordCount);
+
+		threadPool.parallelFor(chunks.size(), 1, [&chunks, &attributes](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) parseChunk(chunks[i], attributes);
+		});
+		threadPool.parallelFor(chunks.size(), 1, [&chunks, &attributes](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) triangulateChunk(chunks[i], attributes);
+		});
+
+		size_t cornerCount = 0;
+		for (const ObjChunk& chunk : chunks) {
+			if (chunk.unsupportedPolygon) return false;
+			cornerCount += chunk.triangleCorners.size();
+		}
+
+		// Welding stays sequential: the vertices are numbered in order of first use, like the reference path.
+		vertices.clear();
+		indices.clear();
+		indices.reserve(cornerCount);
+		VertexWeldTable weldTable{ vertices, positionCount };
+		for (const ObjChunk& chunk : chunks) {
+			for (size_t i = 0; i < chunk.triangleCorners.size(); ++i) {
+				indices.push_back(weldTable.findOrInsert(makeVertex(attributes, chunk.triangleCorners[i]), chunk.cornerHashes[i]));
+			}
+		}
+
+		return true;
+	}
+
+	LthObjLoader::BenchmarkResult LthObjLoader::benchmark(const std::string& filePath, LthThreadPool& threadPool, uint32_t iterations) {
+		using Clock = std::chrono::high_resolution_clock;
+		auto elapsedMs = [](Clock::time_point start) {
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		};
+
+		BenchmarkResult result{};
+		result.filePath = filePath;
+		result.referenceMs = std::numeric_limits<double>::max();
+		result.parallelMs = std::numeric_limits<double>::max();
+
+		LthModel::Builder reference{};
+		LthModel::Builder parallel{};
+		for (uint32_t i = 0; i < std::max(iterations, 1u); ++i) {
+			auto start = Clock::now();
+			reference.loadModel(filePath);
+			result.referenceMs = std::min(result.referenceMs, elapsedMs(start));
+
+			start = Clock::now();
+			parallel.loadModel(filePath, &threadPool);
+			result.parallelMs = std::min(result.parallelMs, elapsedMs(start));
+		}
+
+		result.vertexCount = static_cast<uint32_t>(parallel.vertices.size());
+		result.indexCount = static_cast<uint32_t>(parallel.indices.size());
+		result.identical = reference.vertices == parallel.vertices && reference.indices == parallel.indices;
+		return result;
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef __LTH_OBJ_LOADER_HPP__
+#define __LTH_OBJ_LOADER_HPP__
+
+#include "lth_model.hpp"
+#include "lth_thread_pool.hpp"
+
+#include <string>
+#include <vector>
+
+namespace lth {
+
+	// Parallel OBJ loader. The file is cut in chunks of lines parsed on the thread pool, the faces are triangulated in
+	// parallel too, then the vertices are welded through an open addressing hash table.
+	// The output is the same as LthModel::Builder::loadModel without thread pool (tinyobj then an unordered_map): same
+	// number parsing, same quad split, vertices numbered in order of first use.
+	class LthObjLoader {
+	public:
+		struct BenchmarkResult {
+			std::string filePath;
+			uint32_t vertexCount = 0;
+			uint32_t indexCount = 0;
+			double referenceMs = 0.0; // tinyobj and std::unordered_map.
+			double parallelMs = 0.0;
+			bool identical = false;
+		};
+
+		// Returns false, without touching the outputs, if the file has polygons of more than 4 vertices: tinyobj ear clipping
+		// is not reproduced, the caller falls back to it.
+		static bool load(
+			const std::string& filePath,
+			LthThreadPool& threadPool,
+			std::vector<LthModel::Vertex>& vertices,
+			std::vector<uint32_t>& indices);
+
+		// Loads the file with both paths, keeping the best time of each.
+		static BenchmarkResult benchmark(const std::string& filePath, LthThreadPool& threadPool, uint32_t iterations = 4);
+	};
+}
+
+#endif
@@ -0,0 +1,92 @@
+#include "lth_range_allocator.hpp"
+
+#include <cassert>
+
+namespace lth {
+
+	LthRangeAllocator::LthRangeAllocator(uint64_t size) : size{ size } {
+		if (size > 0) {
+			insertFreeRange(0, size);
+		}
+	}
+
+	uint64_t LthRangeAllocator::allocate(uint64_t allocSize, uint64_t alignment) {
+		assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Range allocator alignment must be a power of two!");
+		if (allocSize == 0) allocSize = 1;
+
+		// Smallest free ranges first: the first one that still fits once aligned is the best fit.
+		for (auto it = freeRangesBySize.lower_bound(allocSize); it != freeRangesBySize.end(); ++it) {
+			uint64_t rangeOffset = it->second;
+			uint64_t rangeSize = it->first;
+			uint64_t alignedOffset = (rangeOffset + alignment - 1) & ~(alignment - 1);
+			uint64_t padding = alignedOffset - rangeOffset;
+			if (padding + allocSize > rangeSize) continue;
+
+			eraseFreeRange(freeRangesByOffset.find(rangeOffset));
+			if (padding > 0) {
+				insertFreeRange(rangeOffset, padding);
+			}
+			uint64_t tailSize = rangeSize - padding - allocSize;
+			if (tailSize > 0) {
+				insertFreeRange(alignedOffset + allocSize, tailSize);
+			}
+
+			allocatedRanges[alignedOffset] = allocSize;
+			usedSize += allocSize;
+			return alignedOffset;
+		}
+
+		return INVALID_OFFSET;
+	}
+
+	void LthRangeAllocator::free(uint64_t offset) {
+		auto allocated = allocatedRanges.find(offset);
+		assert(allocated != allocatedRanges.end() && "Freeing a range that was not allocated!");
+
+		uint64_t rangeOffset = offset;
+		uint64_t rangeSize = allocated->second;
+		usedSize -= rangeSize;
+		allocatedRanges.erase(allocated);
+
+		// Merge with the following free range.
+		auto next = freeRangesByOffset.find(rangeOffset + rangeSize);
+		if (next != freeRangesByOffset.end()) {
+			rangeSize += next->second;
+			eraseFreeRange(next);
+		}
+
+		// Merge with the preceding free range.
+		auto prev = freeRangesByOffset.lower_bound(rangeOffset);
+		if (prev != freeRangesByOffset.begin()) {
+			--prev;
+			if (prev->first + prev->second == rangeOffset) {
+				rangeOffset = prev->first;
+				rangeSize += prev->second;
+				eraseFreeRange(prev);
+			}
+		}
+
+		insertFreeRange(rangeOffset, rangeSize);
+	}
+
+	uint64_t LthRangeAllocator::getAllocationSize(uint64_t offset) const {
+		auto allocated = allocatedRanges.find(offset);
+		return allocated == allocatedRanges.end() ? 0 : allocated->second;
+	}
+
+	void LthRangeAllocator::insertFreeRange(uint64_t offset, uint64_t rangeSize) {
+		freeRangesByOffset.emplace(offset, rangeSize);
+		freeRangesBySize.emplace(rangeSize, offset);
+	}
+
+	void LthRangeAllocator::eraseFreeRange(FreeRangeIterator range) {
+		auto sizeRange = freeRangesBySize.equal_range(range->second);
+		for (auto it = sizeRange.first; it != sizeRange.second; ++it) {
+			if (it->second == range->first) {
+				freeRangesBySize.erase(it);
+				break;
+			}
+		}
+		freeRangesByOffset.erase(range);
+	}
+}
@@ -0,0 +1,48 @@
+#ifndef __LTH_RANGE_ALLOCATOR_HPP__
+#define __LTH_RANGE_ALLOCATOR_HPP__
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+namespace lth {
+
+	// Best-fit offset allocator over a [0, size) range, with coalescing of neighbouring free ranges.
+	// It does not own any memory: it only hands out offsets, so it can sub-allocate device memory blocks as well as buffers.
+	class LthRangeAllocator {
+	public:
+		static constexpr uint64_t INVALID_OFFSET = ~0ull;
+
+		LthRangeAllocator(uint64_t size);
+
+		LthRangeAllocator(const LthRangeAllocator&) = delete;
+		LthRangeAllocator& operator=(const LthRangeAllocator&) = delete;
+		LthRangeAllocator(LthRangeAllocator&&) = default;
+		LthRangeAllocator& operator=(LthRangeAllocator&&) = default;
+
+		// Returns INVALID_OFFSET if no free range can hold the request.
+		uint64_t allocate(uint64_t size, uint64_t alignment = 1);
+		void free(uint64_t offset);
+
+		uint64_t getSize() const { return size; }
+		uint64_t getUsedSize() const { return usedSize; }
+		uint64_t getAllocationSize(uint64_t offset) const;
+		uint32_t getAllocationCount() const { return static_cast<uint32_t>(allocatedRanges.size()); }
+		bool isEmpty() const { return allocatedRanges.empty(); }
+
+	private:
+		using FreeRangeIterator = std::map<uint64_t, uint64_t>::iterator;
+
+		void insertFreeRange(uint64_t offset, uint64_t size);
+		void eraseFreeRange(FreeRangeIterator range);
+
+		uint64_t size;
+		uint64_t usedSize = 0;
+
+		std::map<uint64_t, uint64_t> freeRangesByOffset{};
+		std::multimap<uint64_t, uint64_t> freeRangesBySize{};
+		std::unordered_map<uint64_t, uint64_t> allocatedRanges{};
+	};
+}
+
+#endif
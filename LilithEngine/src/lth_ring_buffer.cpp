@@ -0,0 +1,64 @@
+#include "lth_ring_buffer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lth {
+
+	LthRingBuffer::LthRingBuffer(LthDevice& device, VkDeviceSize size, VkBufferUsageFlags usageFlags) : lthDevice{ device } {
+		const VkPhysicalDeviceLimits& limits = lthDevice.physicalDeviceProperties.properties.limits;
+		defaultAlignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+		this->size = LthBuffer::getAlignment(size, defaultAlignment);
+
+		buffer = std::make_unique<LthBuffer>(
+			lthDevice,
+			this->size,
+			1,
+			usageFlags,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			defaultAlignment);
+		buffer->map();
+	}
+
+	void LthRingBuffer::beginFrame(int frameIndex) {
+		assert(frameIndex >= 0 && frameIndex < MAX_FRAMES_IN_FLIGHT && "Invalid frame index!");
+
+		// Frames are released in the order they were recorded, so the live bytes always stay contiguous behind the head.
+		usedSize -= frameSizes[frameIndex];
+		frameSizes[frameIndex] = 0;
+		currentFrame = frameIndex;
+	}
+
+	LthRingAllocation LthRingBuffer::allocate(VkDeviceSize allocationSize, VkDeviceSize alignment, VkDeviceSize bindingRange) {
+		if (alignment == 0) {
+			alignment = defaultAlignment;
+		}
+		assert(allocationSize <= size && "Allocation is bigger than the ring buffer!");
+		assert((bindingRange == 0 || allocationSize <= bindingRange) && "Allocation is bigger than its binding range!");
+		assert(bindingRange <= size && "Binding range is bigger than the ring buffer!");
+
+		// Only the allocation is consumed, the rest of the binding range may overlap the next allocations.
+		VkDeviceSize offset = LthBuffer::getAlignment(head, alignment);
+		if (offset + std::max(allocationSize, bindingRange) > size) {
+			// Not enough room before the end: skip the tail of the buffer and restart at the beginning.
+			offset = 0;
+		}
+		VkDeviceSize consumedSize = (offset >= head ? offset - head : size - head + offset) + allocationSize;
+
+		if (usedSize + consumedSize > size) {
+			throw std::runtime_error("Failed to allocate from the frame ring buffer, it is full!");
+		}
+
+		head = offset + allocationSize;
+		usedSize += consumedSize;
+		frameSizes[currentFrame] += consumedSize;
+
+		LthRingAllocation allocation{};
+		allocation.buffer = buffer->getBuffer();
+		allocation.offset = offset;
+		allocation.size = allocationSize;
+		allocation.mapped = static_cast<char*>(buffer->getMappedMemory()) + offset;
+		return allocation;
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef __LTH_RING_BUFFER_HPP__
+#define __LTH_RING_BUFFER_HPP__
+
+#include "lth_device.hpp"
+#include "lth_buffer.hpp"
+#include "lth_global_info.hpp"
+
+#include <array>
+#include <cstring>
+#include <memory>
+
+namespace lth {
+
+	// A transient sub-allocation of the ring buffer, valid until the same frame index comes back.
+	struct LthRingAllocation {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+
+		uint32_t dynamicOffset() const { return static_cast<uint32_t>(offset); }
+		VkDescriptorBufferInfo descriptorInfo() const { return { buffer, offset, size }; }
+	};
+
+	// Linear allocator over one persistently mapped host coherent buffer, shared by every per-frame upload
+	// (uniforms, transient vertex, instance or indirect draw data). Each frame index owns the bytes it allocated and gives them
+	// back in beginFrame, once the fence of that frame has been waited on.
+	class LthRingBuffer {
+	public:
+		static constexpr VkDeviceSize DEFAULT_SIZE = 4ull * 1024 * 1024;
+
+		LthRingBuffer(LthDevice& device,
+			VkDeviceSize size = DEFAULT_SIZE,
+			VkBufferUsageFlags usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+				| VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+		LthRingBuffer(const LthRingBuffer&) = delete;
+		LthRingBuffer& operator=(const LthRingBuffer&) = delete;
+
+		// Must be called after the fence of frameIndex has signaled, and before allocating for that frame.
+		void beginFrame(int frameIndex);
+
+		// Alignment defaults to the strictest of the uniform and storage buffer offset alignments. An allocation bound through
+		// a dynamic descriptor of bindingRange bytes is placed so that the whole range stays inside the buffer.
+		LthRingAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0, VkDeviceSize bindingRange = 0);
+		template<typename T>
+		LthRingAllocation push(const T& data, VkDeviceSize alignment = 0) {
+			LthRingAllocation allocation = allocate(sizeof(T), alignment);
+			memcpy(allocation.mapped, &data, sizeof(T));
+			return allocation;
+		}
+
+		// Descriptor for a dynamic buffer binding, the offset is given at bind time.
+		VkDescriptorBufferInfo dynamicDescriptorInfo(VkDeviceSize range) const { return { buffer->getBuffer(), 0, range }; }
+
+		VkBuffer getBuffer() const { return buffer->getBuffer(); }
+		VkDeviceSize getSize() const { return size; }
+		VkDeviceSize getUsedSize() const { return usedSize; }
+		VkDeviceSize getFrameUsedSize() const { return frameSizes[currentFrame]; }
+
+	private:
+		LthDevice& lthDevice;
+		std::unique_ptr<LthBuffer> buffer;
+		VkDeviceSize size;
+		VkDeviceSize defaultAlignment;
+
+		VkDeviceSize head = 0;
+		VkDeviceSize usedSize = 0; // Bytes between the oldest live frame and the head, including padding and wrap-around waste.
+		std::array<VkDeviceSize, MAX_FRAMES_IN_FLIGHT> frameSizes{};
+		int currentFrame = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "lth_sampler_cache.hpp"
+
+#include "lth_utils.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace lth {
+
+	// The create info fields from flags to unnormalizedCoordinates are 32 bits wide, so this range has no padding.
+	static constexpr size_t SAMPLER_KEY_OFFSET = offsetof(VkSamplerCreateInfo, flags);
+	static constexpr size_t SAMPLER_KEY_SIZE = offsetof(VkSamplerCreateInfo, unnormalizedCoordinates) + sizeof(VkBool32) - SAMPLER_KEY_OFFSET;
+
+	static const void* samplerKey(const VkSamplerCreateInfo& samplerInfo) {
+		return reinterpret_cast<const char*>(&samplerInfo) + SAMPLER_KEY_OFFSET;
+	}
+
+	LthSamplerCache::LthSamplerCache(VkDevice device) : device{ device } {}
+
+	LthSamplerCache::~LthSamplerCache() {
+		for (auto& bucket : samplers) {
+			for (auto& entry : bucket.second) {
+				vkDestroySampler(device, entry.sampler, nullptr);
+			}
+		}
+	}
+
+	VkSampler LthSamplerCache::getSampler(const VkSamplerCreateInfo& samplerInfo) {
+		assert(samplerInfo.pNext == nullptr && "Sampler create info extensions are not supported by the sampler cache.");
+
+		const uint64_t hash = fnv1a(samplerKey(samplerInfo), SAMPLER_KEY_SIZE);
+		std::lock_guard<std::mutex> lock{ mutex };
+		std::vector<Entry>& bucket = samplers[hash];
+		for (auto& entry : bucket) {
+			if (std::memcmp(samplerKey(entry.samplerInfo), samplerKey(samplerInfo), SAMPLER_KEY_SIZE) == 0) {
+				return entry.sampler;
+			}
+		}
+
+		VkSampler sampler;
+		if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create sampler!");
+		}
+		bucket.push_back({ samplerInfo, sampler });
+		return sampler;
+	}
+
+	uint32_t LthSamplerCache::getSamplerCount() {
+		std::lock_guard<std::mutex> lock{ mutex };
+		uint32_t count = 0;
+		for (auto& bucket : samplers) {
+			count += static_cast<uint32_t>(bucket.second.size());
+		}
+		return count;
+	}
+}
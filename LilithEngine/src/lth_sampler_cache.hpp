@@ -0,0 +1,40 @@
+#ifndef __LTH_SAMPLER_CACHE_HPP__
+#define __LTH_SAMPLER_CACHE_HPP__
+
+#include <volk.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace lth {
+
+	// Samplers shared by every texture and descriptor set layout of the device, one per distinct VkSamplerCreateInfo.
+	// The device limits the number of samplers (maxSamplerAllocationCount), not the number of textures sampling them.
+	class LthSamplerCache {
+	public:
+		LthSamplerCache(VkDevice device);
+		~LthSamplerCache();
+
+		LthSamplerCache(const LthSamplerCache&) = delete;
+		LthSamplerCache& operator=(const LthSamplerCache&) = delete;
+
+		// Creates the sampler the first time it is requested. The sampler belongs to the cache and lives as long as the
+		// device. Extension structures (pNext) are not supported.
+		VkSampler getSampler(const VkSamplerCreateInfo& samplerInfo);
+		uint32_t getSamplerCount();
+
+	private:
+		struct Entry {
+			VkSamplerCreateInfo samplerInfo;
+			VkSampler sampler;
+		};
+
+		VkDevice device;
+		std::mutex mutex;
+		std::unordered_map<uint64_t, std::vector<Entry>> samplers{}; // By hash of their create info.
+	};
+}
+
+#endif
@@ -1,10 +1,19 @@
 #include "lth_scene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
 
 namespace lth {
 
 	LthScene::LthScene(LthDevice& device) : lthDevice{ device } {
 		defaultTexture = LthTexture::createUniqueTextureFromFile(0, lthDevice, TEXTURESFOLDERPATH(DEFAULTTEXTURE), false);
+		defaultTexture->setDescriptorId(textureTable.allocateSlot(defaultTexture->imageInfo()));
 	}
 
 	void LthScene::clear() {
@@ -13,9 +22,48 @@ namespace lth {
 			vkDestroyAccelerationStructureKHR(lthDevice.getDevice(), tlas.handle, nullptr);
 		}
 
+		instanceArray.clear();
+		instanceGroups.clear();
+		instanceGroupsDirty = true;
+		instanceDraws.clear();
 		gameObjectMap.clear();
 		modelMap.clear();
+		for (auto& texture : textureMap) {
+			if (texture.second->getDescriptorId() != static_cast<uint32_t>(-1)) {
+				textureTable.freeSlot(texture.second->getDescriptorId(), defaultTexture->imageInfo());
+			}
+		}
 		textureMap.clear();
+
+		// The decodes cannot be cancelled, their pixels are freed here. The textures being uploaded wait for their batch.
+		for (auto& pending : pendingTextures) {
+			textureTable.freeSlot(pending->descriptorId, defaultTexture->imageInfo());
+			if (pending->texture) {
+				lthDevice.getUploadContext().wait(pending->uploadToken);
+			}
+			else {
+				try {
+					stbi_image_free(pending->decoded.get().pixels);
+				}
+				catch (const std::exception&) {}
+			}
+		}
+		pendingTextures.clear();
+
+		for (auto& streamed : streamedTextures) {
+			if (streamed.texture->isStreamingLevels()) {
+				lthDevice.getUploadContext().wait(streamed.uploadToken);
+			}
+		}
+		streamedTextures.clear();
+		for (auto& retired : retiredTextureImages) {
+			LthTexture::destroyImageResources(lthDevice, retired.resources);
+		}
+		retiredTextureImages.clear();
+		for (auto& retired : retiredTextures) {
+			lthDevice.getUploadContext().wait(retired.uploadToken);
+		}
+		retiredTextures.clear();
 	}
 
 	void LthScene::createTLAS() {
@@ -40,6 +88,8 @@ namespace lth {
 			tlasInstances.emplace_back(asInstance);
 		}
 
+		LthUploadContext::Batch uploadBatch{ lthDevice.getUploadContext() };
+
 		auto instancesBuffer = std::make_unique<LthBuffer>(
 			lthDevice,
 			sizeof(VkAccelerationStructureInstanceKHR),
@@ -73,11 +123,215 @@ namespace lth {
 
 		// (Almost) common part with blas
 		buildAccelerationStructure(lthDevice, VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, asGeometry, asBuildRangeInfo, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR, tlas);
-		
+		lthDevice.getUploadContext().keepAlive(std::move(instancesBuffer));
+
 		descriptorAccStructInfo.accelerationStructureCount = 1;
 		descriptorAccStructInfo.pAccelerationStructures = &tlas.handle;
 	}
 
+	const std::vector<LthInstanceGroup>& LthScene::getInstanceGroups() {
+		if (!instanceGroupsDirty) return instanceGroups;
+
+		std::unordered_map<id_t, size_t> groupIndices{};
+		instanceGroups.clear();
+		for (auto& instance : instanceArray) {
+			auto [groupIndex, inserted] = groupIndices.try_emplace(instance.second, instanceGroups.size());
+			if (inserted) {
+				instanceGroups.push_back({ instance.second, {} });
+			}
+			instanceGroups[groupIndex->second].gameObjects.push_back(gameObjectMap.at(instance.first));
+		}
+		std::stable_sort(instanceGroups.begin(), instanceGroups.end(), [this](const LthInstanceGroup& a, const LthInstanceGroup& b) {
+			return modelMap.at(a.modelId)->getGeometryRange().indexType == VK_INDEX_TYPE_UINT16
+				&& modelMap.at(b.modelId)->getGeometryRange().indexType != VK_INDEX_TYPE_UINT16;
+			});
+
+		instanceGroupsDirty = false;
+		return instanceGroups;
+	}
+
+	LthRingAllocation LthScene::writeInstanceBuffer(LthRingBuffer& frameRingBuffer, const LthCamera& camera, float viewportHeight) {
+		auto& groups = getInstanceGroups();
+
+		// World space bounding spheres of every instance, in group order.
+		frustumCuller.clear();
+		frustumCuller.reserve(instanceArray.size());
+		instanceModelMatrices.clear();
+		instanceModelMatrices.reserve(instanceArray.size());
+		for (auto& group : groups) {
+			const LthModel::Bounds& bounds = modelMap.at(group.modelId)->getBounds();
+			for (auto& obj : group.gameObjects) {
+				const glm::mat4 modelMatrix = obj->transform.modelMatrix();
+				const glm::vec3 scale = glm::abs(obj->transform.getScale());
+				instanceModelMatrices.push_back(modelMatrix);
+				frustumCuller.addSphere(
+					glm::vec3(modelMatrix * glm::vec4(bounds.sphereCenter, 1.f)),
+					bounds.sphereRadius * std::max({ scale.x, scale.y, scale.z }));
+			}
+		}
+
+		if (enableFrustumCulling) {
+			frustumCuller.cull(camera.getFrustumPlanes(), visibleInstances);
+		}
+		else {
+			visibleInstances.resize(instanceModelMatrices.size());
+			std::iota(visibleInstances.begin(), visibleInstances.end(), 0u);
+		}
+
+		if (visibleInstances.size() > FRAMEMAXINSTANCECOUNT) {
+			throw std::runtime_error("Failed to write the instance buffer, too many visible instances!");
+		}
+		LthRingAllocation allocation = frameRingBuffer.allocate(
+			sizeof(InstanceData) * std::max<size_t>(visibleInstances.size(), 1), 0, INSTANCE_BUFFER_RANGE);
+		InstanceData* instances = static_cast<InstanceData*>(allocation.mapped);
+
+		// A LOD error of e at distance d covers e * projectionScale / d pixels. The distance is taken from the sphere
+		// surface, and a camera inside the sphere always gets LOD 0.
+		const glm::vec3 cameraPosition = camera.getPosition();
+		const float projectionScale = std::abs(camera.getProjection()[1][1]) * viewportHeight * 0.5f;
+		auto selectLod = [&](const LthModel& model, uint32_t sphereIndex) {
+			const std::vector<LthModel::Lod>& lods = model.getLods();
+			if (!enableLodSelection || lods.size() < 2) return 0u;
+			const glm::vec4 sphere = frustumCuller.getSphere(sphereIndex);
+			const float distance = glm::length(glm::vec3(sphere) - cameraPosition) - sphere.w;
+			if (distance <= 0.f) return 0u;
+			// The world space sphere radius already carries the largest scale of the instance.
+			const float worldScale = sphere.w / std::max(model.getBounds().sphereRadius, std::numeric_limits<float>::min());
+			const float maxError = lodPixelError * distance / (projectionScale * worldScale);
+			uint32_t lod = static_cast<uint32_t>(lods.size()) - 1;
+			while (lod > 0 && lods[lod].error > maxError) --lod;
+			return lod;
+		};
+		// The texture of an instance covers about the diameter of its sphere on screen.
+		textureScreenSizes.assign(textureTable.getCapacity(), 0.f);
+		auto requestTextureSize = [&](const LthGameObject& obj, uint32_t sphereIndex) {
+			if (!(obj.flags & LTH_INSTANCE_FLAG_USES_COLOR_TEXTURE) || obj.textureId >= textureScreenSizes.size()) return;
+			const glm::vec4 sphere = frustumCuller.getSphere(sphereIndex);
+			const float distance = glm::length(glm::vec3(sphere) - cameraPosition) - sphere.w;
+			const float screenSize = distance <= 0.f ? std::numeric_limits<float>::max() : 2.f * sphere.w * projectionScale / distance;
+			textureScreenSizes[obj.textureId] = std::max(textureScreenSizes[obj.textureId], screenSize);
+		};
+
+		// The visible indices are sorted, so they are consumed group by group. Within a group, the instances are written
+		// LOD by LOD, one draw each. LOD 0 of the models with meshlets goes through the cluster culling pass instead.
+		const bool clusterCulling = enableClusterCulling && lthDevice.supportsDrawIndirectFirstInstance();
+		instanceDraws.clear();
+		clusterDraws.clear();
+		uint32_t clusterDrawCount = 0;
+		uint32_t instanceIndex = 0;
+		size_t visibleIndex = 0;
+		uint32_t groupStart = 0;
+		for (auto& group : groups) {
+			const auto& model = modelMap.at(group.modelId);
+			const LthGeometryRange& range = model->getGeometryRange();
+			const uint32_t groupEnd = groupStart + static_cast<uint32_t>(group.gameObjects.size());
+			const size_t groupVisibleBegin = visibleIndex;
+			visibleInstanceLods.clear();
+			for (; visibleIndex < visibleInstances.size() && visibleInstances[visibleIndex] < groupEnd; ++visibleIndex) {
+				visibleInstanceLods.push_back(selectLod(*model, visibleInstances[visibleIndex]));
+			}
+
+			const uint32_t lodCount = static_cast<uint32_t>(model->getLods().size());
+			for (uint32_t lod = 0; lod < lodCount && !visibleInstanceLods.empty(); ++lod) {
+				const uint32_t firstInstance = instanceIndex;
+				for (size_t i = 0; i < visibleInstanceLods.size(); ++i) {
+					if (visibleInstanceLods[i] != lod) continue;
+					const uint32_t sphereIndex = visibleInstances[groupVisibleBegin + i];
+					auto& obj = group.gameObjects[sphereIndex - groupStart];
+					obj->instanceIndex = instanceIndex;
+					requestTextureSize(*obj, sphereIndex);
+					InstanceData& instance = instances[instanceIndex++];
+					instance = obj->instanceData(instanceModelMatrices[sphereIndex]);
+					instance.vertexOffset = range.vertexOffset / sizeof(uint32_t);
+					instance.vertexFormat = model->getVertexFormat();
+				}
+				if (instanceIndex > firstInstance) {
+					const uint32_t meshletDrawCount = (instanceIndex - firstInstance) * range.meshletCount;
+					const bool clusterDraw = lod == 0 && clusterCulling && model->hasMeshlets()
+						&& clusterDrawCount + meshletDrawCount <= CLUSTER_MAX_DRAW_COUNT;
+					if (clusterDraw) {
+						clusterDrawCount += meshletDrawCount;
+					}
+					auto& draws = clusterDraw ? clusterDraws : instanceDraws;
+					draws.push_back({ group.modelId, firstInstance, instanceIndex - firstInstance, range.indexType, lod });
+				}
+			}
+			groupStart = groupEnd;
+		}
+		return allocation;
+	}
+
+	LthDrawCommands LthScene::writeDrawCommands(LthRingBuffer& frameRingBuffer) {
+		LthDrawCommands drawCommands{};
+		if (instanceDraws.empty()) return drawCommands;
+
+		drawCommands.allocation = frameRingBuffer.allocate(sizeof(VkDrawIndexedIndirectCommand) * instanceDraws.size(), sizeof(uint32_t));
+		VkDrawIndexedIndirectCommand* commands = static_cast<VkDrawIndexedIndirectCommand*>(drawCommands.allocation.mapped);
+
+		// Vertices are pulled with the offset of the InstanceData, indices stay relative to the model.
+		uint32_t drawIndex = 0;
+		for (auto& draw : instanceDraws) {
+			const auto& model = modelMap.at(draw.modelId);
+			const LthModel::Lod& lod = model->getLods()[draw.lod];
+			commands[drawIndex++] = VkDrawIndexedIndirectCommand{
+				.indexCount = lod.indexCount,
+				.instanceCount = draw.instanceCount,
+				.firstIndex = model->getGeometryRange().firstIndex() + lod.firstIndex,
+				.vertexOffset = 0,
+				.firstInstance = draw.firstInstance,
+			};
+			if (draw.indexType == VK_INDEX_TYPE_UINT16) {
+				++drawCommands.uint16DrawCount;
+			}
+			else {
+				++drawCommands.uint32DrawCount;
+			}
+		}
+		return drawCommands;
+	}
+
+	LthClusterCullingWork LthScene::writeClusterJobs(LthRingBuffer& frameRingBuffer) {
+		LthClusterCullingWork work{};
+		if (clusterDraws.empty()) return work;
+
+		for (auto& draw : clusterDraws) {
+			const uint32_t meshletCount = modelMap.at(draw.modelId)->getGeometryRange().meshletCount;
+			work.jobCount += draw.instanceCount * ((meshletCount + CLUSTER_JOB_SIZE - 1) / CLUSTER_JOB_SIZE);
+		}
+		work.jobs = frameRingBuffer.allocate(sizeof(LthClusterJob) * work.jobCount, 0, CLUSTER_JOBS_RANGE);
+		LthClusterJob* jobs = static_cast<LthClusterJob*>(work.jobs.mapped);
+
+		// Every instance gets a draw slot per meshlet, the draw slots of each index type are numbered from 0.
+		uint32_t jobIndex = 0;
+		for (auto& draw : clusterDraws) {
+			const auto& model = modelMap.at(draw.modelId);
+			const LthGeometryRange& range = model->getGeometryRange();
+			const bool uint16Indices = draw.indexType == VK_INDEX_TYPE_UINT16;
+			uint32_t& drawSlot = uint16Indices ? work.uint16DrawCapacity : work.uint32DrawCapacity;
+			for (uint32_t instance = draw.firstInstance; instance < draw.firstInstance + draw.instanceCount; ++instance) {
+				for (uint32_t meshlet = 0; meshlet < range.meshletCount; meshlet += CLUSTER_JOB_SIZE) {
+					const uint32_t meshletCount = std::min(CLUSTER_JOB_SIZE, range.meshletCount - meshlet);
+					jobs[jobIndex++] = LthClusterJob{
+						.instanceIndex = instance,
+						.firstMeshlet = range.meshletOffset + meshlet,
+						.meshletCount = meshletCount,
+						.firstIndex = range.firstIndex(),
+						.drawSlot = drawSlot,
+						.indexType = uint16Indices ? 0u : 1u,
+					};
+					drawSlot += meshletCount;
+				}
+			}
+		}
+
+		work.draws = frameRingBuffer.allocate(
+			CLUSTER_DRAW_COUNTS_SIZE + sizeof(VkDrawIndexedIndirectCommand) * (work.uint16DrawCapacity + work.uint32DrawCapacity),
+			0,
+			CLUSTER_DRAWS_RANGE);
+		std::memset(work.draws.mapped, 0, CLUSTER_DRAW_COUNTS_SIZE);
+		return work;
+	}
+
 	const std::shared_ptr<LthGameObject> LthScene::createGameObject() {
 		auto gameObject = std::make_shared<LthGameObject>(objId++);
 		gameObjectMap.insert({ gameObject->getId(), gameObject });
@@ -94,8 +348,9 @@ namespace lth {
 	}
 
 	std::shared_ptr<LthModel> LthScene::createModelFromFile(
-		const std::string& filePath) {
-		auto model = LthModel::createModelFromFile(modId++, lthDevice, filePath);
+		const std::string& filePath,
+		const LthModelLoadOptions& options) {
+		auto model = LthModel::createModelFromFile(modId++, lthDevice, geometryPool, filePath, options);
 		modelMap.insert({ model->getId(), model });
 		return model;
 	}
@@ -108,30 +363,224 @@ namespace lth {
 		textureMap.insert({ texture->getId(), texture });
 
 		if (addToDescriptor) {
-			if (textureDescriptorArrayCount >= TEXTUREARRAYSIZE) {
-				// In the future, may try to resize the texture array and the global descriptor set.
-				std::cerr << "Error: texture array max size is already reached. Can't load any more texture." << std::endl;
-
-				/*textureArray.resize(textureArray.size() + TEXTUREARRAYSIZE);
-				std::cout << "The texture array is too short. Resizing to " << textureArray.size() << "..." << std::endl;
-				assert(textureArray.size() < GLOBALPOOLMAXSETS && "Error: the texture array is too big and may not be handled correctly by the descriptor pool.");*/
-			}
-			texture->setDescriptorId(textureDescriptorArrayCount);
-			textureDescriptorArray[textureDescriptorArrayCount++] = texId;
+			texture->setDescriptorId(textureTable.allocateSlot(texture->imageInfo()));
 		}
 		texId++;
 		return texture;
 	}
 
-	std::vector<VkDescriptorImageInfo> const LthScene::getDescriptorImagesInfos() {
-		std::vector<VkDescriptorImageInfo> descriptorImagesInfos{};
-		for (int i = 0; i < TEXTUREARRAYSIZE; ++i) {
-			descriptorImagesInfos.push_back(
-				(textureDescriptorArray[i] == 0)
-				? defaultTexture->imageInfo()
-				: textureMap.at(textureDescriptorArray[i])->imageInfo());
+	LthTextureHandle LthScene::createTextureFromFileAsync(
+		const std::string& textureName,
+		bool generateMipmaps,
+		LthTextureCompression compression) {
+		auto pending = std::make_unique<PendingTexture>();
+		pending->descriptorId = textureTable.allocateSlot(defaultTexture->imageInfo()); // Until resident.
+		pending->textureId = texId++;
+		pending->filePath = TEXTURESFOLDERPATH(textureName);
+		pending->generateMipmaps = generateMipmaps;
+		if (!lthDevice.supportsTextureCompressionBC()) {
+			compression = LTH_TEXTURE_COMPRESSION_NONE;
+		}
+		LthThreadPool& threadPool = lthDevice.getThreadPool();
+		pending->decoded = threadPool.submit([filePath = pending->filePath, compression, generateMipmaps, &threadPool]() {
+			LthTexture::Builder builder{};
+			builder.loadConvertedTexture(filePath, compression, generateMipmaps, &threadPool);
+			return builder;
+		});
+
+		LthTextureHandle handle{ pending->textureId, pending->descriptorId, pending->resident.get_future().share() };
+		pendingTextures.push_back(std::move(pending));
+		return handle;
+	}
+
+	void LthScene::updateTextureLoads() {
+		LthUploadContext& uploadContext = lthDevice.getUploadContext();
+		// The decoded textures get an upload batch of their own, an outer batch would only be submitted when it ends.
+		const bool outerBatch = uploadContext.isRecording();
+
+		// The descriptor sets of the frames in flight are rewritten, and those frames completed, before the frame
+		// MAX_FRAMES_IN_FLIGHT calls later starts.
+		++textureFrame;
+		std::erase_if(retiredTextureImages, [this](RetiredTextureImage& retired) {
+			if (textureFrame < retired.frame + MAX_FRAMES_IN_FLIGHT) return false;
+			LthTexture::destroyImageResources(lthDevice, retired.resources);
+			return true;
+			});
+		std::erase_if(retiredTextures, [&](const RetiredTexture& retired) {
+			return textureFrame >= retired.frame + MAX_FRAMES_IN_FLIGHT && uploadContext.isComplete(retired.uploadToken);
+			});
+
+		bool recording = false;
+		for (auto& pending : pendingTextures) {
+			if (pending->texture) {
+				if (uploadContext.isComplete(pending->uploadToken)) {
+					textureMap.insert({ pending->textureId, pending->texture });
+					textureTable.setSlot(pending->descriptorId, pending->texture->imageInfo());
+					if (pending->texture->isStreamed()) {
+						streamedTextures.push_back({ pending->descriptorId, pending->texture });
+					}
+					pending->resident.set_value(pending->texture);
+					pending.reset();
+				}
+				continue;
+			}
+
+			if (outerBatch) continue;
+			if (pending->decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+
+			LthTexture::Builder builder{};
+			try {
+				builder = pending->decoded.get();
+			}
+			catch (const std::exception& e) {
+				std::cerr << "Failed to load texture " << pending->filePath << ": " << e.what() << std::endl;
+				pending->resident.set_exception(std::current_exception());
+				pending.reset();
+				continue;
+			}
+			if (!recording) {
+				uploadContext.begin();
+				recording = true;
+			}
+			if (enableTextureStreaming && !builder.image.levels.empty()) {
+				uint32_t tailLevel = 0;
+				while (tailLevel + 1 < builder.image.levels.size()
+					&& std::max(builder.image.levels[tailLevel].width, builder.image.levels[tailLevel].height) > TEXTURE_STREAMING_TAIL_SIZE) {
+					++tailLevel;
+				}
+				pending->texture = std::make_shared<LthTexture>(pending->textureId, lthDevice, std::move(builder), tailLevel);
+			}
+			else {
+				pending->texture = std::make_shared<LthTexture>(pending->textureId, lthDevice, builder, pending->generateMipmaps);
+			}
+			pending->texture->setDescriptorId(pending->descriptorId);
+		}
+
+		if (!outerBatch) {
+			updateTextureStreaming(uploadContext, recording);
+		}
+
+		if (recording) {
+			LthUploadToken uploadToken = uploadContext.submit();
+			for (auto& pending : pendingTextures) {
+				if (pending && pending->texture && pending->uploadToken == 0) {
+					pending->uploadToken = uploadToken;
+				}
+			}
+			for (auto& streamed : streamedTextures) {
+				if (streamed.texture->isStreamingLevels() && streamed.uploadToken == 0) {
+					streamed.uploadToken = uploadToken;
+				}
+			}
+		}
+		std::erase(pendingTextures, nullptr);
+	}
+
+	void LthScene::updateTextureStreaming(LthUploadContext& uploadContext, bool& recording) {
+		VkDeviceSize residentSize = 0;
+		std::vector<StreamedTexture*> finerTextures{};
+		std::vector<StreamedTexture*> coarserTextures{};
+		for (auto& streamed : streamedTextures) {
+			LthTexture& texture = *streamed.texture;
+			if (texture.isStreamingLevels()) {
+				if (streamed.uploadToken == 0 || !uploadContext.isComplete(streamed.uploadToken)) {
+					residentSize += texture.getResidentSize();
+					continue;
+				}
+				retiredTextureImages.push_back({ texture.finishLevelStreaming(), textureFrame });
+				streamed.uploadToken = 0;
+				textureTable.setSlot(streamed.descriptorId, texture.imageInfo());
+			}
+
+			const uint32_t lastLevel = texture.getMipLevels() - 1;
+			// No size before the first drawn frame, nor for the slots added since the last one: the texture is unused.
+			const float screenSize = streamed.descriptorId < textureScreenSizes.size() ? textureScreenSizes[streamed.descriptorId] : 0.f;
+			streamed.requestedLevel = lastLevel;
+			if (screenSize > 0.f) {
+				streamed.lastUseFrame = textureFrame;
+				const float levelsOverScreen = std::log2(std::max(texture.width(), texture.height()) / screenSize);
+				streamed.requestedLevel = static_cast<uint32_t>(std::clamp(std::floor(levelsOverScreen), 0.f, static_cast<float>(lastLevel)));
+			}
+
+			residentSize += texture.getResidentSize();
+			if (streamed.requestedLevel < texture.getFirstResidentLevel()) {
+				finerTextures.push_back(&streamed);
+			}
+			else if (streamed.requestedLevel > texture.getFirstResidentLevel()) {
+				coarserTextures.push_back(&streamed);
+			}
+		}
+
+		// Over the memory budget, the levels no instance needs are dropped, from the textures unused the longest. Their
+		// coarse levels are uploaded again, which is cheaper than a copy between images in different layouts.
+		VkDeviceSize uploadedSize = 0;
+		auto streamLevels = [&](StreamedTexture& streamed, uint32_t firstLevel) {
+			if (!recording) {
+				uploadContext.begin();
+				recording = true;
+			}
+			residentSize += streamed.texture->getLevelsSize(firstLevel) - streamed.texture->getResidentSize();
+			uploadedSize += streamed.texture->getLevelsSize(firstLevel);
+			streamed.texture->streamLevels(firstLevel);
+		};
+		if (residentSize > textureStreamingMemoryBudget) {
+			std::sort(coarserTextures.begin(), coarserTextures.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+				return a->lastUseFrame < b->lastUseFrame;
+				});
+			for (StreamedTexture* streamed : coarserTextures) {
+				if (residentSize <= textureStreamingMemoryBudget) break;
+				streamLevels(*streamed, streamed->requestedLevel);
+			}
+		}
+
+		// As many finer levels as the budgets allow. The first texture of the frame gets at least one level, so that a
+		// level larger than the frame budget still gets streamed.
+		std::sort(finerTextures.begin(), finerTextures.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+			return a->texture->getFirstResidentLevel() - a->requestedLevel > b->texture->getFirstResidentLevel() - b->requestedLevel;
+			});
+		for (StreamedTexture* streamed : finerTextures) {
+			LthTexture& texture = *streamed->texture;
+			uint32_t firstLevel = texture.getFirstResidentLevel();
+			while (firstLevel > streamed->requestedLevel) {
+				const VkDeviceSize levelsSize = texture.getLevelsSize(firstLevel - 1);
+				const bool firstUpload = uploadedSize == 0 && firstLevel == texture.getFirstResidentLevel();
+				if (!firstUpload && uploadedSize + levelsSize > textureStreamingFrameBudget) break;
+				if (residentSize + levelsSize - texture.getResidentSize() > textureStreamingMemoryBudget) break;
+				--firstLevel;
+			}
+			if (firstLevel < texture.getFirstResidentLevel()) {
+				streamLevels(*streamed, firstLevel);
+			}
+		}
+	}
+
+	void LthScene::unloadTexture(id_t index) {
+		auto textureIt = textureMap.find(index);
+		if (textureIt == textureMap.end()) return;
+
+		std::shared_ptr<LthTexture> texture = textureIt->second;
+		textureMap.erase(textureIt);
+		if (texture->getDescriptorId() != static_cast<uint32_t>(-1)) {
+			textureTable.freeSlot(texture->getDescriptorId(), defaultTexture->imageInfo());
+		}
+
+		LthUploadToken uploadToken = 0;
+		auto streamed = std::find_if(streamedTextures.begin(), streamedTextures.end(), [&](const StreamedTexture& streamed) {
+			return streamed.texture == texture;
+			});
+		if (streamed != streamedTextures.end()) {
+			uploadToken = streamed->uploadToken;
+			streamedTextures.erase(streamed);
+		}
+		retiredTextures.push_back({ std::move(texture), textureFrame, uploadToken });
+	}
+
+	VkDeviceSize LthScene::getStreamedTextureMemory() const {
+		VkDeviceSize size = 0;
+		for (auto& streamed : streamedTextures) {
+			size += streamed.texture->getResidentSize();
 		}
-		return descriptorImagesInfos;
+		return size;
 	}
 
 	VkDescriptorBufferInfo const LthScene::getTLASInfos() {
@@ -142,11 +591,13 @@ namespace lth {
 		if (gameObjectMap.at(gameObjectId)->getModelId() != modelId) {
 			gameObjectMap.at(gameObjectId)->setModel(modelId);
 			instanceArray.insert_or_assign(gameObjectId, modelId);
+			instanceGroupsDirty = true;
 		}
 	}
 
 	void LthScene::unlinkGameObjectToModel(id_t gameObjectId) {
 		gameObjectMap.at(gameObjectId)->setModel(0);
 		instanceArray.erase(gameObjectId);
+		instanceGroupsDirty = true;
 	}
 }
\ No newline at end of file
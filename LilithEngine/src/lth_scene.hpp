@@ -3,16 +3,87 @@
 
 #include "lth_scene_element.hpp"
 #include "lth_model.hpp"
+#include "lth_geometry_pool.hpp"
 #include "lth_texture.hpp"
+#include "lth_texture_table.hpp"
 #include "gameObjects/lth_game_object.hpp"
 #include "lth_global_info.hpp"
 #include "lth_acceleration_structure.hpp"
+#include "lth_ring_buffer.hpp"
+#include "lth_camera.hpp"
+#include "lth_frustum_culler.hpp"
+#include "lth_upload_context.hpp"
 
+#include <future>
 #include <type_traits>
 #include <glm/glm.hpp>
 
 namespace lth {
 
+	// Game objects sharing a model.
+	struct LthInstanceGroup {
+		id_t modelId;
+		std::vector<std::shared_ptr<LthGameObject>> gameObjects;
+	};
+
+	// Visible instances of a group at the same LOD in this frame, drawn with a single instanced draw. Their InstanceData
+	// are contiguous.
+	struct LthInstanceDraw {
+		id_t modelId;
+		uint32_t firstInstance; // Index of the first InstanceData of the draw in the instance buffer.
+		uint32_t instanceCount;
+		VkIndexType indexType;
+		uint32_t lod;
+	};
+
+	// Range of the dynamic instance buffer binding, every InstanceData array of a frame fits in it.
+	static constexpr VkDeviceSize INSTANCE_BUFFER_RANGE = sizeof(InstanceData) * FRAMEMAXINSTANCECOUNT;
+
+	// Indirect commands of the frame: the 16 bits indexed draws come first, then the 32 bits ones.
+	struct LthDrawCommands {
+		LthRingAllocation allocation{};
+		uint32_t uint16DrawCount = 0;
+		uint32_t uint32DrawCount = 0;
+	};
+
+	// Work item of the cluster culling pass (clusterCull.comp): up to CLUSTER_JOB_SIZE meshlets of one visible instance.
+	struct LthClusterJob {
+		uint32_t instanceIndex;
+		uint32_t firstMeshlet; // In the geometry pool meshlet buffer.
+		uint32_t meshletCount;
+		uint32_t firstIndex; // First index of the model in the geometry pool index buffer.
+		uint32_t drawSlot; // Draw command of the first meshlet, among the draws of its index type.
+		uint32_t indexType; // 0 for 16 bits indices, 1 for 32 bits.
+		uint32_t padding[2];
+	};
+	static_assert(sizeof(LthClusterJob) == 32, "LthClusterJob must match the ClusterJob layout of clusterCull.comp!");
+
+	// Cluster culling work of the frame. The draws allocation starts with the draw counts of both index types
+	// (CLUSTER_DRAW_COUNTS_SIZE bytes), followed by one VkDrawIndexedIndirectCommand slot per meshlet: the 16 bits
+	// indexed draws first, then the 32 bits ones.
+	struct LthClusterCullingWork {
+		LthRingAllocation jobs{};
+		LthRingAllocation draws{};
+		uint32_t jobCount = 0;
+		uint32_t uint16DrawCapacity = 0;
+		uint32_t uint32DrawCapacity = 0;
+	};
+	static constexpr uint32_t CLUSTER_JOB_SIZE = 64; // Workgroup size of clusterCull.comp.
+	static constexpr VkDeviceSize CLUSTER_DRAW_COUNTS_SIZE = 16;
+	// Meshlet draws per frame, the other LOD 0 draws of the models with meshlets skip the cluster culling pass.
+	// Bounds the ranges of the dynamic jobs and draws bindings, a job covers at least one meshlet.
+	static constexpr uint32_t CLUSTER_MAX_DRAW_COUNT = 1u << 17;
+	static constexpr VkDeviceSize CLUSTER_JOBS_RANGE = sizeof(LthClusterJob) * CLUSTER_MAX_DRAW_COUNT;
+	static constexpr VkDeviceSize CLUSTER_DRAWS_RANGE = CLUSTER_DRAW_COUNTS_SIZE + sizeof(VkDrawIndexedIndirectCommand) * CLUSTER_MAX_DRAW_COUNT;
+
+	// Texture requested with LthScene::createTextureFromFileAsync. Its descriptor slot samples the default texture until the
+	// texture is resident.
+	struct LthTextureHandle {
+		id_t textureId = 0;
+		uint32_t descriptorId = 0;
+		std::shared_future<std::shared_ptr<LthTexture>> texture; // Ready once resident, rethrows the loading error otherwise.
+	};
+
 	class LthScene {
 	public:
 		LthScene(LthDevice& device);
@@ -22,6 +93,31 @@ namespace lth {
 
 		void createTLAS();
 
+		// Culls the game objects linked to a model against the camera frustum, picks the LOD of the visible ones from their
+		// projected size, writes their InstanceData in the frame ring buffer grouped by model and LOD, and fills the
+		// instance draws of the frame. viewportHeight is in pixels.
+		LthRingAllocation writeInstanceBuffer(LthRingBuffer& frameRingBuffer, const LthCamera& camera, float viewportHeight);
+		// Writes one VkDrawIndexedIndirectCommand per instance draw, in the frame ring buffer.
+		// Every model is indexed (its BLAS needs it), so the whole scene is one indirect draw per index type.
+		LthDrawCommands writeDrawCommands(LthRingBuffer& frameRingBuffer);
+		// Writes the cluster culling jobs of the cluster draws in the frame ring buffer, and reserves their draw commands
+		// with zeroed draw counts.
+		LthClusterCullingWork writeClusterJobs(LthRingBuffer& frameRingBuffer);
+		// Rebuilt only when a game object is linked to or unlinked from a model. Sorted by index type.
+		const std::vector<LthInstanceGroup>& getInstanceGroups();
+		const std::vector<LthInstanceDraw>& getInstanceDraws() const { return instanceDraws; }
+		// Visible instances at LOD 0 of the models with meshlets, drawn meshlet by meshlet after the cluster culling pass.
+		const std::vector<LthInstanceDraw>& getClusterDraws() const { return clusterDraws; }
+		uint32_t getVisibleInstanceCount() const { return static_cast<uint32_t>(visibleInstances.size()); }
+
+		bool enableFrustumCulling = true; // Only the rasterization is culled, the TLAS keeps every instance.
+		bool enableLodSelection = true; // Only the rasterization uses the LODs, the BLASes are built from LOD 0.
+		float lodPixelError = 1.f; // Coarsest LOD whose error stays under this size on screen, in pixels.
+		bool enableClusterCulling = true; // Needs drawIndirectFirstInstance, the meshlet draws are indirect.
+		bool enableTextureStreaming = true; // The textures loaded with a precomputed mip chain then start with their coarse levels.
+		VkDeviceSize textureStreamingFrameBudget = 4ull << 20; // Bytes of texture levels uploaded per frame.
+		VkDeviceSize textureStreamingMemoryBudget = 64ull << 20; // Over it, the levels of the streamed textures no instance needs are dropped.
+
 		const std::shared_ptr<LthGameObject> createGameObject();
 		const std::shared_ptr<LthGameObject> createPointLight(
 			float intensity = 1.f,
@@ -31,9 +127,11 @@ namespace lth {
 		inline const ElementMap<LthGameObject>& gameObjects() const { return gameObjectMap; }
 		
 		std::shared_ptr<LthModel> createModelFromFile(
-			const std::string& filePath);
+			const std::string& filePath,
+			const LthModelLoadOptions& options = {});
 		inline const std::shared_ptr<LthModel> model(id_t index) const { return modelMap.at(index); }
 		inline const ElementMap<LthModel>& models() const { return modelMap; }
+		LthGeometryPool& getGeometryPool() { return geometryPool; }
 		
 		void linkGameObjectToModel(id_t gameObjectId, id_t modelId);
 		inline void linkGameObjectToModel(const std::shared_ptr<LthGameObject> gameObject, id_t modelId) {
@@ -55,10 +153,28 @@ namespace lth {
 			const std::string& textureName,
 			bool generateMipmaps = true,
 			bool addToDescriptor = true);
+		// Loads the file on the device thread pool, converted to a KTX2 file with its compressed mip chain on the first run
+		// (uncompressed if the device lacks BC formats). The loaded textures are uploaded by updateTextureLoads.
+		LthTextureHandle createTextureFromFileAsync(
+			const std::string& textureName,
+			bool generateMipmaps = true,
+			LthTextureCompression compression = LTH_TEXTURE_COMPRESSION_BC7);
+		// Called once per frame on the main thread, out of any upload batch: uploads the textures decoded since the last
+		// call and the levels requested by the instances of the previous frame in a single batch, and makes the ones whose
+		// upload completed resident. Never waits on the GPU.
+		void updateTextureLoads();
+		bool isTextureResident(id_t index) const { return textureMap.contains(index); }
+		uint32_t getPendingTextureCount() const { return static_cast<uint32_t>(pendingTextures.size()); }
+		uint32_t getStreamedTextureCount() const { return static_cast<uint32_t>(streamedTextures.size()); }
+		VkDeviceSize getStreamedTextureMemory() const; // Of the levels the streamed textures sample.
 		inline const std::shared_ptr<LthTexture> texture(id_t index) const { return textureMap.at(index); }
 		inline const ElementMap<LthTexture>& textures() const { return textureMap; }
+		// Frees the texture slot, the texture is destroyed once the frames in flight no longer sample it. The textures
+		// still loading cannot be unloaded.
+		void unloadTexture(id_t index);
+		// Slot 0 is the default texture, the textures take the slot of their descriptor id.
+		LthTextureTable& getTextureTable() { return textureTable; }
 
-		std::vector<VkDescriptorImageInfo> const getDescriptorImagesInfos();
 		VkDescriptorBufferInfo const getTLASInfos();
 		const std::unordered_map<id_t, id_t>& const getInstanceArray() { return instanceArray; }
 
@@ -66,6 +182,7 @@ namespace lth {
 
 	private:
 		LthDevice& lthDevice;
+		LthGeometryPool geometryPool{ lthDevice }; // Must outlive the models.
 
 		ElementMap<LthGameObject> gameObjectMap;
 		ElementMap<LthModel> modelMap;
@@ -75,12 +192,60 @@ namespace lth {
 		id_t modId = 1;
 		id_t texId = 1;
 
-		id_t textureDescriptorArray[TEXTUREARRAYSIZE] {};
-		uint32_t textureDescriptorArrayCount = 0;
+		LthTextureTable textureTable{ lthDevice };
 		std::unique_ptr<LthTexture> defaultTexture;
-		static_assert(TEXTUREARRAYSIZE < GLOBALPOOLMAXSETS && "Error: the texture array is too big and may not be handled correctly by the descriptor pool.");
+
+		struct PendingTexture {
+			id_t textureId;
+			uint32_t descriptorId;
+			std::string filePath;
+			bool generateMipmaps;
+			std::future<LthTexture::Builder> decoded;
+			std::promise<std::shared_ptr<LthTexture>> resident;
+			std::shared_ptr<LthTexture> texture{}; // Created once decoded, resident once its upload completed.
+			LthUploadToken uploadToken = 0;
+		};
+		std::vector<std::unique_ptr<PendingTexture>> pendingTextures{};
+
+		// The textures and images replaced or unloaded are destroyed once the frames in flight when it happened have
+		// completed, which updateTextureLoads counts.
+		struct RetiredTexture {
+			std::shared_ptr<LthTexture> texture;
+			uint64_t frame;
+			LthUploadToken uploadToken; // Of its levels being streamed, if any.
+		};
+		std::vector<RetiredTexture> retiredTextures{};
+		uint64_t textureFrame = 0;
+
+		// Level streaming. The instances request the level matching their size on screen, assuming their texture spans
+		// them once. The finer levels are streamed under the frame budget, the textures missing the most levels first.
+		static constexpr uint32_t TEXTURE_STREAMING_TAIL_SIZE = 64; // Largest level created with a streamed texture, in texels.
+		struct StreamedTexture {
+			uint32_t descriptorId;
+			std::shared_ptr<LthTexture> texture;
+			LthUploadToken uploadToken = 0; // Of the levels being streamed, if any.
+			uint32_t requestedLevel = 0;
+			uint64_t lastUseFrame = 0;
+		};
+		struct RetiredTextureImage {
+			LthTexture::ImageResources resources;
+			uint64_t frame;
+		};
+		// Finishes the completed level streaming and records the new one, in the batch started by updateTextureLoads.
+		void updateTextureStreaming(LthUploadContext& uploadContext, bool& recording);
+		std::vector<StreamedTexture> streamedTextures{};
+		std::vector<RetiredTextureImage> retiredTextureImages{};
+		std::vector<float> textureScreenSizes{}; // By descriptor id, largest of the instances drawn, in pixels.
 	
 		std::unordered_map<id_t, id_t> instanceArray {}; // Map of { gameObjectId, modelId }
+		std::vector<LthInstanceGroup> instanceGroups{};
+		bool instanceGroupsDirty = true;
+		std::vector<LthInstanceDraw> instanceDraws{};
+		std::vector<LthInstanceDraw> clusterDraws{};
+		LthFrustumCuller frustumCuller{};
+		std::vector<glm::mat4> instanceModelMatrices{};
+		std::vector<uint32_t> visibleInstances{};
+		std::vector<uint32_t> visibleInstanceLods{};
 		AccelerationStructure tlas{};
 		VkWriteDescriptorSetAccelerationStructureKHR descriptorAccStructInfo{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR };
 	};
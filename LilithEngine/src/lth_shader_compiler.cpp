@@ -1,26 +1,60 @@
 #include "lth_shader_compiler.hpp"
+#include "lth_global_info.hpp"
+#include "lth_utils.hpp"
 
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
+#include <functional>
+#include <thread>
 
 using namespace slang;
 using namespace Slang;
 
 namespace lth {
 
-	LthShaderCompiler::LthShaderCompiler(LthDevice& device) : lthDevice{ device } {
-		SlangGlobalSessionDesc globalSessionDesc = {};
-		globalSessionDesc.enableGLSL = true;
-		createGlobalSession(&globalSessionDesc, globalSession.writeRef());
+	static constexpr uint32_t SPIRVCACHEVERSION = 1; // To increase when the compilation changes in a way the key misses.
+	// Identifies the Slang compiler without loading it. Slang comes with the Vulkan SDK, whose headers give its version.
+	// SPIRVCACHEVERSION must be increased when Slang is updated apart from the SDK.
+	static constexpr uint32_t SLANGCOMPILERVERSION = VK_HEADER_VERSION_COMPLETE;
+	static constexpr const char* DEFAULTSLANGPROFILE = "spirv_1_4";
+
+	thread_local LthShaderCompiler::GlobalSessionScope* LthShaderCompiler::threadScope = nullptr;
+
+	LthShaderCompiler::GlobalSessionScope::GlobalSessionScope(LthShaderCompiler& compiler)
+		: compiler{ compiler }, ownsThread{ threadScope == nullptr } {
+		if (ownsThread) {
+			threadScope = this;
+		}
+	}
+
+	LthShaderCompiler::GlobalSessionScope::~GlobalSessionScope() {
+		if (!ownsThread) {
+			return;
+		}
+
+		threadScope = nullptr;
+		if (!globalSession) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock{ compiler.globalSessionsMutex };
+		compiler.freeGlobalSessions.push_back(std::move(globalSession));
+		--compiler.boundGlobalSessionCount;
+		compiler.globalSessionReleased.notify_one();
+	}
 
+	LthShaderCompiler::LthShaderCompiler(LthDevice& device) : lthDevice{ device } {
 		defaultSearchPaths = {};
 		defaultSearchPaths.push_back("shaders");
 		defaultSearchPaths.push_back("shaders/rayTracing");
 
 		defaultTargetDesc = {};
 		defaultTargetDesc.format = SLANG_SPIRV;
-		defaultTargetDesc.profile = globalSession->findProfile("spirv_1_4");
+		defaultTargetDesc.profile = SLANG_PROFILE_UNKNOWN; // DEFAULTSLANGPROFILE, resolved when the Slang session is created.
 		defaultTargetDesc.flags = 0;
 
 		defaultSessionDesc.searchPathCount = defaultSearchPaths.size();
@@ -30,25 +64,74 @@ namespace lth {
 		defaultSessionDesc.allowGLSLSyntax = true;
 	}
 
+	IGlobalSession* LthShaderCompiler::getGlobalSession() {
+		GlobalSessionScope* scope = threadScope;
+		if (scope == nullptr) {
+			throw std::runtime_error("Slang used outside of a global session scope!");
+		}
+		if (scope->globalSession) {
+			return scope->globalSession;
+		}
+
+		{
+			std::unique_lock<std::mutex> lock{ globalSessionsMutex };
+			globalSessionReleased.wait(lock, [this]() { return boundGlobalSessionCount < SLANGMAXGLOBALSESSIONS; });
+			++boundGlobalSessionCount;
+			if (!freeGlobalSessions.empty()) {
+				scope->globalSession = std::move(freeGlobalSessions.back());
+				freeGlobalSessions.pop_back();
+			}
+		}
+
+		// Created out of the lock, loading the core module takes a while.
+		if (!scope->globalSession) {
+			SlangGlobalSessionDesc globalSessionDesc = {};
+			globalSessionDesc.enableGLSL = true;
+			if (SLANG_FAILED(createGlobalSession(&globalSessionDesc, scope->globalSession.writeRef()))) {
+				std::lock_guard<std::mutex> lock{ globalSessionsMutex };
+				--boundGlobalSessionCount;
+				globalSessionReleased.notify_one();
+				throw std::runtime_error("Failed to create a slang global session.");
+			}
+		}
+		return scope->globalSession;
+	}
+
+	void LthShaderCompiler::releaseGlobalSessions() {
+		std::lock_guard<std::mutex> lock{ globalSessionsMutex };
+		freeGlobalSessions.clear();
+	}
+
 	LthSlangSession LthShaderCompiler::createSlangSession(const SessionDesc& sessionDesc) {
 		LthSlangSession lthSession;
-		if (SLANG_FAILED(globalSession->createSession(sessionDesc, lthSession.handle.writeRef()))) {
-			throw std::runtime_error("Failed to create a slang shader compilation session.");
-		}
 		lthSession.sessionDesc = sessionDesc;
 		return lthSession;
 	}
 
+	ComPtr<ISession> LthShaderCompiler::createSessionHandle(const SessionDesc& sessionDesc) {
+		IGlobalSession* globalSession = getGlobalSession();
+		std::vector<TargetDesc> targets(sessionDesc.targets, sessionDesc.targets + sessionDesc.targetCount);
+		for (TargetDesc& target : targets) {
+			if (target.profile == SLANG_PROFILE_UNKNOWN) {
+				target.profile = globalSession->findProfile(DEFAULTSLANGPROFILE);
+			}
+		}
+		SessionDesc resolvedSessionDesc = sessionDesc;
+		resolvedSessionDesc.targets = targets.data();
+
+		ComPtr<ISession> session;
+		if (SLANG_FAILED(globalSession->createSession(resolvedSessionDesc, session.writeRef()))) {
+			throw std::runtime_error("Failed to create a slang shader compilation session.");
+		}
+		return session;
+	}
+
 	VkShaderModule LthShaderCompiler::createShaderModule(
 		const std::string& filePath,
 		LthSlangSession* slangSession,
 		const std::string& entryPointName,
 		bool checkForUpdate) {
 
-		const uint32_t* pCode;
-		size_t codeSize;
-
-
 		if (filePath.ends_with(".spv")) {
 			std::ifstream file(filePath, std::ios::ate | std::ios::binary);
 
@@ -56,20 +139,39 @@ namespace lth {
 				throw std::runtime_error("Failed to open file: " + filePath + "!");
 			}
 
-			codeSize = static_cast<size_t>(file.tellg());
+			size_t codeSize = static_cast<size_t>(file.tellg());
 			std::vector<char> buffer(codeSize);
 
 			file.seekg(0);
 			file.read(buffer.data(), codeSize);
 			file.close();
 
-			pCode = reinterpret_cast<const uint32_t*>(buffer.data());
+			return createShaderModule(buffer.data(), buffer.size());
 		}
 		else if (filePath.ends_with(".slang")) {
 			if (slangSession == nullptr) {
 				throw std::runtime_error("Can't compile a slang shader without defining a proper slang session.");
 			}
 
+			uint64_t cacheKey = 0;
+			if (enableSpirvCache) {
+				cacheKey = spirvCacheKey(filePath, slangSession->sessionDesc, entryPointName);
+				CachedSpirv cachedSpirv;
+				if (loadCachedSpirv(cacheKey, cachedSpirv)) {
+					if (checkForUpdate) {
+						for (const auto& dependency : cachedSpirv.dependencies) {
+							slangSession->cachedFilesToUpdate[dependency.first] = dependency.second;
+						}
+					}
+					return createShaderModule(cachedSpirv.code.data(), cachedSpirv.code.size());
+				}
+			}
+
+			auto start = std::chrono::high_resolution_clock::now();
+			if (!slangSession->handle) {
+				slangSession->globalSession = getGlobalSession();
+				slangSession->handle = createSessionHandle(slangSession->sessionDesc);
+			}
 			ComPtr<IBlob> diagnosticBlob;
 			SlangResult result;
 			IModule* slangModule = slangSession->handle->loadModule(filePath.c_str(), diagnosticBlob.writeRef());
@@ -124,24 +226,46 @@ namespace lth {
 			if (SLANG_FAILED(result)) {
 				throw std::runtime_error("Failed to get the entry point of a slang composite component");
 			}
-
-			codeSize = spirvCode->getBufferSize();
-			pCode = reinterpret_cast<const uint32_t*>(spirvCode->getBufferPointer());
+			if (verbose) {
+				std::cout << "Compiled " << filePath << " (" << entryPointName << ") in "
+					<< std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+			}
 
 			if (checkForUpdate) {
 				IBlob* serializedModule;
 				slangModule->serialize(&serializedModule);
 				slangSession->modulesToUpdate[filePath] = serializedModule;				
 			}
+
+			// The dependencies of the module are its own source file and the ones of the modules it imports.
+			if (enableSpirvCache) {
+				CachedSpirv cachedSpirv;
+				bool hashed = true;
+				for (SlangInt32 i = 0; hashed && i < slangModule->getDependencyFileCount(); ++i) {
+					std::string dependencyPath = slangModule->getDependencyFilePath(i);
+					uint64_t hash;
+					hashed = hashFile(dependencyPath, hash);
+					cachedSpirv.dependencies.emplace_back(dependencyPath, hash);
+				}
+				if (hashed) {
+					const char* code = static_cast<const char*>(spirvCode->getBufferPointer());
+					cachedSpirv.code.assign(code, code + spirvCode->getBufferSize());
+					storeCachedSpirv(cacheKey, cachedSpirv);
+				}
+			}
+
+			return createShaderModule(spirvCode->getBufferPointer(), spirvCode->getBufferSize());
 		}
 		else {
 			throw std::runtime_error("Cannot generate a shader module out of a file that is neither a .spv or .slang file.");
 		}
+	}
 
+	VkShaderModule LthShaderCompiler::createShaderModule(const void* code, size_t codeSize) {
 		VkShaderModuleCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 		createInfo.codeSize = codeSize;
-		createInfo.pCode = pCode;
+		createInfo.pCode = static_cast<const uint32_t*>(code);
 
 		VkShaderModule shaderModule;
 		if (vkCreateShaderModule(lthDevice.getDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -152,24 +276,172 @@ namespace lth {
 	}
 
 	bool LthShaderCompiler::checkForUpdates(LthSlangSession& slangSession, bool autoRebootSession) {
-		Slang::ComPtr<slang::ISession> newSession;
-		if (SLANG_FAILED(globalSession->createSession(slangSession.sessionDesc, newSession.writeRef()))) {
-			throw std::runtime_error("Failed to create a slang shader compilation session.");
-		}
-
+		// Only the modules compiled by Slang need it, the cached ones are checked by content hash.
 		bool update = false;
-		for (auto& module : slangSession.modulesToUpdate) {
-			if (!newSession->isBinaryModuleUpToDate(module.first.c_str(), module.second)) {
-				std::cout << "The module " << module.first << " needs an update." << std::endl;
+		if (!slangSession.modulesToUpdate.empty()) {
+			ComPtr<ISession> newSession = createSessionHandle(slangSession.sessionDesc);
+			for (auto& module : slangSession.modulesToUpdate) {
+				if (!newSession->isBinaryModuleUpToDate(module.first.c_str(), module.second)) {
+					std::cout << "The module " << module.first << " needs an update." << std::endl;
+					update = true;
+				}
+			}
+		}
+		for (auto& file : slangSession.cachedFilesToUpdate) {
+			uint64_t hash;
+			if (!hashFile(file.first, hash) || hash != file.second) {
+				std::cout << "The module file " << file.first << " needs an update." << std::endl;
 				update = true;
 			}
 		}
 
+		// The next compilation creates the new session.
 		if (update && autoRebootSession) {
-			slangSession.handle = newSession;
+			slangSession.globalSession.setNull();
+			slangSession.handle.setNull();
 			slangSession.modulesToUpdate.clear();
+			slangSession.cachedFilesToUpdate.clear();
 		}
 		return update;
 	}
 
+	// Everything that changes the SPIR-V produced out of the same source files.
+	uint64_t LthShaderCompiler::spirvCacheKey(const std::string& filePath, const SessionDesc& sessionDesc, const std::string& entryPointName) {
+		auto hashString = [](const char* string, uint64_t hash) { return fnv1a(string, std::strlen(string) + 1, hash); };
+		auto hashValue = [](const auto& value, uint64_t hash) { return fnv1a(&value, sizeof(value), hash); };
+		auto hashOptions = [&](const CompilerOptionEntry* entries, uint32_t entryCount, uint64_t hash) {
+			hash = hashValue(entryCount, hash);
+			for (uint32_t i = 0; i < entryCount; ++i) {
+				const CompilerOptionEntry& entry = entries[i];
+				hash = hashValue(entry.name, hash);
+				hash = hashValue(entry.value.kind, hash);
+				hash = hashValue(entry.value.intValue0, hash);
+				hash = hashValue(entry.value.intValue1, hash);
+				hash = hashString(entry.value.stringValue0 ? entry.value.stringValue0 : "", hash);
+				hash = hashString(entry.value.stringValue1 ? entry.value.stringValue1 : "", hash);
+			}
+			return hash;
+		};
+
+		uint64_t hash = hashValue(SPIRVCACHEVERSION, FNV1A_OFFSET_BASIS);
+		hash = hashValue(SLANGCOMPILERVERSION, hash);
+		hash = hashString(filePath.c_str(), hash);
+		hash = hashString(entryPointName.c_str(), hash);
+		for (SlangInt i = 0; i < sessionDesc.targetCount; ++i) {
+			const TargetDesc& target = sessionDesc.targets[i];
+			hash = hashValue(target.format, hash);
+			hash = target.profile == SLANG_PROFILE_UNKNOWN ? hashString(DEFAULTSLANGPROFILE, hash) : hashValue(target.profile, hash);
+			hash = hashValue(target.flags, hash);
+			hash = hashValue(target.floatingPointMode, hash);
+			hash = hashValue(target.lineDirectiveMode, hash);
+			hash = hashValue(target.forceGLSLScalarBufferLayout, hash);
+			hash = hashOptions(target.compilerOptionEntries, target.compilerOptionEntryCount, hash);
+		}
+		for (SlangInt i = 0; i < sessionDesc.searchPathCount; ++i) {
+			hash = hashString(sessionDesc.searchPaths[i], hash);
+		}
+		for (SlangInt i = 0; i < sessionDesc.preprocessorMacroCount; ++i) {
+			hash = hashString(sessionDesc.preprocessorMacros[i].name, hash);
+			hash = hashString(sessionDesc.preprocessorMacros[i].value, hash);
+		}
+		hash = hashValue(sessionDesc.flags, hash);
+		hash = hashValue(sessionDesc.defaultMatrixLayoutMode, hash);
+		hash = hashValue(sessionDesc.allowGLSLSyntax, hash);
+		hash = hashOptions(sessionDesc.compilerOptionEntries, sessionDesc.compilerOptionEntryCount, hash);
+		return hash;
+	}
+
+	std::string LthShaderCompiler::spirvCachePath(uint64_t cacheKey) {
+		char fileName[32];
+		std::snprintf(fileName, sizeof(fileName), "%016llx.spv", static_cast<unsigned long long>(cacheKey));
+		return CACHEFOLDERPATH("spirv/" + std::string(fileName));
+	}
+
+	bool LthShaderCompiler::hashFile(const std::string& filePath, uint64_t& hash) {
+		std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		if (!file.read(buffer.data(), buffer.size())) {
+			return false;
+		}
+		hash = fnv1a(buffer.data(), buffer.size());
+		return true;
+	}
+
+	// Cache file: SpirvCacheHeader, then for each dependency its path length (uint32_t), path and content hash (uint64_t),
+	// then the SPIR-V code.
+	struct SpirvCacheHeader {
+		uint32_t magic;
+		uint32_t dependencyCount;
+		uint64_t cacheKey;
+		uint64_t codeSize;
+		uint64_t codeHash;
+	};
+	static constexpr uint32_t SPIRVCACHEMAGIC = 0x4353544c; // "LTSC"
+
+	bool LthShaderCompiler::loadCachedSpirv(uint64_t cacheKey, CachedSpirv& cachedSpirv) {
+		std::ifstream file(spirvCachePath(cacheKey), std::ios::binary);
+		SpirvCacheHeader header{};
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != SPIRVCACHEMAGIC || header.cacheKey != cacheKey) {
+			return false;
+		}
+
+		cachedSpirv.dependencies.resize(header.dependencyCount);
+		for (auto& dependency : cachedSpirv.dependencies) {
+			uint32_t pathLength = 0;
+			if (!file.read(reinterpret_cast<char*>(&pathLength), sizeof(pathLength)) || pathLength > 4096) {
+				return false;
+			}
+			dependency.first.resize(pathLength);
+			uint64_t currentHash;
+			if (!file.read(dependency.first.data(), pathLength)
+				|| !file.read(reinterpret_cast<char*>(&dependency.second), sizeof(dependency.second))
+				|| !hashFile(dependency.first, currentHash) || currentHash != dependency.second) {
+				return false;
+			}
+		}
+
+		cachedSpirv.code.resize(static_cast<size_t>(header.codeSize));
+		return file.read(cachedSpirv.code.data(), cachedSpirv.code.size())
+			&& fnv1a(cachedSpirv.code.data(), cachedSpirv.code.size()) == header.codeHash;
+	}
+
+	void LthShaderCompiler::storeCachedSpirv(uint64_t cacheKey, const CachedSpirv& cachedSpirv) {
+		SpirvCacheHeader header{};
+		header.magic = SPIRVCACHEMAGIC;
+		header.dependencyCount = static_cast<uint32_t>(cachedSpirv.dependencies.size());
+		header.cacheKey = cacheKey;
+		header.codeSize = cachedSpirv.code.size();
+		header.codeHash = fnv1a(cachedSpirv.code.data(), cachedSpirv.code.size());
+
+		// Written through a temporary file, so that a file is never left half written.
+		const std::string filePath = spirvCachePath(cacheKey);
+		// Two threads compiling the same entry point write their own temporary file.
+		const std::string tmpFilePath = filePath + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(filePath).parent_path(), error);
+		{
+			std::ofstream file(tmpFilePath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			for (const auto& dependency : cachedSpirv.dependencies) {
+				uint32_t pathLength = static_cast<uint32_t>(dependency.first.size());
+				file.write(reinterpret_cast<const char*>(&pathLength), sizeof(pathLength));
+				file.write(dependency.first.data(), pathLength);
+				file.write(reinterpret_cast<const char*>(&dependency.second), sizeof(dependency.second));
+			}
+			file.write(cachedSpirv.code.data(), cachedSpirv.code.size());
+			if (!file) {
+				std::cerr << "Failed to write the SPIR-V cache file " << tmpFilePath << std::endl;
+				return;
+			}
+		}
+		std::filesystem::rename(tmpFilePath, filePath, error);
+		if (error) {
+			std::cerr << "Failed to write the SPIR-V cache file " << filePath << ": " << error.message() << std::endl;
+		}
+	}
+
 }
\ No newline at end of file
@@ -5,18 +5,43 @@
 
 #include <slang/slang-com-ptr.h>
 #include <slang/slang.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace lth {
 
+	// Slang objects are not thread safe: a session is used by one thread at a time, and is created out of the global
+	// session bound to the thread that compiles with it (see LthShaderCompiler::GlobalSessionScope). The Slang session is
+	// only created by the first entry point the SPIR-V cache misses.
 	struct LthSlangSession {
 		slang::SessionDesc sessionDesc;
-		Slang::ComPtr<slang::ISession> handle;
+		Slang::ComPtr<slang::IGlobalSession> globalSession; // Kept alive with the session.
+		Slang::ComPtr<slang::ISession> handle; // Null until a compilation needs it.
 		std::unordered_map<std::string, slang::IBlob*> modulesToUpdate;
+		std::unordered_map<std::string, uint64_t> cachedFilesToUpdate; // Source files of the modules served by the SPIR-V cache, by content hash.
 	};
 
 	class LthShaderCompiler {
 	public:
+		// Allows the calling thread to use Slang while it lives. The first Slang call of the thread binds it a global session
+		// of the pool, waiting while SLANGMAXGLOBALSESSIONS are bound: a thread served by the SPIR-V cache never loads Slang.
+		// Nested scopes share the global session of the outer one.
+		struct GlobalSessionScope {
+			GlobalSessionScope(LthShaderCompiler& compiler);
+			~GlobalSessionScope();
+
+			GlobalSessionScope(const GlobalSessionScope&) = delete;
+			GlobalSessionScope& operator=(const GlobalSessionScope&) = delete;
+
+			LthShaderCompiler& compiler;
+			bool ownsThread;
+			Slang::ComPtr<slang::IGlobalSession> globalSession;
+		};
+
 		LthShaderCompiler(LthDevice& device);
 		~LthShaderCompiler() = default;
 
@@ -25,6 +50,9 @@ namespace lth {
 		LthShaderCompiler(LthShaderCompiler&&) = default;
 		LthShaderCompiler& operator=(LthShaderCompiler&&) = default;
 
+		// Sessions (and checkForUpdates, that recreates them) use the global session bound to the calling thread, so that
+		// pipelines can be compiled concurrently. See LthPipelineScheduler. The targets without a profile use
+		// DEFAULTSLANGPROFILE.
 		LthSlangSession createSlangSession(const slang::SessionDesc& sessionDesc);
 		LthSlangSession createDefaultSlangSession() { return createSlangSession(defaultSessionDesc); };
 
@@ -38,9 +66,41 @@ namespace lth {
 
 		bool checkForUpdates(LthSlangSession& slangSession, bool autoRebootSession = true);
 
+		// Slang shaders are compiled once: the SPIR-V of an entry point is stored on the disk with the content hashes of the
+		// source files of its module and of the modules it imports, and served as long as none of these files changes.
+		bool enableSpirvCache = true;
+		bool verbose = false; // Prints the duration of the Slang compilations.
+
+		// fnv1a of the content of the file. Returns false if it cannot be read.
+		static bool hashFile(const std::string& filePath, uint64_t& hash);
+
+		// Drops the unbound global sessions of the pool, once the compilations are done. The ones still used by a Slang
+		// session are released with it.
+		void releaseGlobalSessions();
+
 	private:
+		struct CachedSpirv {
+			std::vector<std::pair<std::string, uint64_t>> dependencies{}; // Source file path and content hash.
+			std::vector<char> code{};
+		};
+
+		VkShaderModule createShaderModule(const void* code, size_t codeSize);
+		Slang::ComPtr<slang::ISession> createSessionHandle(const slang::SessionDesc& sessionDesc);
+
+		uint64_t spirvCacheKey(const std::string& filePath, const slang::SessionDesc& sessionDesc, const std::string& entryPointName);
+		static std::string spirvCachePath(uint64_t cacheKey);
+		static bool loadCachedSpirv(uint64_t cacheKey, CachedSpirv& cachedSpirv);
+		static void storeCachedSpirv(uint64_t cacheKey, const CachedSpirv& cachedSpirv);
+
+
 		LthDevice& lthDevice;
-		Slang::ComPtr<slang::IGlobalSession> globalSession;
+		slang::IGlobalSession* getGlobalSession(); // Of the GlobalSessionScope of the calling thread, bound on first use.
+
+		std::mutex globalSessionsMutex;
+		std::condition_variable globalSessionReleased;
+		std::vector<Slang::ComPtr<slang::IGlobalSession>> freeGlobalSessions{};
+		uint32_t boundGlobalSessionCount = 0;
+		static thread_local GlobalSessionScope* threadScope;
 		slang::SessionDesc defaultSessionDesc;
 
 		std::vector<const char*> defaultSearchPaths;
@@ -49,13 +49,13 @@ namespace lth {
       for (int i = 0; i < colorImages.size(); i++) {
           vkDestroyImageView(lthDevice.getDevice(), colorImageViews[i], nullptr);
           vkDestroyImage(lthDevice.getDevice(), colorImages[i], nullptr);
-          vkFreeMemory(lthDevice.getDevice(), colorImageMemories[i], nullptr);
+          lthDevice.freeMemory(colorImageAllocations[i]);
       }
 
       for (int i = 0; i < depthImages.size(); i++) {
         vkDestroyImageView(lthDevice.getDevice(), depthImageViews[i], nullptr);
         vkDestroyImage(lthDevice.getDevice(), depthImages[i], nullptr);
-        vkFreeMemory(lthDevice.getDevice(), depthImageMemories[i], nullptr);
+        lthDevice.freeMemory(depthImageAllocations[i]);
       }
 
       for (auto framebuffer : mainFramebuffers) {
@@ -534,7 +534,7 @@ namespace lth {
     void LthSwapChain::createColorResources() {
 
         colorImages.resize(imageCount());
-        colorImageMemories.resize(imageCount());
+        colorImageAllocations.resize(imageCount());
         colorImageViews.resize(imageCount());
 
         for (int i = 0; i < colorImages.size(); i++) {
@@ -546,7 +546,7 @@ namespace lth {
                 VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                 colorImages[i],
-                colorImageMemories[i],
+                colorImageAllocations[i],
                 1,
                 lthDevice.getMsaaSamples());
             colorImageViews[i] = lthDevice.createImageView(colorImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
@@ -556,7 +556,7 @@ namespace lth {
     void LthSwapChain::createDepthResources() {
 
       depthImages.resize(imageCount());
-      depthImageMemories.resize(imageCount());
+      depthImageAllocations.resize(imageCount());
       depthImageViews.resize(imageCount());
 
       for (int i = 0; i < depthImages.size(); i++) {
@@ -568,7 +568,7 @@ namespace lth {
             VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             depthImages[i],
-            depthImageMemories[i],
+            depthImageAllocations[i],
             1,
             lthDevice.getMsaaSamples());
 
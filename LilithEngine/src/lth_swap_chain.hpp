@@ -81,10 +81,10 @@ class LthSwapChain {
   VkRenderPass guiRenderPass;
 
   std::vector<VkImage> colorImages;
-  std::vector<VkDeviceMemory> colorImageMemories;
+  std::vector<LthAllocation> colorImageAllocations;
   std::vector<VkImageView> colorImageViews;
   std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemories;
+  std::vector<LthAllocation> depthImageAllocations;
   std::vector<VkImageView> depthImageViews;
 
   std::vector<VkImage> swapChainImages;
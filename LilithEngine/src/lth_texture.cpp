@@ -1,8 +1,13 @@
 #include "lth_texture.hpp"
+#include "lth_upload_context.hpp"
+#include "lth_sampler_cache.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
 #include <stdexcept>
 
 namespace lth {
@@ -26,7 +31,7 @@ namespace lth {
 			VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			textureImage,
-			textureImageMemory,
+			textureImageAllocation,
 			mipLevels,
 			VK_SAMPLE_COUNT_1_BIT);
 
@@ -45,22 +50,50 @@ namespace lth {
 		texFormat{ builder.texFormat } {
 		
 
-		mipLevels = generateMipMaps ?
-			static_cast<uint32_t>(floor(log2(std::max(texWidth, texHeight)))) + 1 :
-			1;
-		createTextureImage(builder.pixels, builder.pixelSize);
+		if (!builder.image.levels.empty()) {
+			mipLevels = static_cast<uint32_t>(builder.image.levels.size());
+			createTextureImage(builder.image, 0, textureImage, textureImageAllocation);
+		}
+		else {
+			mipLevels = generateMipMaps ?
+				static_cast<uint32_t>(floor(log2(std::max(texWidth, texHeight)))) + 1 :
+				1;
+			createTextureImage(builder.pixels, builder.pixelSize);
+		}
+		createTextureImageView();
+		createTextureSampler();
+	}
+
+	LthTexture::LthTexture(id_t texId, LthDevice& device, LthTexture::Builder&& builder, uint32_t firstResidentLevel) :
+		LthSceneElement(texId), lthDevice{ device },
+		texWidth{ static_cast<uint32_t>(builder.texWidth) },
+		texHeight{ static_cast<uint32_t>(builder.texHeight) },
+		texFormat{ builder.texFormat },
+		mipLevels{ static_cast<uint32_t>(builder.image.levels.size()) },
+		streamedImage{ std::move(builder.image) } {
+
+		if (streamedImage.levels.empty()) {
+			throw std::runtime_error("Failed to create streamed texture, it has no precomputed mip chain!");
+		}
+
+		this->firstResidentLevel = std::min(firstResidentLevel, mipLevels - 1);
+		createTextureImage(streamedImage, this->firstResidentLevel, textureImage, textureImageAllocation);
 		createTextureImageView();
 		createTextureSampler();
 	}
 
 	LthTexture::~LthTexture() {
-		vkDestroySampler(lthDevice.getDevice(), textureSampler, nullptr);
+		destroyImageResources(lthDevice, streamingImage);
 		vkDestroyImageView(lthDevice.getDevice(), textureImageView, nullptr);
 		vkDestroyImage(lthDevice.getDevice(), textureImage, nullptr);
-		vkFreeMemory(lthDevice.getDevice(), textureImageMemory, nullptr);
+		lthDevice.freeMemory(textureImageAllocation);
 	};
 
 	bool LthTexture::Builder::loadTexture(const std::string& file) {
+		if (std::filesystem::path(file).extension() == ".ktx2") {
+			return loadKtx2(file);
+		}
+
         pixels = stbi_load(file.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 
         if (!pixels) {
@@ -73,6 +106,35 @@ namespace lth {
 		return true;
 	}
 
+	bool LthTexture::Builder::loadKtx2(const std::string& file) {
+		LthKtx2Image image{};
+		if (!LthKtx2::read(file, image)) {
+			throw std::runtime_error("Failed to load KTX2 texture image!");
+		}
+
+		setImage(std::move(image));
+		return true;
+	}
+
+	bool LthTexture::Builder::loadConvertedTexture(const std::string& sourcePath, LthTextureCompression compression, bool generateMipmaps, LthThreadPool* threadPool) {
+		LthKtx2Image image{};
+		if (!LthTextureConverter::loadOrConvert(sourcePath, compression, generateMipmaps, image, threadPool)) {
+			throw std::runtime_error("Failed to load texture image!");
+		}
+
+		setImage(std::move(image));
+		return true;
+	}
+
+	void LthTexture::Builder::setImage(LthKtx2Image&& image) {
+		texWidth = static_cast<int>(image.width);
+		texHeight = static_cast<int>(image.height);
+		texChannels = 4;
+		texFormat = image.format;
+		pixelSize = LthKtx2::isBlockCompressed(image.format) ? 0 : LthKtx2::getBlockSize(image.format);
+		this->image = std::move(image);
+	}
+
 	std::unique_ptr<LthTexture> LthTexture::createUniqueTextureFromFile(id_t texId, LthDevice& device, const std::string& filePath, bool generateMipmaps) {
 		Builder builder{};
 		builder.loadTexture(filePath);
@@ -87,22 +149,7 @@ namespace lth {
 		return std::make_shared<LthTexture>(texId, device, builder, generateMipmaps);
 	}
 
-    void LthTexture::createTextureImage(stbi_uc* pixels, VkDeviceSize pixelSize) {
-
-		uint32_t pixelCount = texWidth * texHeight;
-		LthBuffer stagingBuffer{
-			lthDevice,
-			pixelSize,
-			pixelCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
-
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer(pixels);
-
-		stbi_image_free(pixels);
-
+	void LthTexture::createTextureImage(stbi_uc* pixels, VkDeviceSize pixelSize) {
 		lthDevice.createImage(
 			texWidth,
 			texHeight,
@@ -111,37 +158,122 @@ namespace lth {
 			(VK_IMAGE_USAGE_TRANSFER_SRC_BIT * (mipLevels > 1)) | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			textureImage,
-			textureImageMemory,
+			textureImageAllocation,
 			mipLevels,
 			VK_SAMPLE_COUNT_1_BIT);
 
-		transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		lthDevice.copyBufferToImage(stagingBuffer.getBuffer(),
-			textureImage,
-			texWidth,
-			texHeight,
-			1);
+		LthUploadContext& uploadContext = lthDevice.getUploadContext();
+		LthUploadContext::Batch uploadBatch{ uploadContext };
+
+		uploadContext.transitionImageLayout(textureImage, texFormat, currentImageLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+		currentImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+		uploadContext.uploadToImage(pixels, pixelSize * texWidth * texHeight, textureImage, texWidth, texHeight);
+		stbi_image_free(pixels);
+
 		if (mipLevels == 1) {
-			transitionImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			uploadContext.transitionImageLayout(textureImage, texFormat, currentImageLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
+			currentImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		} else {
-			generateMipmaps(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);			
+			generateMipmaps(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		}
+	}
+
+	void LthTexture::createTextureImage(const LthKtx2Image& levelImage, uint32_t firstLevel, VkImage& image, LthAllocation& allocation) {
+		const std::vector<LthTextureLevel>& levels = levelImage.levels;
+		const uint32_t levelCount = static_cast<uint32_t>(levels.size()) - firstLevel;
+		lthDevice.createImage(
+			levels[firstLevel].width,
+			levels[firstLevel].height,
+			texFormat,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			image,
+			allocation,
+			levelCount,
+			VK_SAMPLE_COUNT_1_BIT);
+
+		LthUploadContext& uploadContext = lthDevice.getUploadContext();
+		LthUploadContext::Batch uploadBatch{ uploadContext };
+
+		uploadContext.transitionImageLayout(image, texFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount);
+
+		// The levels from firstLevel are contiguous, from the finest in converted images and from the coarsest in KTX2
+		// files, so they are copied from a single staging buffer, straight from the mapping of a file. There is nothing left
+		// to generate.
+		VkDeviceSize dataBegin = levels[firstLevel].offset;
+		VkDeviceSize dataEnd = dataBegin;
+		for (uint32_t level = firstLevel; level < levels.size(); ++level) {
+			dataBegin = std::min(dataBegin, levels[level].offset);
+			dataEnd = std::max(dataEnd, levels[level].offset + levels[level].size);
+		}
+		std::vector<VkBufferImageCopy> regions(levelCount);
+		for (uint32_t level = 0; level < levelCount; ++level) {
+			const LthTextureLevel& textureLevel = levels[firstLevel + level];
+			regions[level].bufferOffset = textureLevel.offset - dataBegin;
+			regions[level].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			regions[level].imageExtent = { textureLevel.width, textureLevel.height, 1 };
+		}
+		uploadContext.uploadToImage(levelImage.getData() + dataBegin, dataEnd - dataBegin, image, regions);
+
+		uploadContext.transitionImageLayout(image, texFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levelCount);
+		currentImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+	VkDeviceSize LthTexture::getLevelsSize(uint32_t firstLevel) const {
+		VkDeviceSize size = 0;
+		for (uint32_t level = firstLevel; level < streamedImage.levels.size(); ++level) {
+			size += streamedImage.levels[level].size;
 		}
-    }
+		return size;
+	}
+
+	void LthTexture::streamLevels(uint32_t firstLevel) {
+		assert(isStreamed() && !isStreamingLevels() && "Cannot stream the levels of a texture already streaming its levels.");
+
+		streamingFirstLevel = std::min(firstLevel, mipLevels - 1);
+		createTextureImage(streamedImage, streamingFirstLevel, streamingImage.image, streamingImage.allocation);
+		streamingImage.view = lthDevice.createImageView(streamingImage.image, texFormat, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - streamingFirstLevel);
+	}
+
+	LthTexture::ImageResources LthTexture::finishLevelStreaming() {
+		ImageResources previousImage{ textureImage, textureImageView, textureImageAllocation };
+		textureImage = streamingImage.image;
+		textureImageView = streamingImage.view;
+		textureImageAllocation = streamingImage.allocation;
+		firstResidentLevel = streamingFirstLevel;
+		streamingImage = {};
+		return previousImage;
+	}
+
+	void LthTexture::destroyImageResources(LthDevice& device, ImageResources& resources) {
+		if (resources.image == VK_NULL_HANDLE) return;
+
+		vkDestroyImageView(device.getDevice(), resources.view, nullptr);
+		vkDestroyImage(device.getDevice(), resources.image, nullptr);
+		device.freeMemory(resources.allocation);
+		resources = {};
+	}
 
 	void LthTexture::createTextureImageView() {
-		textureImageView = lthDevice.createImageView(textureImage, texFormat, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+		textureImageView = lthDevice.createImageView(textureImage, texFormat, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - firstResidentLevel);
 	}
 
 	void LthTexture::createTextureSampler() {
+		textureSampler = getSampler(lthDevice);
+	}
+
+	VkSampler LthTexture::getSampler(LthDevice& device) {
 		VkSamplerCreateInfo samplerInfo{};
 		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
 		samplerInfo.magFilter = VK_FILTER_LINEAR;
 		samplerInfo.minFilter = VK_FILTER_LINEAR;
 		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 		samplerInfo.anisotropyEnable = VK_TRUE;
-		samplerInfo.maxAnisotropy = lthDevice.physicalDeviceProperties.properties.limits.maxSamplerAnisotropy;
+		samplerInfo.maxAnisotropy = device.physicalDeviceProperties.properties.limits.maxSamplerAnisotropy;
 		samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
 		samplerInfo.unnormalizedCoordinates = VK_FALSE;
 		samplerInfo.compareEnable = VK_FALSE;
@@ -149,19 +281,19 @@ namespace lth {
 		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 		samplerInfo.mipLodBias = 0.f;
 		samplerInfo.minLod = 0.f;
-		samplerInfo.maxLod = static_cast<float>(mipLevels);
-
-		if (vkCreateSampler(lthDevice.getDevice(), &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create texture sampler!");
-		}
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // The image view holds the levels, so every texture shares this sampler.
 
+		return device.getSamplerCache().getSampler(samplerInfo);
 	}
 
 	void LthTexture::generateMipmaps(VkImageLayout newImageLayout) {
+		LthUploadContext& uploadContext = lthDevice.getUploadContext();
+		LthUploadContext::Batch uploadBatch{ uploadContext };
+
 		if (currentImageLayout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-			transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+			uploadContext.transitionImageLayout(textureImage, texFormat, currentImageLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
 		}
-		lthDevice.generateMipmaps(textureImage, texFormat, texWidth, texHeight, mipLevels, newImageLayout);
+		uploadContext.generateMipmaps(textureImage, texFormat, texWidth, texHeight, mipLevels, newImageLayout);
 
 		currentImageLayout = newImageLayout;
 	}
@@ -194,10 +326,9 @@ namespace lth {
 
 
 	void LthTexture::resizeImage(const VkExtent2D& extent) {
-		vkDestroySampler(lthDevice.getDevice(), textureSampler, nullptr);
 		vkDestroyImageView(lthDevice.getDevice(), textureImageView, nullptr);
 		vkDestroyImage(lthDevice.getDevice(), textureImage, nullptr);
-		vkFreeMemory(lthDevice.getDevice(), textureImageMemory, nullptr);
+		lthDevice.freeMemory(textureImageAllocation);
 
 		texWidth = extent.width;
 		texHeight = extent.height;
@@ -210,7 +341,7 @@ namespace lth {
 			VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			textureImage,
-			textureImageMemory,
+			textureImageAllocation,
 			mipLevels,
 			VK_SAMPLE_COUNT_1_BIT);
 
@@ -221,6 +352,5 @@ namespace lth {
 		clearImage(&defaultColor);
 		transitionImageLayout(VK_IMAGE_LAYOUT_GENERAL);
 		createTextureImageView();
-		createTextureSampler();
 	}
 }
\ No newline at end of file
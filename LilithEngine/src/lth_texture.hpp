@@ -5,10 +5,12 @@
 #include "lth_buffer.hpp"
 #include "lth_scene_element.hpp"
 #include "lth_renderer.hpp"
+#include "lth_texture_converter.hpp"
 
 #include <stb_image.h>
 
 #include <memory>
+#include <vector>
 
 namespace lth {
 
@@ -19,16 +21,27 @@ namespace lth {
 			int texWidth, texHeight, texChannels;
 			VkDeviceSize pixelSize;
 			VkFormat texFormat;
+			// Precomputed mip chain (KTX2), uploaded as is. pixels is null then.
+			LthKtx2Image image{};
 			VkDeviceSize texSize() const { return pixelSize * texWidth * texHeight; }
-			bool loadTexture(const std::string& filepath);
+			bool loadTexture(const std::string& filepath); // KTX2 files are read with loadKtx2.
+			bool loadKtx2(const std::string& filepath);
+			// Reads the KTX2 conversion of an image file, converting it first if needed (see LthTextureConverter).
+			bool loadConvertedTexture(const std::string& sourcePath, LthTextureCompression compression, bool generateMipmaps, LthThreadPool* threadPool = nullptr);
+			void setImage(LthKtx2Image&& image);
 		};
 
 		LthTexture(id_t texId, LthDevice& device, const LthRenderer& renderer);
 		LthTexture(id_t texId, LthDevice& device, const LthTexture::Builder& builder, bool generateMipmaps);
+		// Streamed texture, from a precomputed mip chain: keeps the chain in memory and only creates the levels from
+		// firstResidentLevel, the finer ones are added by streamLevels.
+		LthTexture(id_t texId, LthDevice& device, LthTexture::Builder&& builder, uint32_t firstResidentLevel);
 		~LthTexture();
 		
 		static std::shared_ptr<LthTexture> createTextureFromFile(id_t texId, LthDevice& device, const std::string& filePath, bool generateMipmaps = true);
 		static std::unique_ptr<LthTexture> createUniqueTextureFromFile(id_t texId, LthDevice& device, const std::string& filePath, bool generateMipmaps = true);
+		// Sampler of every texture, from the sampler cache of the device.
+		static VkSampler getSampler(LthDevice& device);
 
 		LthTexture(const LthTexture&) = delete;
 		LthTexture& operator=(const LthTexture&) = delete;
@@ -51,10 +64,34 @@ namespace lth {
 
 		VkDescriptorImageInfo imageInfo();
 
+		// The image, its view and its memory, destroyed together once no frame uses them anymore.
+		struct ImageResources {
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			LthAllocation allocation{};
+		};
+		static void destroyImageResources(LthDevice& device, ImageResources& resources);
+
+		// Level streaming. The image of a streamed texture only holds the levels from the first resident one, which is the
+		// base level of its view: the view clamps the sampled LOD, and the levels not resident take no device memory.
+		bool isStreamed() const { return !streamedImage.levels.empty(); }
+		uint32_t getFirstResidentLevel() const { return firstResidentLevel; }
+		VkDeviceSize getLevelSize(uint32_t level) const { return streamedImage.levels[level].size; }
+		VkDeviceSize getResidentSize() const { return getLevelsSize(firstResidentLevel); }
+		VkDeviceSize getLevelsSize(uint32_t firstLevel) const; // Of the levels from firstLevel to the last.
+		// Records in the current upload batch the creation of an image holding the levels from firstLevel, finer or
+		// coarser than the resident ones. The texture keeps sampling its current image until finishLevelStreaming.
+		void streamLevels(uint32_t firstLevel);
+		bool isStreamingLevels() const { return streamingImage.image != VK_NULL_HANDLE; }
+		// Swaps to the image of streamLevels once its upload completed. Returns the previous image, which the frames in
+		// flight may still sample.
+		ImageResources finishLevelStreaming();
+
 		VkImageView textureImageView;
-		VkSampler textureSampler;
+		VkSampler textureSampler; // Owned by the sampler cache of the device.
 	private:
 		void createTextureImage(stbi_uc* pixels, VkDeviceSize pixelSize);
+		void createTextureImage(const LthKtx2Image& levelImage, uint32_t firstLevel, VkImage& image, LthAllocation& allocation);
 		void createTextureImageView();
 		void createTextureSampler();
 		void generateMipmaps(VkImageLayout newImageLayout); // Indicate the output layout.
@@ -62,12 +99,17 @@ namespace lth {
 		LthDevice& lthDevice;
 		VkImage textureImage;
 		VkImageLayout currentImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		VkDeviceMemory textureImageMemory;
+		LthAllocation textureImageAllocation{};
 
 		uint32_t textureDescriptorId = -1;
 		uint32_t texWidth, texHeight;
 		VkFormat texFormat;
 		uint32_t mipLevels;
+
+		LthKtx2Image streamedImage{}; // Keeps the KTX2 file mapped while the texture is streamed.
+		uint32_t firstResidentLevel = 0;
+		ImageResources streamingImage{};
+		uint32_t streamingFirstLevel = 0;
 	};
 }
 
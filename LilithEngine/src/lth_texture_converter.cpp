@@ -0,0 +1,438 @@
+#include "lth_texture_converter.hpp"
+#include "lth_thread_pool.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <system_error>
+#include <vector>
+
+namespace lth {
+
+	namespace {
+
+		// Mip level being filtered, RGBA floats in [0, 1], linear for the sRGB formats.
+		struct FloatLevel {
+			uint32_t width;
+			uint32_t height;
+			std::vector<float> texels;
+		};
+
+		float srgbToLinear(float value) {
+			return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float linearToSrgb(float value) {
+			return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+		}
+
+		uint8_t toUnorm8(float value) {
+			return static_cast<uint8_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+		}
+
+		FloatLevel downsample(const FloatLevel& source) {
+			FloatLevel level{ std::max(source.width / 2, 1u), std::max(source.height / 2, 1u), {} };
+			level.texels.resize(size_t{ level.width } * level.height * 4);
+			for (uint32_t y = 0; y < level.height; ++y) {
+				const uint32_t y0 = std::min(y * 2, source.height - 1);
+				const uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+				for (uint32_t x = 0; x < level.width; ++x) {
+					const uint32_t x0 = std::min(x * 2, source.width - 1);
+					const uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+					for (uint32_t channel = 0; channel < 4; ++channel) {
+						auto texel = [&](uint32_t sx, uint32_t sy) { return source.texels[(size_t{ sy } * source.width + sx) * 4 + channel]; };
+						level.texels[(size_t{ y } * level.width + x) * 4 + channel] =
+							0.25f * (texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1));
+					}
+				}
+			}
+			return level;
+		}
+
+		// Principal axis of the points, by power iteration on their covariance. Null when the points are all equal.
+		template<typename Vec, typename Mat>
+		Vec principalAxis(const Vec* points, size_t count, const Vec& mean) {
+			Mat covariance{ 0.f };
+			Vec extent{ 0.f };
+			for (size_t i = 0; i < count; ++i) {
+				const Vec offset = points[i] - mean;
+				covariance += glm::outerProduct(offset, offset);
+				extent = glm::max(extent, glm::abs(offset));
+			}
+			Vec axis = extent;
+			if (glm::dot(axis, axis) < 1e-8f) return Vec{ 0.f };
+			for (int iteration = 0; iteration < 8; ++iteration) {
+				axis = covariance * axis;
+				const float length = glm::length(axis);
+				if (length < 1e-8f) return Vec{ 0.f };
+				axis /= length;
+			}
+			return axis;
+		}
+
+		// Endpoints of the points along their principal axis, inset by 1/16 of their range (as in most BC1 encoders,
+		// it trades the extreme texels for the inner ones).
+		template<typename Vec, typename Mat>
+		void fitEndpoints(const Vec* points, size_t count, Vec& endpoint0, Vec& endpoint1) {
+			Vec mean{ 0.f };
+			for (size_t i = 0; i < count; ++i) mean += points[i];
+			mean /= static_cast<float>(count);
+			const Vec axis = principalAxis<Vec, Mat>(points, count, mean);
+
+			float minProjection = 0.f;
+			float maxProjection = 0.f;
+			for (size_t i = 0; i < count; ++i) {
+				const float projection = glm::dot(points[i] - mean, axis);
+				minProjection = std::min(minProjection, projection);
+				maxProjection = std::max(maxProjection, projection);
+			}
+			const float inset = (maxProjection - minProjection) / 16.f;
+			endpoint0 = glm::clamp(mean + axis * (maxProjection - inset), Vec{ 0.f }, Vec{ 255.f });
+			endpoint1 = glm::clamp(mean + axis * (minProjection + inset), Vec{ 0.f }, Vec{ 255.f });
+		}
+
+		uint16_t packRgb565(const glm::vec3& color) {
+			const glm::vec3 scaled = glm::round(glm::clamp(color, glm::vec3{ 0.f }, glm::vec3{ 255.f }) * glm::vec3{ 31.f, 63.f, 31.f } / 255.f);
+			return static_cast<uint16_t>((static_cast<uint32_t>(scaled.r) << 11) | (static_cast<uint32_t>(scaled.g) << 5) | static_cast<uint32_t>(scaled.b));
+		}
+
+		glm::vec3 unpackRgb565(uint16_t color) {
+			const uint32_t r = (color >> 11) & 31;
+			const uint32_t g = (color >> 5) & 63;
+			const uint32_t b = color & 31;
+			return glm::vec3{ (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+		}
+
+		// Quantizes the endpoints and picks the closest of the 4 colors of the block for every texel.
+		float encodeBC1Colors(const glm::vec3 colors[16], const glm::vec3& endpoint0, const glm::vec3& endpoint1,
+			uint16_t& color0, uint16_t& color1, uint32_t& indices) {
+			color0 = packRgb565(endpoint0);
+			color1 = packRgb565(endpoint1);
+			// color0 > color1 selects the 4 colors mode, equal colors fall back to the 3 colors mode with index 0 only.
+			if (color0 < color1) std::swap(color0, color1);
+
+			const glm::vec3 palette0 = unpackRgb565(color0);
+			const glm::vec3 palette1 = unpackRgb565(color1);
+			const std::array<glm::vec3, 4> palette{ palette0, palette1, (2.f * palette0 + palette1) / 3.f, (palette0 + 2.f * palette1) / 3.f };
+			const uint32_t paletteSize = color0 == color1 ? 1 : 4;
+
+			float error = 0.f;
+			indices = 0;
+			for (uint32_t i = 0; i < 16; ++i) {
+				uint32_t bestIndex = 0;
+				float bestError = std::numeric_limits<float>::max();
+				for (uint32_t index = 0; index < paletteSize; ++index) {
+					const glm::vec3 difference = colors[i] - palette[index];
+					const float indexError = glm::dot(difference, difference);
+					if (indexError < bestError) {
+						bestError = indexError;
+						bestIndex = index;
+					}
+				}
+				indices |= bestIndex << (2 * i);
+				error += bestError;
+			}
+			return error;
+		}
+
+		// BC4 block of one channel, 8 interpolated values between the extremes.
+		void encodeBC4(const uint8_t values[16], uint8_t block[8]) {
+			const auto [minValue, maxValue] = std::minmax_element(values, values + 16);
+			block[0] = *maxValue;
+			block[1] = *minValue;
+			uint64_t indices = 0;
+			if (*maxValue != *minValue) {
+				std::array<int, 8> palette{ *maxValue, *minValue };
+				for (int index = 2; index < 8; ++index) {
+					palette[index] = ((8 - index) * *maxValue + (index - 1) * *minValue + 3) / 7;
+				}
+				for (uint32_t i = 0; i < 16; ++i) {
+					uint64_t bestIndex = 0;
+					for (uint64_t index = 1; index < 8; ++index) {
+						if (std::abs(values[i] - palette[index]) < std::abs(values[i] - palette[bestIndex])) bestIndex = index;
+					}
+					indices |= bestIndex << (3 * i);
+				}
+			}
+			for (uint32_t byte = 0; byte < 6; ++byte) {
+				block[2 + byte] = static_cast<uint8_t>(indices >> (8 * byte));
+			}
+		}
+
+		// Writes bit fields from the least significant bit of the block, as the BC7 layout is defined.
+		struct BitWriter {
+			uint8_t* block;
+			uint32_t position = 0;
+
+			void write(uint32_t value, uint32_t bitCount) {
+				for (uint32_t bit = 0; bit < bitCount; ++bit, ++position) {
+					block[position / 8] |= static_cast<uint8_t>(((value >> bit) & 1u) << (position % 8));
+				}
+			}
+		};
+
+		constexpr std::array<int, 16> BC7_WEIGHTS_4{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		void compressLevel(const std::vector<uint8_t>& texels, uint32_t width, uint32_t height, LthTextureCompression compression,
+			uint8_t* output, LthThreadPool* threadPool) {
+			if (compression == LTH_TEXTURE_COMPRESSION_NONE) {
+				std::memcpy(output, texels.data(), texels.size());
+				return;
+			}
+
+			const uint32_t blocksX = (width + 3) / 4;
+			const uint32_t blocksY = (height + 3) / 4;
+			const uint32_t blockSize = LthKtx2::getBlockSize(LthTextureConverter::getFormat(compression));
+			// The texels past the border of the image repeat the last row and column.
+			auto encodeBlockRows = [&](size_t begin, size_t end) {
+				uint8_t blockTexels[64];
+				for (size_t blockY = begin; blockY < end; ++blockY) {
+					for (uint32_t blockX = 0; blockX < blocksX; ++blockX) {
+						for (uint32_t i = 0; i < 16; ++i) {
+							const uint32_t x = std::min(blockX * 4 + i % 4, width - 1);
+							const uint32_t y = std::min(static_cast<uint32_t>(blockY) * 4 + i / 4, height - 1);
+							std::memcpy(blockTexels + i * 4, texels.data() + (size_t{ y } * width + x) * 4, 4);
+						}
+						uint8_t* block = output + (blockY * blocksX + blockX) * blockSize;
+						switch (compression) {
+						case LTH_TEXTURE_COMPRESSION_BC1: LthTextureConverter::encodeBC1(blockTexels, block); break;
+						case LTH_TEXTURE_COMPRESSION_BC5: LthTextureConverter::encodeBC5(blockTexels, block); break;
+						default: LthTextureConverter::encodeBC7(blockTexels, block); break;
+						}
+					}
+				}
+			};
+			if (threadPool) {
+				threadPool->parallelFor(blocksY, 4, encodeBlockRows);
+			}
+			else {
+				encodeBlockRows(0, blocksY);
+			}
+		}
+	}
+
+	VkFormat LthTextureConverter::getFormat(LthTextureCompression compression) {
+		switch (compression) {
+		case LTH_TEXTURE_COMPRESSION_BC1: return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+		case LTH_TEXTURE_COMPRESSION_BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case LTH_TEXTURE_COMPRESSION_BC7: return VK_FORMAT_BC7_SRGB_BLOCK;
+		default: return VK_FORMAT_R8G8B8A8_SRGB;
+		}
+	}
+
+	bool LthTextureConverter::loadOrConvert(const std::string& sourcePath, LthTextureCompression compression, bool generateMipmaps,
+		LthKtx2Image& image, LthThreadPool* threadPool) {
+		const std::string cachePath = getCachePath(sourcePath);
+
+		// A missing source leaves the converted file as the only version of the texture.
+		std::error_code sourceError;
+		std::error_code cacheError;
+		const auto sourceWriteTime = std::filesystem::last_write_time(sourcePath, sourceError);
+		const auto cacheWriteTime = std::filesystem::last_write_time(cachePath, cacheError);
+		if (!cacheError && (sourceError || cacheWriteTime >= sourceWriteTime) && LthKtx2::read(cachePath, image)) {
+			const bool fullChain = image.levels.size() == static_cast<size_t>(std::floor(std::log2(std::max(image.width, image.height)))) + 1;
+			if (image.format == getFormat(compression) && (generateMipmaps ? fullChain : image.levels.size() == 1)) {
+				return true;
+			}
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		if (!convert(sourcePath, compression, generateMipmaps, image, threadPool)) {
+			return false;
+		}
+		if (verbose) {
+			std::cout << "Converted " << sourcePath << " to KTX2 (" << image.levels.size() << " levels, " << image.data.size() / 1024 << " KiB) in "
+				<< std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+		}
+
+		if (!LthKtx2::write(cachePath, image)) {
+			std::cerr << "Failed to write the KTX2 file of " << sourcePath << std::endl;
+		}
+		return true;
+	}
+
+	bool LthTextureConverter::convert(const std::string& sourcePath, LthTextureCompression compression, bool generateMipmaps,
+		LthKtx2Image& image, LthThreadPool* threadPool) {
+		int width, height, channels;
+		stbi_uc* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		if (!pixels) {
+			return false;
+		}
+
+		const bool srgb = compression != LTH_TEXTURE_COMPRESSION_BC5;
+		FloatLevel level{ static_cast<uint32_t>(width), static_cast<uint32_t>(height), {} };
+		level.texels.resize(size_t{ level.width } * level.height * 4);
+		std::array<float, 256> unormToLinear{};
+		for (uint32_t value = 0; value < 256; ++value) {
+			unormToLinear[value] = srgb ? srgbToLinear(value / 255.f) : value / 255.f;
+		}
+		for (size_t i = 0; i < level.texels.size(); ++i) {
+			level.texels[i] = i % 4 == 3 ? pixels[i] / 255.f : unormToLinear[pixels[i]];
+		}
+		stbi_image_free(pixels);
+
+		image.format = getFormat(compression);
+		image.width = level.width;
+		image.height = level.height;
+		image.levels.clear();
+		image.data.clear();
+		image.file.reset(); // Unmaps a stale KTX2 file, before it is written again.
+		const uint32_t levelCount = generateMipmaps ? static_cast<uint32_t>(std::floor(std::log2(std::max(level.width, level.height)))) + 1 : 1;
+
+		std::vector<uint8_t> texels{};
+		for (uint32_t levelIndex = 0; levelIndex < levelCount; ++levelIndex) {
+			if (levelIndex > 0) {
+				level = downsample(level);
+			}
+			texels.resize(level.texels.size());
+			for (size_t i = 0; i < texels.size(); ++i) {
+				texels[i] = toUnorm8(i % 4 == 3 || !srgb ? level.texels[i] : linearToSrgb(level.texels[i]));
+			}
+
+			const uint64_t size = LthKtx2::getLevelSize(image.format, level.width, level.height);
+			image.levels.push_back({ image.data.size(), size, level.width, level.height });
+			image.data.resize(image.data.size() + size);
+			compressLevel(texels, level.width, level.height, compression, image.data.data() + image.levels.back().offset, threadPool);
+		}
+		return true;
+	}
+
+	void LthTextureConverter::encodeBC1(const uint8_t texels[64], uint8_t block[8]) {
+		glm::vec3 colors[16];
+		for (uint32_t i = 0; i < 16; ++i) {
+			colors[i] = glm::vec3{ texels[i * 4], texels[i * 4 + 1], texels[i * 4 + 2] };
+		}
+
+		glm::vec3 endpoint0, endpoint1;
+		fitEndpoints<glm::vec3, glm::mat3>(colors, 16, endpoint0, endpoint1);
+		uint16_t color0, color1;
+		uint32_t indices;
+		float error = encodeBC1Colors(colors, endpoint0, endpoint1, color0, color1, indices);
+
+		// Least squares endpoints for the chosen indices, each texel being a * color0 + (1 - a) * color1.
+		if (color0 != color1) {
+			constexpr std::array<float, 4> weights{ 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+			float aa = 0.f, ab = 0.f, bb = 0.f;
+			glm::vec3 ax{ 0.f }, bx{ 0.f };
+			for (uint32_t i = 0; i < 16; ++i) {
+				const float a = weights[(indices >> (2 * i)) & 3];
+				const float b = 1.f - a;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				ax += a * colors[i];
+				bx += b * colors[i];
+			}
+			const float determinant = aa * bb - ab * ab;
+			if (std::abs(determinant) > 1e-6f) {
+				const glm::vec3 refined0 = (ax * bb - bx * ab) / determinant;
+				const glm::vec3 refined1 = (bx * aa - ax * ab) / determinant;
+				uint16_t refinedColor0, refinedColor1;
+				uint32_t refinedIndices;
+				const float refinedError = encodeBC1Colors(colors, refined0, refined1, refinedColor0, refinedColor1, refinedIndices);
+				if (refinedError < error) {
+					color0 = refinedColor0;
+					color1 = refinedColor1;
+					indices = refinedIndices;
+				}
+			}
+		}
+
+		std::memcpy(block, &color0, 2);
+		std::memcpy(block + 2, &color1, 2);
+		std::memcpy(block + 4, &indices, 4);
+	}
+
+	void LthTextureConverter::encodeBC5(const uint8_t texels[64], uint8_t block[16]) {
+		uint8_t red[16], green[16];
+		for (uint32_t i = 0; i < 16; ++i) {
+			red[i] = texels[i * 4];
+			green[i] = texels[i * 4 + 1];
+		}
+		encodeBC4(red, block);
+		encodeBC4(green, block + 8);
+	}
+
+	void LthTextureConverter::encodeBC7(const uint8_t texels[64], uint8_t block[16]) {
+		glm::vec4 colors[16];
+		for (uint32_t i = 0; i < 16; ++i) {
+			colors[i] = glm::vec4{ texels[i * 4], texels[i * 4 + 1], texels[i * 4 + 2], texels[i * 4 + 3] };
+		}
+		glm::vec4 endpoint0, endpoint1;
+		fitEndpoints<glm::vec4, glm::mat4>(colors, 16, endpoint0, endpoint1);
+
+		// Mode 6 endpoints are 7 bits per channel plus a shared low bit per endpoint, the 4 combinations are tried.
+		std::array<glm::ivec4, 2> bestEndpoints{};
+		std::array<uint32_t, 2> bestPBits{};
+		std::array<uint32_t, 16> bestIndices{};
+		float bestError = std::numeric_limits<float>::max();
+		for (uint32_t pBits = 0; pBits < 4; ++pBits) {
+			const std::array<uint32_t, 2> p{ pBits & 1, pBits >> 1 };
+			std::array<glm::ivec4, 2> quantized{};
+			std::array<glm::ivec4, 2> expanded{};
+			for (uint32_t e = 0; e < 2; ++e) {
+				const glm::vec4& endpoint = e == 0 ? endpoint0 : endpoint1;
+				quantized[e] = glm::clamp(glm::ivec4(glm::round((endpoint - static_cast<float>(p[e])) / 2.f)), glm::ivec4{ 0 }, glm::ivec4{ 127 });
+				expanded[e] = quantized[e] * 2 + static_cast<int>(p[e]);
+			}
+
+			std::array<glm::vec4, 16> palette{};
+			for (uint32_t index = 0; index < 16; ++index) {
+				palette[index] = glm::vec4((expanded[0] * (64 - BC7_WEIGHTS_4[index]) + expanded[1] * BC7_WEIGHTS_4[index] + 32) / 64);
+			}
+			float error = 0.f;
+			std::array<uint32_t, 16> indices{};
+			for (uint32_t i = 0; i < 16; ++i) {
+				float texelError = std::numeric_limits<float>::max();
+				for (uint32_t index = 0; index < 16; ++index) {
+					const glm::vec4 difference = colors[i] - palette[index];
+					const float indexError = glm::dot(difference, difference);
+					if (indexError < texelError) {
+						texelError = indexError;
+						indices[i] = index;
+					}
+				}
+				error += texelError;
+			}
+			if (error < bestError) {
+				bestError = error;
+				bestEndpoints = quantized;
+				bestPBits = p;
+				bestIndices = indices;
+			}
+		}
+
+		// The most significant bit of the first index is implicit and zero: the endpoints are swapped to make it so, the
+		// weights being symmetric.
+		if (bestIndices[0] >= 8) {
+			std::swap(bestEndpoints[0], bestEndpoints[1]);
+			std::swap(bestPBits[0], bestPBits[1]);
+			for (uint32_t& index : bestIndices) index = 15 - index;
+		}
+
+		std::memset(block, 0, 16);
+		BitWriter writer{ block };
+		writer.write(1u << 6, 7); // Mode 6.
+		for (int channel = 0; channel < 4; ++channel) {
+			writer.write(static_cast<uint32_t>(bestEndpoints[0][channel]), 7);
+			writer.write(static_cast<uint32_t>(bestEndpoints[1][channel]), 7);
+		}
+		writer.write(bestPBits[0], 1);
+		writer.write(bestPBits[1], 1);
+		writer.write(bestIndices[0], 3);
+		for (uint32_t i = 1; i < 16; ++i) {
+			writer.write(bestIndices[i], 4);
+		}
+	}
+}
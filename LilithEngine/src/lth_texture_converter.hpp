@@ -0,0 +1,46 @@
+#ifndef __LTH_TEXTURE_CONVERTER_HPP__
+#define __LTH_TEXTURE_CONVERTER_HPP__
+
+#include "lth_ktx2.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace lth {
+
+	class LthThreadPool;
+
+	enum LthTextureCompression : uint32_t {
+		LTH_TEXTURE_COMPRESSION_NONE, // sRGB RGBA8, only the mip chain is precomputed.
+		LTH_TEXTURE_COMPRESSION_BC1, // Opaque sRGB color, 8 bytes per 4x4 block.
+		LTH_TEXTURE_COMPRESSION_BC5, // Red and green unorm channels (normal maps), 16 bytes per block.
+		LTH_TEXTURE_COMPRESSION_BC7, // sRGB color and alpha, 16 bytes per block.
+	};
+
+	// Converts image files (PNG, BMP... anything stb_image decodes) to KTX2 files holding their whole mip chain, block
+	// compressed. The encoders favour speed over quality: BC1 endpoints come from the principal axis of the block colors
+	// and are refined once by least squares, BC7 only uses mode 6 (one subset, RGBA endpoints, 16 weights).
+	class LthTextureConverter {
+	public:
+		static inline bool verbose = false; // Prints the size and the duration of the conversions.
+
+		static std::string getCachePath(const std::string& sourcePath) { return sourcePath + ".ktx2"; }
+		static VkFormat getFormat(LthTextureCompression compression);
+
+		// Reads the KTX2 file converted from the source if it is newer than the source and was converted with these
+		// settings. Otherwise converts the source and writes that file for the next runs, which a failure does not prevent.
+		static bool loadOrConvert(const std::string& sourcePath, LthTextureCompression compression, bool generateMipmaps,
+			LthKtx2Image& image, LthThreadPool* threadPool = nullptr);
+		// The mip chain is filtered in linear space for the sRGB formats. The blocks of a level are compressed on the
+		// thread pool, if any.
+		static bool convert(const std::string& sourcePath, LthTextureCompression compression, bool generateMipmaps,
+			LthKtx2Image& image, LthThreadPool* threadPool = nullptr);
+
+		// Block encoders, from the 4x4 RGBA8 texels of the block in row order.
+		static void encodeBC1(const uint8_t texels[64], uint8_t block[8]);
+		static void encodeBC5(const uint8_t texels[64], uint8_t block[16]);
+		static void encodeBC7(const uint8_t texels[64], uint8_t block[16]);
+	};
+}
+
+#endif
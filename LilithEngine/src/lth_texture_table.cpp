@@ -0,0 +1,110 @@
+#include "lth_texture_table.hpp"
+#include "lth_texture.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lth {
+
+	LthTextureTable::LthTextureTable(LthDevice& device, uint32_t initialCapacity) : lthDevice{ device } {
+		maxCapacity = std::min(TEXTURETABLEMAXCAPACITY, lthDevice.getMaxBindlessTextureCount());
+		images.resize(std::clamp(initialCapacity, 1u, maxCapacity));
+
+		// The descriptor count of a variable count binding is its upper bound, each set is allocated with its own count.
+		// Partially bound: the slots never handed out are not written.
+		// Every texture uses the same sampler, baked in the layout.
+		setLayout = LthDescriptorSetLayout::Builder(lthDevice)
+			.addImmutableSamplerBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, LthTexture::getSampler(lthDevice), maxCapacity,
+				VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT)
+			.build();
+	}
+
+	uint32_t LthTextureTable::allocateSlot(const VkDescriptorImageInfo& image) {
+		uint32_t slot;
+		if (!freeSlots.empty()) {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			if (slotCount == images.size()) {
+				if (images.size() == maxCapacity) {
+					throw std::runtime_error("Failed to allocate a texture slot, the texture table is full!");
+				}
+				images.resize(std::min<size_t>(images.size() * 2, maxCapacity));
+			}
+			slot = slotCount++;
+		}
+
+		setSlot(slot, image);
+		return slot;
+	}
+
+	void LthTextureTable::freeSlot(uint32_t slot, const VkDescriptorImageInfo& image) {
+		setSlot(slot, image);
+		freeSlots.push_back(slot);
+	}
+
+	void LthTextureTable::setSlot(uint32_t slot, const VkDescriptorImageInfo& image) {
+		images[slot] = image;
+		markDirty(slot);
+	}
+
+	void LthTextureTable::markDirty(uint32_t slot) {
+		for (auto& frameSet : frameSets) {
+			frameSet.dirtySlots.push_back(slot);
+		}
+	}
+
+	VkDescriptorSet LthTextureTable::updateFrame(int frameIndex) {
+		FrameSet& frameSet = frameSets[frameIndex];
+		lastWriteCount = 0;
+
+		// The set of the frame is no longer in use, it is replaced by one of the current capacity, fully written.
+		if (frameSet.capacity < images.size()) {
+			const uint32_t capacity = static_cast<uint32_t>(images.size());
+			frameSet.pool = LthDescriptorPool::Builder(lthDevice)
+				.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity)
+				.setMaxSets(1)
+				.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+				.build();
+			if (!frameSet.pool->allocateVariableDescriptorSet(setLayout->getDescriptorSetLayout(), frameSet.set, capacity)) {
+				throw std::runtime_error("Failed to allocate the texture table descriptor set!");
+			}
+			frameSet.capacity = capacity;
+			frameSet.dirtySlots.resize(slotCount);
+			for (uint32_t slot = 0; slot < slotCount; ++slot) {
+				frameSet.dirtySlots[slot] = slot;
+			}
+		}
+		if (frameSet.dirtySlots.empty()) return frameSet.set;
+
+		// One write per run of consecutive slots.
+		std::sort(frameSet.dirtySlots.begin(), frameSet.dirtySlots.end());
+		frameSet.dirtySlots.erase(std::unique(frameSet.dirtySlots.begin(), frameSet.dirtySlots.end()), frameSet.dirtySlots.end());
+		std::vector<VkWriteDescriptorSet> writes{};
+		for (size_t i = 0; i < frameSet.dirtySlots.size();) {
+			const uint32_t firstSlot = frameSet.dirtySlots[i];
+			uint32_t count = 1;
+			while (i + count < frameSet.dirtySlots.size() && frameSet.dirtySlots[i + count] == firstSlot + count) {
+				++count;
+			}
+
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = frameSet.set;
+			write.dstBinding = 0;
+			write.dstArrayElement = firstSlot;
+			write.descriptorCount = count;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			write.pImageInfo = images.data() + firstSlot;
+			writes.push_back(write);
+
+			lastWriteCount += count;
+			i += count;
+		}
+		vkUpdateDescriptorSets(lthDevice.getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		frameSet.dirtySlots.clear();
+
+		return frameSet.set;
+	}
+}
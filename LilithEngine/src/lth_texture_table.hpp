@@ -0,0 +1,64 @@
+#ifndef __LTH_TEXTURE_TABLE_HPP__
+#define __LTH_TEXTURE_TABLE_HPP__
+
+#include "lth_device.hpp"
+#include "lth_descriptors.hpp"
+#include "lth_global_info.hpp"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace lth {
+
+	// Bindless array of the sampled textures (descriptor indexing), indexed by the texture slot of the InstanceData.
+	// Every frame in flight has its own descriptor set, in which only the slots changed since its last frame are
+	// written, once that frame completed: a slot is never written while a frame samples it, and no frame waits.
+	// The slots are handed out through a free list. When they run out, the capacity doubles, up to the device limit,
+	// and each set is reallocated with the new capacity at its next update.
+	class LthTextureTable {
+	public:
+		LthTextureTable(LthDevice& device, uint32_t initialCapacity = TEXTURETABLEINITIALCAPACITY);
+
+		LthTextureTable(const LthTextureTable&) = delete;
+		LthTextureTable& operator=(const LthTextureTable&) = delete;
+
+		// The slot samples image until setSlot. Throws once the table cannot grow anymore.
+		uint32_t allocateSlot(const VkDescriptorImageInfo& image);
+		// The slot samples image until reused. The frames in flight may still sample the previous one, which must
+		// outlive them.
+		void freeSlot(uint32_t slot, const VkDescriptorImageInfo& image);
+		void setSlot(uint32_t slot, const VkDescriptorImageInfo& image);
+
+		// Called once the previous frame with this index completed: writes the slots changed since then in the set of
+		// the frame, and returns it.
+		VkDescriptorSet updateFrame(int frameIndex);
+
+		const LthDescriptorSetLayout& getSetLayout() const { return *setLayout; }
+		uint32_t getCapacity() const { return static_cast<uint32_t>(images.size()); }
+		uint32_t getMaxCapacity() const { return maxCapacity; }
+		uint32_t getUsedSlotCount() const { return slotCount - static_cast<uint32_t>(freeSlots.size()); }
+		uint32_t getLastWriteCount() const { return lastWriteCount; } // Descriptors written by the last updateFrame.
+
+	private:
+		void markDirty(uint32_t slot);
+
+		struct FrameSet {
+			std::unique_ptr<LthDescriptorPool> pool{}; // Holds the set alone, replaced with it when the table grows.
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			uint32_t capacity = 0;
+			std::vector<uint32_t> dirtySlots{};
+		};
+
+		LthDevice& lthDevice;
+		std::unique_ptr<LthDescriptorSetLayout> setLayout{};
+		uint32_t maxCapacity;
+		std::vector<VkDescriptorImageInfo> images{}; // Content of every slot, one per slot of the capacity.
+		std::vector<uint32_t> freeSlots{};
+		uint32_t slotCount = 0; // Slots handed out at least once, the others are not written.
+		std::array<FrameSet, MAX_FRAMES_IN_FLIGHT> frameSets{};
+		uint32_t lastWriteCount = 0;
+	};
+}
+
+#endif
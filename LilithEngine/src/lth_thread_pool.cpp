@@ -0,0 +1,120 @@
+#include "lth_thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace lth {
+
+	LthThreadPool::LthThreadPool(uint32_t threadCount) {
+		threadCount = std::max(threadCount, 1u);
+		workers.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; ++i) {
+			workers.emplace_back([this]() { workerLoop(); });
+		}
+	}
+
+	LthThreadPool::~LthThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+		condition.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	uint32_t LthThreadPool::defaultThreadCount() {
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	void LthThreadPool::enqueue(std::function<void()> task) {
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			tasks.push_back(std::move(task));
+		}
+		condition.notify_one();
+	}
+
+	void LthThreadPool::workerLoop() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				// The queued tasks are still run on destruction, their futures may be waited on.
+				if (tasks.empty()) return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	void LthThreadPool::parallelFor(size_t count, size_t minRangeSize, const std::function<void(size_t begin, size_t end)>& body) {
+		if (count == 0) return;
+
+		minRangeSize = std::max<size_t>(minRangeSize, 1);
+		// A few ranges per thread so that uneven ranges balance out.
+		size_t maxRangeCount = (static_cast<size_t>(getThreadCount()) + 1) * 4;
+		size_t rangeCount = std::min((count + minRangeSize - 1) / minRangeSize, maxRangeCount);
+		if (rangeCount <= 1) {
+			body(0, count);
+			return;
+		}
+
+		// Shared with the helpers: a late helper may only start after parallelFor has returned, it then finds no range left.
+		struct State {
+			std::atomic<size_t> nextRange{ 0 };
+			size_t rangeCount;
+			size_t count;
+			const std::function<void(size_t, size_t)>* body;
+			std::mutex mutex;
+			std::condition_variable condition;
+			size_t completedRanges = 0;
+			std::exception_ptr exception;
+
+			void run() {
+				size_t range;
+				while ((range = nextRange.fetch_add(1)) < rangeCount) {
+					size_t begin = count * range / rangeCount;
+					size_t end = count * (range + 1) / rangeCount;
+					std::exception_ptr rangeException;
+					try {
+						(*body)(begin, end);
+					}
+					catch (...) {
+						rangeException = std::current_exception();
+					}
+
+					std::lock_guard<std::mutex> lock{ mutex };
+					if (rangeException && !exception) {
+						exception = rangeException;
+					}
+					if (++completedRanges == rangeCount) {
+						condition.notify_all();
+					}
+				}
+			}
+		};
+
+		auto state = std::make_shared<State>();
+		state->rangeCount = rangeCount;
+		state->count = count;
+		state->body = &body;
+
+		size_t helperCount = std::min(rangeCount - 1, static_cast<size_t>(getThreadCount()));
+		for (size_t i = 0; i < helperCount; ++i) {
+			enqueue([state]() { state->run(); });
+		}
+		state->run();
+
+		std::unique_lock<std::mutex> lock{ state->mutex };
+		state->condition.wait(lock, [&state]() { return state->completedRanges == state->rangeCount; });
+		if (state->exception) {
+			std::rethrow_exception(state->exception);
+		}
+	}
+}
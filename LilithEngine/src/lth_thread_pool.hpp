@@ -0,0 +1,57 @@
+#ifndef __LTH_THREAD_POOL_HPP__
+#define __LTH_THREAD_POOL_HPP__
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace lth {
+
+	// Fixed set of worker threads for CPU side work (asset loading, decoding...). Tasks are started in submission order,
+	// they must not touch Vulkan objects that are externally synchronized unless they own them.
+	class LthThreadPool {
+	public:
+		LthThreadPool(uint32_t threadCount = defaultThreadCount());
+		~LthThreadPool();
+
+		LthThreadPool(const LthThreadPool&) = delete;
+		LthThreadPool& operator=(const LthThreadPool&) = delete;
+
+		// One thread per hardware thread, minus the main thread.
+		static uint32_t defaultThreadCount();
+
+		template<typename F>
+		std::future<std::invoke_result_t<F>> submit(F&& task) {
+			auto packagedTask = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(task));
+			std::future<std::invoke_result_t<F>> future = packagedTask->get_future();
+			enqueue([packagedTask]() { (*packagedTask)(); });
+			return future;
+		}
+
+		// Splits [0, count) in ranges of at least minRangeSize elements and runs body on them, on the workers and on the
+		// calling thread. Returns once every range is done, rethrowing the first exception thrown by body.
+		// It can be called from a task: the caller processes the ranges the busy workers do not pick up.
+		void parallelFor(size_t count, size_t minRangeSize, const std::function<void(size_t begin, size_t end)>& body);
+
+		uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+	private:
+		void enqueue(std::function<void()> task);
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool stopping = false;
+	};
+}
+
+#endif
@@ -0,0 +1,411 @@
+#include "lth_upload_context.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+namespace lth {
+
+	LthUploadContext::Batch::Batch(LthUploadContext& context) : context{ context }, ownsBatch{ !context.isRecording() } {
+		if (ownsBatch) {
+			context.begin();
+		}
+	}
+
+	LthUploadContext::Batch::~Batch() {
+		if (!ownsBatch) {
+			return;
+		}
+		// A destructor must not throw, the failed batch is only reported.
+		try {
+			context.submit();
+		}
+		catch (const std::exception& exception) {
+			std::cerr << "Failed to submit an upload batch: " << exception.what() << std::endl;
+		}
+	}
+
+	LthUploadContext::LthUploadContext(LthDevice& device) : lthDevice{ device } {
+		QueueFamilyIndices queueFamilyIndices = lthDevice.findPhysicalQueueFamilies();
+		dedicatedTransferQueue = queueFamilyIndices.hasDedicatedTransferFamily();
+		graphicsFamily = queueFamilyIndices.graphicsAndComputeFamily;
+		transferFamily = dedicatedTransferQueue ? queueFamilyIndices.transferFamily : graphicsFamily;
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		if (vkCreateCommandPool(lthDevice.getDevice(), &poolInfo, nullptr, &graphicsCommandPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create upload command pool!");
+		}
+
+		if (dedicatedTransferQueue) {
+			poolInfo.queueFamilyIndex = transferFamily;
+			if (vkCreateCommandPool(lthDevice.getDevice(), &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create upload transfer command pool!");
+			}
+		}
+	}
+
+	LthUploadContext::~LthUploadContext() {
+		if (isRecording()) {
+			submit();
+		}
+		for (auto& submission : submissions) {
+			vkWaitForFences(lthDevice.getDevice(), 1, &submission.fence, VK_TRUE, UINT64_MAX);
+		}
+		collect();
+		vkDestroyCommandPool(lthDevice.getDevice(), graphicsCommandPool, nullptr);
+		if (transferCommandPool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(lthDevice.getDevice(), transferCommandPool, nullptr);
+		}
+	}
+
+	VkCommandBuffer LthUploadContext::beginCommandBuffer(VkCommandPool commandPool) {
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = commandPool;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(lthDevice.getDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate upload command buffer!");
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to begin recording upload command buffer!");
+		}
+		return commandBuffer;
+	}
+
+	void LthUploadContext::begin() {
+		assert(!isRecording() && "Upload context is already recording!");
+		collect();
+
+		graphicsCommandBuffer = beginCommandBuffer(graphicsCommandPool);
+		transferCommandBuffer = dedicatedTransferQueue ? beginCommandBuffer(transferCommandPool) : graphicsCommandBuffer;
+	}
+
+	VkCommandBuffer LthUploadContext::getTransferCommandBuffer() {
+		assert(isRecording() && "Upload context used outside of a batch!");
+		return transferCommandBuffer;
+	}
+
+	VkCommandBuffer LthUploadContext::getGraphicsCommandBuffer() {
+		assert(isRecording() && "Upload context used outside of a batch!");
+		return graphicsCommandBuffer;
+	}
+
+	void LthUploadContext::releaseBuffer(VkBuffer buffer) {
+		if (dedicatedTransferQueue && std::find(releasedBuffers.begin(), releasedBuffers.end(), buffer) == releasedBuffers.end()) {
+			releasedBuffers.push_back(buffer);
+		}
+	}
+
+	void LthUploadContext::releaseImage(VkImage image) {
+		if (dedicatedTransferQueue && std::find(releasedImages.begin(), releasedImages.end(), image) == releasedImages.end()) {
+			releasedImages.push_back(image);
+		}
+	}
+
+	VkCommandBuffer LthUploadContext::recordOwnershipTransfers() {
+		// Release barriers end the transfer command buffer, the matching acquire barriers are recorded in a command buffer
+		// executed right before the graphics side of the batch. Images stay in TRANSFER_DST layout during the transfer.
+		std::vector<VkBufferMemoryBarrier> bufferBarriers(releasedBuffers.size());
+		for (size_t i = 0; i < releasedBuffers.size(); i++) {
+			VkBufferMemoryBarrier& barrier = bufferBarriers[i];
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = transferFamily;
+			barrier.dstQueueFamilyIndex = graphicsFamily;
+			barrier.buffer = releasedBuffers[i];
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+		}
+
+		std::vector<VkImageMemoryBarrier> imageBarriers(releasedImages.size());
+		for (size_t i = 0; i < releasedImages.size(); i++) {
+			VkImageMemoryBarrier& barrier = imageBarriers[i];
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = transferFamily;
+			barrier.dstQueueFamilyIndex = graphicsFamily;
+			barrier.image = releasedImages[i];
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		}
+
+		for (auto& barrier : bufferBarriers) {
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_NONE;
+		}
+		for (auto& barrier : imageBarriers) {
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_NONE;
+		}
+		vkCmdPipelineBarrier(transferCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+		VkCommandBuffer acquireCommandBuffer = beginCommandBuffer(graphicsCommandPool);
+		for (auto& barrier : bufferBarriers) {
+			barrier.srcAccessMask = VK_ACCESS_NONE;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		}
+		for (auto& barrier : imageBarriers) {
+			barrier.srcAccessMask = VK_ACCESS_NONE;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		}
+		vkCmdPipelineBarrier(acquireCommandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+		if (vkEndCommandBuffer(acquireCommandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to record upload acquire command buffer!");
+		}
+
+		releasedBuffers.clear();
+		releasedImages.clear();
+		return acquireCommandBuffer;
+	}
+
+	LthUploadToken LthUploadContext::submit() {
+		if (!isRecording()) {
+			return nextToken - 1;
+		}
+
+		VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+		VkSemaphore transferSemaphore = VK_NULL_HANDLE;
+		if (dedicatedTransferQueue) {
+			acquireCommandBuffer = recordOwnershipTransfers();
+			if (vkEndCommandBuffer(transferCommandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to record upload transfer command buffer!");
+			}
+
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			if (vkCreateSemaphore(lthDevice.getDevice(), &semaphoreInfo, nullptr, &transferSemaphore) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create upload semaphore!");
+			}
+
+			VkSubmitInfo transferSubmitInfo{};
+			transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			transferSubmitInfo.commandBufferCount = 1;
+			transferSubmitInfo.pCommandBuffers = &transferCommandBuffer;
+			transferSubmitInfo.signalSemaphoreCount = 1;
+			transferSubmitInfo.pSignalSemaphores = &transferSemaphore;
+
+			if (vkQueueSubmit(lthDevice.getTransferQueue(), 1, &transferSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to submit upload transfer command buffer!");
+			}
+		}
+
+		// Make every upload of the batch visible to whatever is submitted after it on the graphics queue.
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(graphicsCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			1, &memoryBarrier,
+			0, nullptr,
+			0, nullptr);
+
+		if (vkEndCommandBuffer(graphicsCommandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to record upload command buffer!");
+		}
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkFence fence;
+		if (vkCreateFence(lthDevice.getDevice(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create upload fence!");
+		}
+
+		std::vector<VkCommandBuffer> graphicsCommandBuffers{};
+		if (acquireCommandBuffer != VK_NULL_HANDLE) {
+			graphicsCommandBuffers.push_back(acquireCommandBuffer);
+		}
+		graphicsCommandBuffers.push_back(graphicsCommandBuffer);
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		if (transferSemaphore != VK_NULL_HANDLE) {
+			submitInfo.waitSemaphoreCount = 1;
+			submitInfo.pWaitSemaphores = &transferSemaphore;
+			submitInfo.pWaitDstStageMask = &waitStage;
+		}
+		submitInfo.commandBufferCount = static_cast<uint32_t>(graphicsCommandBuffers.size());
+		submitInfo.pCommandBuffers = graphicsCommandBuffers.data();
+
+		if (vkQueueSubmit(lthDevice.getGraphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to submit upload command buffer!");
+		}
+
+		LthUploadToken token = nextToken++;
+		submissions.push_back({
+			token,
+			fence,
+			transferSemaphore,
+			dedicatedTransferQueue ? transferCommandBuffer : VK_NULL_HANDLE,
+			acquireCommandBuffer,
+			graphicsCommandBuffer,
+			std::move(pendingResources) });
+		pendingResources.clear();
+		graphicsCommandBuffer = VK_NULL_HANDLE;
+		transferCommandBuffer = VK_NULL_HANDLE;
+		return token;
+	}
+
+	bool LthUploadContext::isComplete(LthUploadToken token) {
+		if (token > lastCompletedToken) {
+			collect();
+		}
+		return token <= lastCompletedToken;
+	}
+
+	void LthUploadContext::wait(LthUploadToken token) {
+		assert(token < nextToken && "Waiting on an upload batch that has not been submitted!");
+		for (auto& submission : submissions) {
+			if (submission.token >= token) {
+				vkWaitForFences(lthDevice.getDevice(), 1, &submission.fence, VK_TRUE, UINT64_MAX);
+				break;
+			}
+		}
+		collect();
+	}
+
+	void LthUploadContext::collect() {
+		// Submissions run in order on the same queue, so they also complete in order.
+		while (!submissions.empty()) {
+			Submission& submission = submissions.front();
+			if (vkGetFenceStatus(lthDevice.getDevice(), submission.fence) != VK_SUCCESS) break;
+
+			vkDestroyFence(lthDevice.getDevice(), submission.fence, nullptr);
+			vkFreeCommandBuffers(lthDevice.getDevice(), graphicsCommandPool, 1, &submission.graphicsCommandBuffer);
+			if (submission.acquireCommandBuffer != VK_NULL_HANDLE) {
+				vkFreeCommandBuffers(lthDevice.getDevice(), graphicsCommandPool, 1, &submission.acquireCommandBuffer);
+			}
+			if (submission.transferCommandBuffer != VK_NULL_HANDLE) {
+				vkFreeCommandBuffers(lthDevice.getDevice(), transferCommandPool, 1, &submission.transferCommandBuffer);
+				vkDestroySemaphore(lthDevice.getDevice(), submission.transferSemaphore, nullptr);
+			}
+			lastCompletedToken = submission.token;
+			submissions.pop_front();
+		}
+	}
+
+	std::unique_ptr<LthBuffer> LthUploadContext::createStagingBuffer(const void* data, VkDeviceSize size) {
+		auto stagingBuffer = std::make_unique<LthBuffer>(
+			lthDevice,
+			size,
+			1,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		stagingBuffer->map();
+		stagingBuffer->writeToBuffer(const_cast<void*>(data), size);
+		stagingBuffer->unmap();
+		return stagingBuffer;
+	}
+
+	void LthUploadContext::uploadToBuffer(const void* data, VkDeviceSize size, LthBuffer& dstBuffer, VkDeviceSize dstOffset) {
+		auto stagingBuffer = createStagingBuffer(data, size);
+		recordBufferCopy(stagingBuffer->getBuffer(), dstBuffer.getBuffer(), size, 0, dstOffset, !dstBuffer.isSharedWithTransferQueue());
+		keepAlive(std::move(stagingBuffer));
+	}
+
+	void LthUploadContext::uploadToImage(const void* data, VkDeviceSize size, VkImage dstImage, uint32_t width, uint32_t height) {
+		VkBufferImageCopy region{};
+		region.bufferOffset = 0;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { width, height, 1 };
+
+		uploadToImage(data, size, dstImage, { region });
+	}
+
+	void LthUploadContext::uploadToImage(const void* data, VkDeviceSize size, VkImage dstImage, const std::vector<VkBufferImageCopy>& regions) {
+		auto stagingBuffer = createStagingBuffer(data, size);
+
+		vkCmdCopyBufferToImage(getTransferCommandBuffer(), stagingBuffer->getBuffer(), dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(regions.size()), regions.data());
+		releaseImage(dstImage);
+		keepAlive(std::move(stagingBuffer));
+	}
+
+	void LthUploadContext::copyBuffer(VkBuffer srcBuffer, LthBuffer& dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
+		recordBufferCopy(srcBuffer, dstBuffer.getBuffer(), size, srcOffset, dstOffset, !dstBuffer.isSharedWithTransferQueue());
+	}
+
+	void LthUploadContext::recordBufferCopy(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset, bool releaseDestination) {
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = srcOffset;
+		copyRegion.dstOffset = dstOffset;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(getTransferCommandBuffer(), srcBuffer, dstBuffer, 1, &copyRegion);
+		if (releaseDestination) {
+			releaseBuffer(dstBuffer);
+		}
+	}
+
+	void LthUploadContext::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
+		if (newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+			lthDevice.recordTransitionImageLayout(getTransferCommandBuffer(), image, format, oldLayout, newLayout, mipLevels);
+			releaseImage(image);
+		}
+		else {
+			lthDevice.recordTransitionImageLayout(getGraphicsCommandBuffer(), image, format, oldLayout, newLayout, mipLevels);
+		}
+	}
+
+	void LthUploadContext::generateMipmaps(VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mipLevels, VkImageLayout newImageLayout) {
+		lthDevice.recordGenerateMipmaps(getGraphicsCommandBuffer(), image, format, width, height, mipLevels, newImageLayout);
+	}
+
+	void LthUploadContext::buildAccelerationStructure(
+		const VkAccelerationStructureBuildGeometryInfoKHR& asBuildGeometryInfo,
+		const VkAccelerationStructureBuildRangeInfoKHR& asBuildRangeInfo) {
+		// Geometry copies and BLAS builds recorded earlier in the batch must be finished before building on top of them.
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+		vkCmdPipelineBarrier(getGraphicsCommandBuffer(),
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+			VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0,
+			1, &memoryBarrier,
+			0, nullptr,
+			0, nullptr);
+
+		const VkAccelerationStructureBuildRangeInfoKHR* asBuildRangeInfos = &asBuildRangeInfo;
+		vkCmdBuildAccelerationStructuresKHR(getGraphicsCommandBuffer(), 1, &asBuildGeometryInfo, &asBuildRangeInfos);
+	}
+
+	void LthUploadContext::keepAlive(std::unique_ptr<LthBuffer> buffer) {
+		assert(isRecording() && "Upload context used outside of a batch!");
+		pendingResources.push_back(std::move(buffer));
+	}
+}
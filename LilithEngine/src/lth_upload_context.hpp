@@ -0,0 +1,107 @@
+#ifndef __LTH_UPLOAD_CONTEXT_HPP__
+#define __LTH_UPLOAD_CONTEXT_HPP__
+
+#include "lth_device.hpp"
+#include "lth_buffer.hpp"
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace lth {
+
+	using LthUploadToken = uint64_t;
+
+	// Records many uploads (copies, layout transitions, mip generation, acceleration structure builds) into a single batch,
+	// submitted with a fence. The returned token can be polled or waited on, staging resources are released once it completes.
+	// When the device has a dedicated transfer queue, copies run on it and their destinations are handed over to the graphics
+	// queue family (release / acquire barriers) before the graphics side of the batch (mipmaps, AS builds) executes.
+	class LthUploadContext {
+	public:
+		// Opens a batch on the context if none is recording, and submits it without waiting when going out of scope.
+		// Nested batches simply record into the outer one. A caller reading the results back right away waits on submit(),
+		// which returns the token of the last submission once the batch has ended. A submission failing in the destructor
+		// is reported to std::cerr instead of thrown.
+		struct Batch {
+			Batch(LthUploadContext& context);
+			~Batch();
+
+			Batch(const Batch&) = delete;
+			Batch& operator=(const Batch&) = delete;
+
+			LthUploadContext& context;
+			bool ownsBatch;
+		};
+
+		LthUploadContext(LthDevice& device);
+		~LthUploadContext();
+
+		LthUploadContext(const LthUploadContext&) = delete;
+		LthUploadContext& operator=(const LthUploadContext&) = delete;
+
+		void begin();
+		bool isRecording() const { return graphicsCommandBuffer != VK_NULL_HANDLE; }
+		bool usesDedicatedTransferQueue() const { return dedicatedTransferQueue; }
+		VkCommandBuffer getTransferCommandBuffer(); // Same as the graphics command buffer without a dedicated transfer queue.
+		VkCommandBuffer getGraphicsCommandBuffer();
+		LthUploadToken submit();
+
+		bool isComplete(LthUploadToken token);
+		void wait(LthUploadToken token);
+		void collect(); // Releases the resources of every completed submission, called once per frame.
+
+		// Transfer side: the destinations are released to the graphics queue family at submission, except the buffers
+		// shared with the transfer queue (concurrent sharing mode).
+		void uploadToBuffer(const void* data, VkDeviceSize size, LthBuffer& dstBuffer, VkDeviceSize dstOffset = 0);
+		void uploadToImage(const void* data, VkDeviceSize size, VkImage dstImage, uint32_t width, uint32_t height); // Image must be in TRANSFER_DST layout.
+		void uploadToImage(const void* data, VkDeviceSize size, VkImage dstImage, const std::vector<VkBufferImageCopy>& regions); // Offsets in data.
+		void copyBuffer(VkBuffer srcBuffer, LthBuffer& dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+
+		// Transitions to TRANSFER_DST are recorded on the transfer side, every other one on the graphics side.
+		void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1);
+
+		// Graphics side.
+		void generateMipmaps(VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mipLevels, VkImageLayout newImageLayout);
+		void buildAccelerationStructure(const VkAccelerationStructureBuildGeometryInfoKHR& asBuildGeometryInfo, const VkAccelerationStructureBuildRangeInfoKHR& asBuildRangeInfo);
+
+		// Keeps a resource alive until the current batch has been executed (staging, scratch and instance buffers).
+		void keepAlive(std::unique_ptr<LthBuffer> buffer);
+
+	private:
+		struct Submission {
+			LthUploadToken token;
+			VkFence fence;
+			VkSemaphore transferSemaphore;
+			VkCommandBuffer transferCommandBuffer;
+			VkCommandBuffer acquireCommandBuffer;
+			VkCommandBuffer graphicsCommandBuffer;
+			std::vector<std::unique_ptr<LthBuffer>> resources;
+		};
+
+		VkCommandBuffer beginCommandBuffer(VkCommandPool commandPool);
+		VkCommandBuffer recordOwnershipTransfers();
+		void recordBufferCopy(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset, bool releaseDestination);
+		void releaseBuffer(VkBuffer buffer);
+		void releaseImage(VkImage image);
+		std::unique_ptr<LthBuffer> createStagingBuffer(const void* data, VkDeviceSize size);
+
+		LthDevice& lthDevice;
+		bool dedicatedTransferQueue;
+		uint32_t graphicsFamily;
+		uint32_t transferFamily;
+		VkCommandPool graphicsCommandPool;
+		VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+
+		VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+		std::vector<VkBuffer> releasedBuffers{};
+		std::vector<VkImage> releasedImages{};
+		std::vector<std::unique_ptr<LthBuffer>> pendingResources{};
+
+		std::deque<Submission> submissions{};
+		LthUploadToken nextToken = 1;
+		LthUploadToken lastCompletedToken = 0;
+	};
+}
+
+#endif
@@ -4,6 +4,8 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 
 namespace lth {
@@ -20,6 +22,17 @@ namespace lth {
 		(hashCombine(seed, rest), ...);
 	};
 
+	// 64 bits FNV-1a, stable across runs and platforms (file content keys). Chain calls by passing the previous hash.
+	constexpr uint64_t FNV1A_OFFSET_BASIS = 0xcbf29ce484222325ull;
+	inline uint64_t fnv1a(const void* data, size_t size, uint64_t hash = FNV1A_OFFSET_BASIS) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef __LTH_VERTEX_LAYOUT_HPP__
+#define __LTH_VERTEX_LAYOUT_HPP__
+
+#include "lth_compile_options.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lth {
+
+	// Compile-time vertex input description. Specialize it for each vertex type with a constexpr attributes array:
+	//	template<> struct LthVertexLayout<MyVertex> {
+	//		static constexpr std::array<VkVertexInputAttributeDescription, 1> attributes{ {
+	//			{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(MyVertex, position) } } };
+	//	};
+	template<typename V>
+	struct LthVertexLayout;
+
+	template<typename V>
+	constexpr VkVertexInputBindingDescription vertexBindingDescription(uint32_t binding = 0, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX) {
+		return { binding, static_cast<uint32_t>(sizeof(V)), inputRate };
+	}
+
+	template<typename V>
+	constexpr const auto& vertexAttributeDescriptions() {
+		return LthVertexLayout<V>::attributes;
+	}
+
+	template<typename V>
+	std::vector<VkVertexInputBindingDescription> vertexBindingDescriptionVector() {
+		return { vertexBindingDescription<V>() };
+	}
+
+	template<typename V>
+	std::vector<VkVertexInputAttributeDescription> vertexAttributeDescriptionVector() {
+		const auto& attributes = vertexAttributeDescriptions<V>();
+		return { attributes.begin(), attributes.end() };
+	}
+
+	// Quantization helpers of the packed vertex formats. The shaders decode them with unpackSnorm2x16, unpackHalf2x16
+	// and unpackUnorm4x8.
+	namespace vertex_packing {
+
+		// Octahedral mapping of a unit vector, stored as two snorm16.
+		inline uint32_t packOctahedralNormal(glm::vec3 normal) {
+			float length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+			if (length <= 0.f) return glm::packSnorm2x16(glm::vec2(0.f, 0.f));
+			normal /= length;
+			glm::vec2 octahedral{ normal.x, normal.y };
+			if (normal.z < 0.f) {
+				octahedral = (1.f - glm::abs(glm::vec2(normal.y, normal.x)))
+					* glm::vec2(normal.x >= 0.f ? 1.f : -1.f, normal.y >= 0.f ? 1.f : -1.f);
+			}
+			return glm::packSnorm2x16(octahedral);
+		}
+
+		inline glm::vec3 unpackOctahedralNormal(uint32_t packedNormal) {
+			glm::vec2 octahedral = glm::unpackSnorm2x16(packedNormal);
+			glm::vec3 normal{ octahedral.x, octahedral.y, 1.f - glm::abs(octahedral.x) - glm::abs(octahedral.y) };
+			float t = glm::max(-normal.z, 0.f);
+			normal.x += normal.x >= 0.f ? -t : t;
+			normal.y += normal.y >= 0.f ? -t : t;
+			return glm::normalize(normal);
+		}
+
+		inline uint32_t packHalfUv(glm::vec2 uv) { return glm::packHalf2x16(uv); }
+		inline uint32_t packUnormColor(glm::vec3 color) { return glm::packUnorm4x8(glm::vec4(glm::clamp(color, 0.f, 1.f), 1.f)); }
+	}
+}
+
+#endif
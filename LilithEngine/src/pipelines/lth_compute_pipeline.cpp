@@ -20,9 +20,15 @@ namespace lth {
 		clearPipeline();
 	}
 
-	void LthComputePipeline::reloadPipeline() {
-		clearPipeline();
-		createComputePipeline(lthPipelineLayout, computeFilePath);
+	std::unique_ptr<LthPipeline> LthComputePipeline::createReloadedPipeline() {
+		return std::make_unique<LthComputePipeline>(lthDevice, lthPipelineLayout, lthShaderCompiler, computeFilePath);
+	}
+
+	void LthComputePipeline::swapPipeline(LthPipeline& other) {
+		LthPipeline::swapPipeline(other);
+		LthComputePipeline& otherPipeline = static_cast<LthComputePipeline&>(other);
+		std::swap(computePipeline, otherPipeline.computePipeline);
+		std::swap(computeShaderModule, otherPipeline.computeShaderModule);
 	}
 
 	void LthComputePipeline::clearPipeline() {
@@ -55,19 +61,22 @@ namespace lth {
 
 		VkComputePipelineCreateInfo pipelineInfo{};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-		pipelineInfo.pNext = nullptr;
+		VkPipelineCreationFeedback creationFeedback;
+		VkPipelineCreationFeedbackCreateInfo feedbackInfo = creationFeedbackInfo(creationFeedback);
+		pipelineInfo.pNext = &feedbackInfo;
 		pipelineInfo.stage = computeShaderStageInfo;
 		pipelineInfo.layout = pipelineLayout;
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
 		if (vkCreateComputePipelines(
 			lthDevice.getDevice(),
-			VK_NULL_HANDLE,
+			lthDevice.getPipelineCache(),
 			1,
 			&pipelineInfo,
 			nullptr,
 			&computePipeline) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create compute pipeline!");
 		}
+		logCreationFeedback(computeFilePath, creationFeedback);
 	}
 }
\ No newline at end of file
@@ -29,7 +29,8 @@ namespace lth {
 		LthComputePipeline(const LthComputePipeline&) = delete;
 		LthComputePipeline& operator=(const LthComputePipeline&) = delete;
 		void clearPipeline() override;
-		void reloadPipeline() override;
+		std::unique_ptr<LthPipeline> createReloadedPipeline() override;
+		void swapPipeline(LthPipeline& other) override;
 
 		static void defaultComputePipelineConfigInfo(LthComputePipelineConfigInfo& configInfo);
 
@@ -1,5 +1,4 @@
 #include "lth_graphics_pipeline.hpp"
-#include "../lth_model.hpp"
 
 #include <fstream>
 #include <stdexcept>
@@ -21,11 +20,18 @@ namespace lth {
 		clearPipeline();
 	}
 
-	void LthGraphicsPipeline::reloadPipeline() {
-		clearPipeline();
-		createGraphicsPipeline(configInfo, graphicsFilePath);
+	std::unique_ptr<LthPipeline> LthGraphicsPipeline::createReloadedPipeline() {
+		return std::make_unique<LthGraphicsPipeline>(lthDevice, configInfo, lthShaderCompiler, graphicsFilePath);
+	}
+
+	void LthGraphicsPipeline::swapPipeline(LthPipeline& other) {
+		LthPipeline::swapPipeline(other);
+		LthGraphicsPipeline& otherPipeline = static_cast<LthGraphicsPipeline&>(other);
+		std::swap(graphicsPipeline, otherPipeline.graphicsPipeline);
+		std::swap(vertShaderModule, otherPipeline.vertShaderModule);
+		std::swap(fragShaderModule, otherPipeline.fragShaderModule);
 	}
-	
+
 	void LthGraphicsPipeline::clearPipeline() {
 		vkDestroyShaderModule(lthDevice.getDevice(), vertShaderModule, nullptr);
 		vkDestroyShaderModule(lthDevice.getDevice(), fragShaderModule, nullptr);
@@ -37,8 +43,9 @@ namespace lth {
 	}
 
 	void LthGraphicsPipeline::defaultGraphicsPipelineConfigInfo(LthGraphicsPipelineConfigInfo& configInfo) {
-		configInfo.bindingDescriptions = LthModel::Vertex::getBindingDescriptions();
-		configInfo.attributeDescriptions = LthModel::Vertex::getAttributeDescriptions();
+		// No vertex input by default: models are pulled from the geometry pool. See setVertexLayout.
+		configInfo.bindingDescriptions.clear();
+		configInfo.attributeDescriptions.clear();
 
 		configInfo.inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 		configInfo.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -161,8 +168,18 @@ namespace lth {
 		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 		vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
+		VkPipelineColorBlendStateCreateInfo colorBlendInfo = configInfo.colorBlendInfo;
+		colorBlendInfo.pAttachments = &configInfo.colorBlendAttachment;
+		VkPipelineDynamicStateCreateInfo dynamicStateInfo = configInfo.dynamicStateInfo;
+		dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
+		dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
+
+		VkPipelineCreationFeedback creationFeedback;
+		VkPipelineCreationFeedbackCreateInfo feedbackInfo = creationFeedbackInfo(creationFeedback);
+
 		VkGraphicsPipelineCreateInfo pipelineInfo{};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.pNext = &feedbackInfo;
 		pipelineInfo.stageCount = 2;
 		pipelineInfo.pStages = shaderStageInfos;
 		pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -170,9 +187,9 @@ namespace lth {
 		pipelineInfo.pViewportState = &configInfo.viewportInfo;
 		pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
 		pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
-		pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
+		pipelineInfo.pColorBlendState = &colorBlendInfo;
 		pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
-		pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
+		pipelineInfo.pDynamicState = &dynamicStateInfo;
 		pipelineInfo.layout = configInfo.pipelineLayout;
 		pipelineInfo.renderPass = configInfo.renderPass;
 		pipelineInfo.subpass = configInfo.subpass;
@@ -181,12 +198,13 @@ namespace lth {
 
 		if (vkCreateGraphicsPipelines(
 			lthDevice.getDevice(),
-			VK_NULL_HANDLE,
+			lthDevice.getPipelineCache(),
 			1,
 			&pipelineInfo,
 			nullptr,
 			&graphicsPipeline) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create graphics pipeline!");
 		}
+		logCreationFeedback(graphicsFilePath.vertexFilePath, creationFeedback);
 	}
 }
\ No newline at end of file
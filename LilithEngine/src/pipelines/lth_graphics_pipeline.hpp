@@ -2,15 +2,18 @@
 #define __LTH_GRAPHICS_PIPELINE_HPP__
 
 #include "lth_pipeline.hpp"
+#include "../lth_vertex_layout.hpp"
 
 #include <string>
 #include <vector>
 
 namespace lth {
 
+	// The pipeline keeps a copy, for its reloads. colorBlendInfo and dynamicStateInfo point to the states of the copy when
+	// the pipeline is created.
 	struct LthGraphicsPipelineConfigInfo {
 		LthGraphicsPipelineConfigInfo() = default;
-		LthGraphicsPipelineConfigInfo(const LthGraphicsPipelineConfigInfo&) = delete;
+		LthGraphicsPipelineConfigInfo(const LthGraphicsPipelineConfigInfo&) = default;
 		LthGraphicsPipelineConfigInfo& operator=(const LthGraphicsPipelineConfigInfo&) = delete;
 
 		std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
@@ -47,10 +50,16 @@ namespace lth {
 		LthGraphicsPipeline(const LthGraphicsPipeline&) = delete;
 		LthGraphicsPipeline& operator=(const LthGraphicsPipeline&) = delete;
 		void clearPipeline() override;
-		void reloadPipeline() override;
+		std::unique_ptr<LthPipeline> createReloadedPipeline() override;
+		void swapPipeline(LthPipeline& other) override;
 
 		static void defaultGraphicsPipelineConfigInfo(LthGraphicsPipelineConfigInfo& configInfo);
 		static void enableAlphaBlending(LthGraphicsPipelineConfigInfo& configInfo);
+		template<typename V>
+		static void setVertexLayout(LthGraphicsPipelineConfigInfo& configInfo) {
+			configInfo.bindingDescriptions = vertexBindingDescriptionVector<V>();
+			configInfo.attributeDescriptions = vertexAttributeDescriptionVector<V>();
+		}
 
 		void bind(VkCommandBuffer commandBuffer) override;
 	private:
@@ -63,7 +72,7 @@ namespace lth {
 
 		//LthDevice& lthDevice;
 		VkPipeline graphicsPipeline;
-		const LthGraphicsPipelineConfigInfo& configInfo;
+		const LthGraphicsPipelineConfigInfo configInfo;
 		const LthGraphicsPipelineFilePaths& graphicsFilePath;
 
 		VkShaderModule vertShaderModule;
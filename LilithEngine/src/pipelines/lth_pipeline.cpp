@@ -1,4 +1,5 @@
 #include "lth_pipeline.hpp"
+#include "../lth_utils.hpp"
 
 #include <fstream>
 #include <stdexcept>
@@ -20,6 +21,7 @@ namespace lth {
 		file.read(buffer.data(), fileSize);
 
 		file.close();
+		shaderFileHashes[filePath] = fnv1a(buffer.data(), buffer.size());
 		return buffer;
 	}
 
@@ -46,17 +48,43 @@ namespace lth {
 		}
 	}
 
-	bool LthPipeline::checkForUpdatesAndReload() {
+	VkPipelineCreationFeedbackCreateInfo LthPipeline::creationFeedbackInfo(VkPipelineCreationFeedback& feedback) {
+		feedback = {};
+		VkPipelineCreationFeedbackCreateInfo feedbackInfo{};
+		feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+		feedbackInfo.pPipelineCreationFeedback = &feedback;
+		return feedbackInfo;
+	}
+
+	void LthPipeline::logCreationFeedback(const std::string& pipelineName, const VkPipelineCreationFeedback& feedback) {
+		if ((feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) == 0) {
+			return;
+		}
+		bool cacheHit = (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) != 0;
+		std::cout << "Pipeline " << pipelineName << " created in " << feedback.duration / 1000000.0 << " ms ("
+			<< (cacheHit ? "pipeline cache hit" : "pipeline cache miss") << ")" << std::endl;
+	}
+
+	bool LthPipeline::checkForUpdates() {
 		bool updates = false;
 		for (auto& session : slangSessions) {
-			if (lthShaderCompiler.checkForUpdates(session, true)) {
+			if (lthShaderCompiler.checkForUpdates(session, false)) {
 				updates = true;
 			}
 		}
-
-		if (updates) {
-			reloadPipeline();
+		for (auto& file : shaderFileHashes) {
+			uint64_t hash;
+			if (!LthShaderCompiler::hashFile(file.first, hash) || hash != file.second) {
+				std::cout << "The shader file " << file.first << " needs an update." << std::endl;
+				updates = true;
+			}
 		}
 		return updates;
 	}
+
+	void LthPipeline::swapPipeline(LthPipeline& other) {
+		assert(&lthDevice == &other.lthDevice && lthPipelineLayout == other.lthPipelineLayout && "Cannot swap unrelated pipelines");
+		std::swap(slangSessions, other.slangSessions);
+		std::swap(shaderFileHashes, other.shaderFileHashes);
+	}
 }
\ No newline at end of file
@@ -3,7 +3,9 @@
 
 #include "../lth_device.hpp"
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "../lth_shader_compiler.hpp"
 
@@ -22,19 +24,31 @@ namespace lth {
 		LthPipeline(const LthPipeline&) = delete;
 		LthPipeline& operator=(const LthPipeline&) = delete;
 		virtual void clearPipeline() = 0;
-		virtual void reloadPipeline() = 0;
-
-		bool checkForUpdatesAndReload();
 		virtual void bind(VkCommandBuffer commandBuffer) = 0;
+
+		// Reload without blocking the frames, see LthPipelineReloader. A pipeline being used by the frames is only read by
+		// these two methods, so that they can run on a worker.
+		// Whether a shader source changed since the creation of the pipeline.
+		bool checkForUpdates();
+		// New pipeline of the same type, created out of the current shader sources.
+		virtual std::unique_ptr<LthPipeline> createReloadedPipeline() = 0;
+		// Exchanges the Vulkan objects and shader sources of two pipelines of the same type, created with the same parameters.
+		virtual void swapPipeline(LthPipeline& other);
 	protected:
-		static std::vector<char> readFile(const std::string& filePath);
+		// Remembers the content hash of the file, for checkForUpdates.
+		std::vector<char> readFile(const std::string& filePath);
 		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 		void createShaderModule(const Slang::ComPtr<slang::IBlob>& code, VkShaderModule* shaderModule);
+		// Feedback to chain to a pipeline create info, written by the creation.
+		static VkPipelineCreationFeedbackCreateInfo creationFeedbackInfo(VkPipelineCreationFeedback& feedback);
+		// Logs the creation time of the pipeline and whether the pipeline cache of the device held it.
+		static void logCreationFeedback(const std::string& pipelineName, const VkPipelineCreationFeedback& feedback);
 		
 		LthDevice& lthDevice;
 		const VkPipelineLayout lthPipelineLayout;
 		LthShaderCompiler& lthShaderCompiler;
 		std::vector<LthSlangSession> slangSessions = {};
+		std::unordered_map<std::string, uint64_t> shaderFileHashes = {}; // SPIR-V files read by readFile.
 	};
 }
 
@@ -0,0 +1,66 @@
+#include "lth_pipeline_reloader.hpp"
+#include "../lth_global_info.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+
+namespace lth {
+
+	LthPipelineReloader::~LthPipelineReloader() {
+		// The reload uses the pipelines and the shader compiler, it must end before them.
+		if (reload.valid()) {
+			reload.wait();
+		}
+	}
+
+	bool LthPipelineReloader::requestReload(std::vector<LthPipeline*> pipelines) {
+		if (reload.valid()) {
+			return false;
+		}
+
+		reload = threadPool.submit([this, pipelines = std::move(pipelines)]() {
+			LthShaderCompiler::GlobalSessionScope globalSessionScope{ shaderCompiler };
+			auto start = std::chrono::high_resolution_clock::now();
+			std::vector<ReloadedPipeline> reloadedPipelines;
+			for (LthPipeline* pipeline : pipelines) {
+				if (pipeline->checkForUpdates()) {
+					reloadedPipelines.push_back({ pipeline, pipeline->createReloadedPipeline() });
+				}
+			}
+			if (!reloadedPipelines.empty()) {
+				std::cout << "Reloaded " << reloadedPipelines.size() << " pipelines in the background in "
+					<< std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+			}
+			return reloadedPipelines;
+		});
+		return true;
+	}
+
+	void LthPipelineReloader::update() {
+		++frame;
+
+		if (reload.valid() && reload.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			try {
+				for (auto& reloadedPipeline : reload.get()) {
+					reloadedPipeline.pipeline->swapPipeline(*reloadedPipeline.reloadedPipeline);
+					retiredPipelines.push_back({ std::move(reloadedPipeline.reloadedPipeline), frame });
+				}
+			}
+			catch (const std::exception& exception) {
+				std::cerr << "Failed to reload the pipelines, the previous ones are kept: " << exception.what() << std::endl;
+			}
+			shaderCompiler.releaseGlobalSessions();
+		}
+
+		// The frames recorded before the swap are waited for by beginFrame once MAX_FRAMES_IN_FLIGHT frames have begun.
+		// The retired pipelines hold Slang sessions, which are not released while a reload may be using Slang.
+		if (reload.valid()) {
+			return;
+		}
+		std::erase_if(retiredPipelines, [this](const RetiredPipeline& retiredPipeline) {
+			return frame >= retiredPipeline.frame + MAX_FRAMES_IN_FLIGHT;
+		});
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef __LTH_PIPELINE_RELOADER_HPP__
+#define __LTH_PIPELINE_RELOADER_HPP__
+
+#include "lth_pipeline.hpp"
+#include "../lth_thread_pool.hpp"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace lth {
+
+	// Shader hot reload that does not stall the frames. The pipelines are checked for updates, and the updated ones are
+	// compiled and created again, on a worker while the frames keep using the current ones. The new pipelines are then
+	// swapped in between two frames, and the previous Vulkan objects destroyed once no frame in flight uses them.
+	// A reload that fails (a shader that does not compile...) is reported and leaves the pipelines untouched.
+	class LthPipelineReloader {
+	public:
+		LthPipelineReloader(LthThreadPool& threadPool, LthShaderCompiler& shaderCompiler) : threadPool{ threadPool }, shaderCompiler{ shaderCompiler } {};
+		~LthPipelineReloader();
+
+		LthPipelineReloader(const LthPipelineReloader&) = delete;
+		LthPipelineReloader& operator=(const LthPipelineReloader&) = delete;
+
+		// Starts a reload of the pipelines, which must live until it is swapped in. Returns false if a reload is running.
+		bool requestReload(std::vector<LthPipeline*> pipelines);
+		bool isReloading() const { return reload.valid(); }
+		// To call once per frame, before beginFrame: swaps in the pipelines of a finished reload and destroys the retired
+		// ones.
+		void update();
+
+	private:
+		struct ReloadedPipeline {
+			LthPipeline* pipeline;
+			std::unique_ptr<LthPipeline> reloadedPipeline;
+		};
+		struct RetiredPipeline {
+			std::unique_ptr<LthPipeline> pipeline;
+			uint64_t frame; // Of the swap.
+		};
+
+		LthThreadPool& threadPool;
+		LthShaderCompiler& shaderCompiler;
+		std::future<std::vector<ReloadedPipeline>> reload{};
+		std::vector<RetiredPipeline> retiredPipelines{};
+		uint64_t frame = 0;
+	};
+}
+
+#endif
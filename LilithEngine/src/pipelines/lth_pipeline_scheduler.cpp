@@ -0,0 +1,26 @@
+#include "lth_pipeline_scheduler.hpp"
+
+#include <chrono>
+#include <iostream>
+
+namespace lth {
+
+	void LthPipelineScheduler::run() {
+		auto start = std::chrono::high_resolution_clock::now();
+		std::vector<std::function<void()>> creations = std::move(pipelineCreations);
+		pipelineCreations.clear();
+
+		threadPool.parallelFor(creations.size(), 1, [this, &creations](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				LthShaderCompiler::GlobalSessionScope globalSessionScope{ shaderCompiler };
+				creations[i]();
+			}
+		});
+		shaderCompiler.releaseGlobalSessions();
+
+		if (verbose) {
+			std::cout << "Created " << creations.size() << " pipelines on " << threadPool.getThreadCount() + 1 << " threads in "
+				<< std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef __LTH_PIPELINE_SCHEDULER_HPP__
+#define __LTH_PIPELINE_SCHEDULER_HPP__
+
+#include "../lth_thread_pool.hpp"
+#include "../lth_shader_compiler.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace lth {
+
+	// Collects the pipeline creations of the systems while they are constructed, then runs them all at once on the thread
+	// pool, so that startup waits for the slowest pipeline instead of the sum of them. A creation compiles its shaders in
+	// its own Slang session and may use the device concurrently with the others: shader modules, pipelines, the pipeline
+	// cache and the memory allocator are all safe to use from several threads. At most SLANGMAXGLOBALSESSIONS creations
+	// compile at once, each one with a global session of the shader compiler pool, released once they are all done.
+	class LthPipelineScheduler {
+	public:
+		LthPipelineScheduler(LthThreadPool& threadPool, LthShaderCompiler& shaderCompiler) : threadPool{ threadPool }, shaderCompiler{ shaderCompiler } {};
+
+		LthPipelineScheduler(const LthPipelineScheduler&) = delete;
+		LthPipelineScheduler& operator=(const LthPipelineScheduler&) = delete;
+
+		// The creation must only write the members of its own pipeline.
+		void schedule(std::function<void()> pipelineCreation) { pipelineCreations.push_back(std::move(pipelineCreation)); }
+		// Runs the scheduled creations, on the workers and on the calling thread. Returns once all of them are done,
+		// rethrowing the first exception thrown by one of them.
+		void run();
+
+		bool verbose = false; // Prints the pipeline count and the duration of run.
+
+	private:
+		LthThreadPool& threadPool;
+		LthShaderCompiler& shaderCompiler;
+		std::vector<std::function<void()>> pipelineCreations{};
+	};
+}
+
+#endif
@@ -24,9 +24,25 @@ namespace lth {
 		clearPipeline();
 	}
 
-	void LthRayTracingPipeline::reloadPipeline() {
-		clearPipeline();
-		createRayTracingPipeline(lthPipelineLayout, rayTracingFilePaths);
+	std::unique_ptr<LthPipeline> LthRayTracingPipeline::createReloadedPipeline() {
+		return std::make_unique<LthRayTracingPipeline>(lthDevice, lthPipelineLayout, lthShaderCompiler, rayTracingFilePaths);
+	}
+
+	void LthRayTracingPipeline::swapPipeline(LthPipeline& other) {
+		LthPipeline::swapPipeline(other);
+		LthRayTracingPipeline& otherPipeline = static_cast<LthRayTracingPipeline&>(other);
+		std::swap(rayTracingPipeline, otherPipeline.rayTracingPipeline);
+		std::swap(rayGenShaderModule, otherPipeline.rayGenShaderModule);
+		std::swap(anyHitShaderModule, otherPipeline.anyHitShaderModule);
+		std::swap(chitShaderModule, otherPipeline.chitShaderModule);
+		std::swap(missShaderModule, otherPipeline.missShaderModule);
+		std::swap(shaderHandles, otherPipeline.shaderHandles);
+		std::swap(sbtBuffer, otherPipeline.sbtBuffer);
+		std::swap(rayGenRegion, otherPipeline.rayGenRegion);
+		std::swap(missRegion, otherPipeline.missRegion);
+		std::swap(chitRegion, otherPipeline.chitRegion);
+		std::swap(anyHitGenRegion, otherPipeline.anyHitGenRegion);
+		std::swap(callableRegion, otherPipeline.callableRegion);
 	}
 
 	void LthRayTracingPipeline::clearPipeline() {
@@ -127,15 +143,22 @@ namespace lth {
 		group.anyHitShader = 3;
 		shaderGroupInfos[3] = group;
 
+		VkPipelineCreationFeedback creationFeedback;
+		VkPipelineCreationFeedbackCreateInfo feedbackInfo = creationFeedbackInfo(creationFeedback);
+
 		VkRayTracingPipelineCreateInfoKHR rtPipelineCreateInfo {};
 		rtPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_CREATE_INFO_KHR;
+		rtPipelineCreateInfo.pNext = &feedbackInfo;
 		rtPipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStageInfos.size());
 		rtPipelineCreateInfo.pStages = shaderStageInfos.data();
 		rtPipelineCreateInfo.groupCount = static_cast<uint32_t>(shaderGroupInfos.size());
 		rtPipelineCreateInfo.pGroups = shaderGroupInfos.data();
 		rtPipelineCreateInfo.maxPipelineRayRecursionDepth = std::max(MAX_RAY_RECURSION_DEPTH, lthDevice.rayTracingProperties.maxRayRecursionDepth);
 		rtPipelineCreateInfo.layout = pipelineLayout;
-		vkCreateRayTracingPipelinesKHR(lthDevice.getDevice(), VK_NULL_HANDLE, VK_NULL_HANDLE, 1, &rtPipelineCreateInfo, nullptr, &rayTracingPipeline);
+		if (vkCreateRayTracingPipelinesKHR(lthDevice.getDevice(), VK_NULL_HANDLE, lthDevice.getPipelineCache(), 1, &rtPipelineCreateInfo, nullptr, &rayTracingPipeline) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create ray tracing pipeline!");
+		}
+		logCreationFeedback(rayTracingFilePaths.rayGenFilePath, creationFeedback);
 		
 	
 		createShaderBindingTable(rtPipelineCreateInfo);
@@ -168,7 +191,8 @@ namespace lth {
 			bufferSize,
 			1,
 			VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			baseAlignment
 			);
 
 		VkBufferDeviceAddressInfo sbtBufferDeviceAddressInfo{
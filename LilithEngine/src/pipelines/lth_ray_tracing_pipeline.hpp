@@ -40,7 +40,8 @@ namespace lth {
 		LthRayTracingPipeline& operator=(const LthRayTracingPipeline&) = delete;
 
 		void clearPipeline() override;
-		void reloadPipeline() override;
+		std::unique_ptr<LthPipeline> createReloadedPipeline() override;
+		void swapPipeline(LthPipeline& other) override;
 
 		void bind(VkCommandBuffer commandBuffer) override;
 		void trace(VkCommandBuffer commandBuffer);
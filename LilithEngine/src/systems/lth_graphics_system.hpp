@@ -18,7 +18,7 @@ namespace lth {
 		}
 
 		virtual void createPipeline(VkRenderPass renderPass) = 0;
-		virtual bool checkForPipelineUpdates() override { return lthGraphicsPipeline->checkForUpdatesAndReload(); }
+		virtual std::vector<LthPipeline*> getPipelines() override { return { lthGraphicsPipeline.get() }; }
 		virtual void render(FrameInfo& frameInfo) = 0;
 		
 		bool activateRender = true;
@@ -1,4 +1,5 @@
 #include "lth_particle_system.hpp"
+#include "../lth_upload_context.hpp"
 
 #include <cassert>
 #include <random>
@@ -9,18 +10,19 @@ namespace lth {
 	LthParticleSystem::LthParticleSystem(
 		LthDevice& device,
 		LthShaderCompiler& shaderCompiler,
+		LthPipelineScheduler& pipelineScheduler,
 		VkRenderPass renderPass,
 		DescriptorSetLayouts& setLayouts,
 		std::vector<std::unique_ptr<LthBuffer>>& cboBuffers)
 		: LthGraphicsSystem(device, shaderCompiler, renderPass, setLayouts) {
 		storageBuffers = std::move(cboBuffers);
 		createPipelineLayout(&graphicsPipelineLayout);
-		createPipeline(renderPass);
+		pipelineScheduler.schedule([this, renderPass]() { createPipeline(renderPass); });
 
 		std::vector<VkDescriptorSetLayout> computeDescriptorSetLayouts{ setLayouts.globalSetLayout->getDescriptorSetLayout(),
 																		setLayouts.computeSetLayout->getDescriptorSetLayout() };
 		createPipelineLayout(&computePipelineLayout, computeDescriptorSetLayouts);
-		createComputePipeline(renderPass);
+		pipelineScheduler.schedule([this, renderPass]() { createComputePipeline(renderPass); });
 	}
 
 	LthParticleSystem::~LthParticleSystem() {
@@ -44,8 +46,7 @@ namespace lth {
 		pipelineConfig.colorBlendAttachment.blendEnable = VK_TRUE;
 		pipelineConfig.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
 
-		pipelineConfig.bindingDescriptions = Particle::getBindingDescriptions();
-		pipelineConfig.attributeDescriptions = Particle::getAttributeDescriptions();
+		LthGraphicsPipeline::setVertexLayout<Particle>(pipelineConfig);
 		pipelineConfig.renderPass = renderPass;
 		pipelineConfig.pipelineLayout = graphicsPipelineLayout;
 		pipelineConfig.multisampleInfo.rasterizationSamples = lthDevice.getMsaaSamples();
@@ -66,10 +67,8 @@ namespace lth {
 			computeShaderSpvPath);
 	}
 
-	bool LthParticleSystem::checkForPipelineUpdates() {
-		bool updates = lthGraphicsPipeline->checkForUpdatesAndReload();
-		updates |= lthComputePipeline->checkForUpdatesAndReload();
-		return updates;
+	std::vector<LthPipeline*> LthParticleSystem::getPipelines() {
+		return { lthGraphicsPipeline.get(), lthComputePipeline.get() };
 	}
 
 
@@ -98,17 +97,19 @@ namespace lth {
 
 	void LthParticleSystem::createStorageBuffer(LthDevice& device, std::vector<std::unique_ptr<LthBuffer>>& storageBuffers) {
 
-		LthBuffer stagingBuffer{
+		LthUploadContext& uploadContext = device.getUploadContext();
+		LthUploadContext::Batch uploadBatch{ uploadContext };
+
+		auto stagingBuffer = std::make_unique<LthBuffer>(
 			device,
 			sizeof(Particle),
 			PARTICLE_COUNT,
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer(initialStorageBufferData());
-		stagingBuffer.unmap();
+		stagingBuffer->map();
+		stagingBuffer->writeToBuffer(initialStorageBufferData());
+		stagingBuffer->unmap();
 
 		storageBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 		for (int i = 0; i < storageBuffers.size(); ++i) {
@@ -118,8 +119,9 @@ namespace lth {
 				PARTICLE_COUNT,
 				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-			device.copyBuffer(stagingBuffer.getBuffer(), storageBuffers[i]->getBuffer(), stagingBuffer.getBufferSize());
+			uploadContext.copyBuffer(stagingBuffer->getBuffer(), *storageBuffers[i], stagingBuffer->getBufferSize());
 		}
+		uploadContext.keepAlive(std::move(stagingBuffer));
 	}
 
 	void LthParticleSystem::dispatch(FrameInfo& frameInfo, VkDescriptorSet& computeDescriptorSet) {
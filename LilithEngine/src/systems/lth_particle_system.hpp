@@ -15,32 +15,13 @@ namespace lth {
 		glm::vec2 position;
 		glm::vec2 velocity;
 		glm::vec4 color;
+	};
 
-		static std::vector<VkVertexInputBindingDescription> getBindingDescriptions() {
-			std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
-			VkVertexInputBindingDescription bindingDescription{};
-			bindingDescriptions[0].binding = 0;
-			bindingDescriptions[0].stride = sizeof(Particle);
-			bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-			return bindingDescriptions;
-		}
-
-		static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() {
-			std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2, {});
-
-			attributeDescriptions[0].binding = 0;
-			attributeDescriptions[0].location = 0;
-			attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-			attributeDescriptions[0].offset = offsetof(Particle, position);
-
-			attributeDescriptions[1].binding = 0;
-			attributeDescriptions[1].location = 1;
-			attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-			attributeDescriptions[1].offset = offsetof(Particle, color);
-
-			return attributeDescriptions;
-		}
+	template<>
+	struct LthVertexLayout<Particle> {
+		static constexpr std::array<VkVertexInputAttributeDescription, 2> attributes{ {
+			{ 0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Particle, position) },
+			{ 1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Particle, color) } } };
 	};
 
 	static constexpr uint32_t PARTICLE_COUNT = 1024;
@@ -55,6 +36,7 @@ namespace lth {
 
 		LthParticleSystem(LthDevice& device,
 						LthShaderCompiler& shaderCompiler,
+						LthPipelineScheduler& pipelineScheduler,
 						VkRenderPass renderPass,
 						DescriptorSetLayouts& setLayouts,
 						std::vector<std::unique_ptr<LthBuffer>>& cboBuffers);
@@ -66,7 +48,7 @@ namespace lth {
 		void dispatch(FrameInfo& frameInfo, VkDescriptorSet& computeDescriptorSet);
 		void render(FrameInfo& frameInfo);
 
-		bool checkForPipelineUpdates() override;
+		std::vector<LthPipeline*> getPipelines() override;
 
 		static void createStorageBuffer(LthDevice&, std::vector<std::unique_ptr<LthBuffer>>&);
 
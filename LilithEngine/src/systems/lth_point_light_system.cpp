@@ -17,6 +17,7 @@ namespace lth {
 	LthPointLightSystem::LthPointLightSystem(
 		LthDevice& device,
 		LthShaderCompiler& shaderCompiler,
+		LthPipelineScheduler& pipelineScheduler,
 		VkRenderPass renderPass,
 		DescriptorSetLayouts& setLayouts)
 		: LthGraphicsSystem(device, shaderCompiler, renderPass, setLayouts) {
@@ -25,12 +26,11 @@ namespace lth {
 		pushConstantRange.offset = 0;
 		pushConstantRange.size = sizeof(PointLightPushConstants);
 
-		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ setLayouts.globalSetLayout->getDescriptorSetLayout(),
-																setLayouts.gameObjectSetLayout->getDescriptorSetLayout() };
+		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ setLayouts.globalSetLayout->getDescriptorSetLayout() };
 		createPipelineLayout(&graphicsPipelineLayout,
 			descriptorSetLayouts,
 			{ pushConstantRange });
-		createPipeline(renderPass);
+		pipelineScheduler.schedule([this, renderPass]() { createPipeline(renderPass); });
 	}
 
 	void LthPointLightSystem::createPipeline(VkRenderPass renderPass) {
@@ -39,8 +39,6 @@ namespace lth {
 		LthGraphicsPipelineConfigInfo pipelineConfig{};
 		LthGraphicsPipeline::defaultGraphicsPipelineConfigInfo(pipelineConfig);
 		LthGraphicsPipeline::enableAlphaBlending(pipelineConfig);
-		pipelineConfig.bindingDescriptions.clear();
-		pipelineConfig.attributeDescriptions.clear();
 		pipelineConfig.renderPass = renderPass;
 		pipelineConfig.pipelineLayout = graphicsPipelineLayout;
 		pipelineConfig.multisampleInfo.rasterizationSamples = lthDevice.getMsaaSamples();
@@ -90,8 +88,8 @@ namespace lth {
 			0,
 			1,
 			&frameInfo.globalDescriptorSet,
-			0,
-			nullptr);
+			1,
+			&frameInfo.globalUboOffset);
 
 		//Iterate form farthest to nearest light.
 		for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
@@ -111,16 +109,6 @@ namespace lth {
 				&push
 			);
 
-			vkCmdBindDescriptorSets(
-				frameInfo.graphicsCommandBuffer,
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				graphicsPipelineLayout,
-				1,
-				1,
-				&obj->gameObjectDescriptorSets[frameInfo.frameIndex],
-				0,
-				nullptr);
-
 			vkCmdDraw(frameInfo.graphicsCommandBuffer, 6, 1, 0, 0);
 		}
 
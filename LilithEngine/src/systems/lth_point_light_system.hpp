@@ -19,6 +19,7 @@ namespace lth {
 
 		LthPointLightSystem(LthDevice& device,
 			LthShaderCompiler& shaderCompiler,
+			LthPipelineScheduler& pipelineScheduler,
 			VkRenderPass renderPass,
 			DescriptorSetLayouts& setLayouts);
 
@@ -5,6 +5,7 @@ namespace lth {
 	LthRayTracingSystem::LthRayTracingSystem(
 		LthDevice& device,
 		LthShaderCompiler& shaderCompiler,
+		LthPipelineScheduler& pipelineScheduler,
 		VkRenderPass renderPass,
 		DescriptorSetLayouts& setLayouts) : LthSystem(device, shaderCompiler, renderPass, setLayouts) {
 
@@ -16,7 +17,7 @@ namespace lth {
 		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ setLayouts.globalSetLayout->getDescriptorSetLayout(),
 																setLayouts.rayTracingSetLayout->getDescriptorSetLayout() };
 		createPipelineLayout(&rayTracingPipelineLayout, descriptorSetLayouts, { pushConstantRange });
-		createPipeline(renderPass);
+		pipelineScheduler.schedule([this, renderPass]() { createPipeline(renderPass); });
 	}
 
 	void LthRayTracingSystem::createPipeline(VkRenderPass renderPass) {
@@ -28,8 +29,8 @@ namespace lth {
 			rayTracingFilePaths);
 	}
 
-	bool LthRayTracingSystem::checkForPipelineUpdates() {
-		return lthRayTracingPipeline->checkForUpdatesAndReload();
+	std::vector<LthPipeline*> LthRayTracingSystem::getPipelines() {
+		return { lthRayTracingPipeline.get() };
 	}
 
 	void LthRayTracingSystem::trace(FrameInfo& frameInfo, VkDescriptorSet& computeDescriptorSet) {
@@ -47,8 +48,8 @@ namespace lth {
 			0,
 			2,
 			descriptorSets.data(),
-			0,
-			nullptr);
+			1,
+			&frameInfo.globalUboOffset);
 
 		RayTracingPushConstantData push{};
 
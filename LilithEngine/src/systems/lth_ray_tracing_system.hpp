@@ -21,6 +21,7 @@ namespace lth {
 	public:
 		LthRayTracingSystem(LthDevice& device,
 			LthShaderCompiler& shaderCompiler,
+			LthPipelineScheduler& pipelineScheduler,
 			VkRenderPass renderPass,
 			DescriptorSetLayouts& setLayouts);
 		~LthRayTracingSystem() {
@@ -28,7 +29,7 @@ namespace lth {
 		}
 
 		void createPipeline(VkRenderPass renderPass);
-		bool checkForPipelineUpdates() override;
+		std::vector<LthPipeline*> getPipelines() override;
 		void trace(FrameInfo& frameInfo, VkDescriptorSet& computeDescriptorSet);
 
 		bool activateTrace = true;
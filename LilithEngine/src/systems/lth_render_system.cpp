@@ -1,27 +1,39 @@
 #include "lth_render_system.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <array>
+#include <iostream>
 
 namespace lth {
 
 	LthRenderSystem::LthRenderSystem(
 		LthDevice& device,
 		LthShaderCompiler& shaderCompiler,
+		LthPipelineScheduler& pipelineScheduler,
 		VkRenderPass renderPass,
 		DescriptorSetLayouts& setLayouts)
 		: LthGraphicsSystem(device, shaderCompiler, renderPass, setLayouts) {
-		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(SimplePushConstantData);
-
 		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ setLayouts.globalSetLayout->getDescriptorSetLayout(),
-																setLayouts.gameObjectSetLayout->getDescriptorSetLayout() };
+																setLayouts.instanceSetLayout->getDescriptorSetLayout(),
+																setLayouts.textureSetLayout->getDescriptorSetLayout() };
 		createPipelineLayout(&graphicsPipelineLayout,
-			descriptorSetLayouts,
+			descriptorSetLayouts);
+		pipelineScheduler.schedule([this, renderPass]() { createPipeline(renderPass); });
+
+		VkPushConstantRange pushConstantRange{
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0,
+			.size = sizeof(ClusterCullingPushConstants),
+		};
+		createPipelineLayout(&clusterCullingPipelineLayout,
+			{ setLayouts.clusterCullingSetLayout->getDescriptorSetLayout() },
 			{ pushConstantRange });
-		createPipeline(renderPass);
+		pipelineScheduler.schedule([this]() { createClusterCullingPipeline(); });
+	}
+
+	LthRenderSystem::~LthRenderSystem() {
+		vkDestroyPipelineLayout(lthDevice.getDevice(), clusterCullingPipelineLayout, nullptr);
 	}
 
 	void LthRenderSystem::createPipeline(VkRenderPass renderPass) {
@@ -39,49 +51,223 @@ namespace lth {
 			renderFilePaths);
 	}
 
+	void LthRenderSystem::createClusterCullingPipeline() {
+		assert(clusterCullingPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
+
+		clusterCullingPipeline = std::make_unique<LthComputePipeline>(
+			lthDevice,
+			clusterCullingPipelineLayout,
+			lthShaderCompiler,
+			clusterCullingShaderSpvPath);
+	}
+
+	std::vector<LthPipeline*> LthRenderSystem::getPipelines() {
+		return { lthGraphicsPipeline.get(), clusterCullingPipeline.get() };
+	}
+
+	void LthRenderSystem::cullClusters(FrameInfo& frameInfo, VkDescriptorSet clusterCullingDescriptorSet) {
+		clusterCullingWork = {};
+		frameClusterCulling[frameInfo.frameIndex] = {};
+		if (!activateRender) return;
+		clusterCullingWork = frameInfo.scene.writeClusterJobs(frameInfo.frameRingBuffer);
+		if (clusterCullingWork.jobCount == 0) return;
+
+		// Without a draw count (or beyond its limit), every meshlet keeps its draw and the culled ones get no instance.
+		clusterDrawCount = lthDevice.supportsDrawIndirectCount() && lthDevice.supportsMultiDrawIndirect()
+			&& std::max(clusterCullingWork.uint16DrawCapacity, clusterCullingWork.uint32DrawCapacity) <= lthDevice.getMaxDrawIndirectCount();
+		frameClusterCulling[frameInfo.frameIndex] = FrameClusterCulling{
+			.work = clusterCullingWork,
+			.drawCount = clusterDrawCount,
+			.culling = frameInfo.scene.enableFrustumCulling || enableConeCulling,
+		};
+
+		VkCommandBuffer commandBuffer = frameInfo.graphicsCommandBuffer;
+		clusterCullingPipeline->bind(commandBuffer);
+
+		std::array<uint32_t, 3> dynamicOffsets{
+			static_cast<uint32_t>(clusterCullingWork.jobs.offset),
+			frameInfo.instanceBufferOffset,
+			static_cast<uint32_t>(clusterCullingWork.draws.offset) };
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			clusterCullingPipelineLayout,
+			0,
+			1,
+			&clusterCullingDescriptorSet,
+			static_cast<uint32_t>(dynamicOffsets.size()),
+			dynamicOffsets.data());
+
+		ClusterCullingPushConstants push{
+			.frustumPlanes = frameInfo.camera.getFrustumPlanes(),
+			.cameraPosition = frameInfo.camera.getPosition(),
+			.uint32DrawBase = clusterCullingWork.uint16DrawCapacity,
+			.flags = (clusterDrawCount ? LTH_CLUSTER_CULLING_DRAW_COUNT : 0u)
+				| (frameInfo.scene.enableFrustumCulling ? LTH_CLUSTER_CULLING_FRUSTUM : 0u)
+				| (enableConeCulling ? LTH_CLUSTER_CULLING_CONE : 0u),
+		};
+		// One workgroup per job, in dispatches of at most the guaranteed maxComputeWorkGroupCount.
+		constexpr uint32_t maxWorkGroupCount = 65535;
+		for (uint32_t firstJob = 0; firstJob < clusterCullingWork.jobCount; firstJob += maxWorkGroupCount) {
+			push.firstJob = firstJob;
+			vkCmdPushConstants(commandBuffer, clusterCullingPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClusterCullingPushConstants), &push);
+			vkCmdDispatch(commandBuffer, std::min(maxWorkGroupCount, clusterCullingWork.jobCount - firstJob), 1, 1);
+		}
+
+		// The host reads the draws back in readClusterCullingResults.
+		VkMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT,
+		};
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+			0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr);
+	}
+
+	void LthRenderSystem::readClusterCullingResults(int frameIndex) {
+		FrameClusterCulling& frame = frameClusterCulling[frameIndex];
+		const std::array<uint32_t, 2> drawCapacities{ frame.work.uint16DrawCapacity, frame.work.uint32DrawCapacity };
+		clusterMeshletCount = drawCapacities[0] + drawCapacities[1];
+		visibleMeshletCount = 0;
+		if (frame.work.jobCount == 0) return;
+
+		const uint8_t* draws = static_cast<const uint8_t*>(frame.work.draws.mapped);
+		bool valid = true;
+		if (frame.drawCount) {
+			const uint32_t* drawCounts = reinterpret_cast<const uint32_t*>(draws);
+			for (size_t type = 0; type < drawCapacities.size(); ++type) {
+				valid = valid && drawCounts[type] <= drawCapacities[type];
+				visibleMeshletCount += drawCounts[type];
+			}
+		}
+		else {
+			const VkDrawIndexedIndirectCommand* drawCommands = reinterpret_cast<const VkDrawIndexedIndirectCommand*>(draws + CLUSTER_DRAW_COUNTS_SIZE);
+			for (uint32_t draw = 0; draw < clusterMeshletCount; ++draw) {
+				valid = valid && drawCommands[draw].instanceCount <= 1;
+				visibleMeshletCount += drawCommands[draw].instanceCount;
+			}
+		}
+		valid = valid && (frame.culling || visibleMeshletCount == clusterMeshletCount);
+		if (!valid) {
+			std::cerr << "Cluster culling drew " << visibleMeshletCount << " of " << clusterMeshletCount << " meshlets"
+				<< (frame.culling ? "" : " without any culling test") << "!" << std::endl;
+		}
+		frame = {};
+	}
+
 	void LthRenderSystem::render(FrameInfo& frameInfo) {
 		if (!activateRender) return;
 
 		lthGraphicsPipeline->bind(frameInfo.graphicsCommandBuffer);
 
+		std::array<VkDescriptorSet, 3> descriptorSets{ frameInfo.globalDescriptorSet, frameInfo.instanceDescriptorSet, frameInfo.textureDescriptorSet };
+		std::array<uint32_t, 2> dynamicOffsets{ frameInfo.globalUboOffset, frameInfo.instanceBufferOffset };
 		vkCmdBindDescriptorSets(
 			frameInfo.graphicsCommandBuffer,
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
 			graphicsPipelineLayout,
 			0,
-			1,
-			&frameInfo.globalDescriptorSet,
-			0,
-			nullptr);
-
-		for (auto& keyValue : frameInfo.scene.getInstanceArray()) {
-			auto& obj = frameInfo.scene.gameObject(keyValue.first);
-			auto& model = frameInfo.scene.model(keyValue.second);
-
-			SimplePushConstantData push{};
-			push.modelMatrix = obj->transform.modelMatrix();
-			push.normalMatrix = obj->transform.normalMatrix();
-
-			vkCmdPushConstants(
-				frameInfo.graphicsCommandBuffer,
-				graphicsPipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-				0,
-				sizeof(SimplePushConstantData),
-				&push);
-
-			vkCmdBindDescriptorSets(
-				frameInfo.graphicsCommandBuffer,
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				graphicsPipelineLayout,
-				1,
-				1,
-				&obj->gameObjectDescriptorSets[frameInfo.frameIndex],
-				0,
-				nullptr);
-
-			model->bind(frameInfo.graphicsCommandBuffer);
-			model->draw(frameInfo.graphicsCommandBuffer);
+			static_cast<uint32_t>(descriptorSets.size()),
+			descriptorSets.data(),
+			static_cast<uint32_t>(dynamicOffsets.size()),
+			dynamicOffsets.data());
+
+		// Indirect commands need a non zero firstInstance to reach the InstanceData of their object.
+		if (useIndirectDraws && lthDevice.supportsDrawIndirectFirstInstance()) {
+			renderIndirect(frameInfo);
+		}
+		else {
+			renderDirect(frameInfo);
+		}
+		renderClusters(frameInfo);
+	}
+
+	void LthRenderSystem::renderDirect(FrameInfo& frameInfo) {
+		// Per-object data is fetched in the instance buffer with gl_InstanceIndex, there is no per-draw descriptor or push constant.
+		// Visible objects sharing a model and a LOD have contiguous InstanceData and are drawn with a single instanced draw.
+		// All the models share the geometry pool index buffer, it is only rebound when the index type changes.
+		VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+		for (auto& draw : frameInfo.scene.getInstanceDraws()) {
+			if (draw.indexType != boundIndexType) {
+				frameInfo.scene.getGeometryPool().bindIndexBuffer(frameInfo.graphicsCommandBuffer, draw.indexType);
+				boundIndexType = draw.indexType;
+			}
+			auto& model = frameInfo.scene.model(draw.modelId);
+			model->draw(frameInfo.graphicsCommandBuffer, draw.firstInstance, draw.instanceCount, draw.lod);
+		}
+	}
+
+	void LthRenderSystem::renderIndirect(FrameInfo& frameInfo) {
+		LthDrawCommands drawCommands = frameInfo.scene.writeDrawCommands(frameInfo.frameRingBuffer);
+		LthGeometryPool& geometryPool = frameInfo.scene.getGeometryPool();
+
+		if (drawCommands.uint16DrawCount > 0) {
+			geometryPool.bindIndexBuffer(frameInfo.graphicsCommandBuffer, VK_INDEX_TYPE_UINT16);
+			drawIndirect(frameInfo.graphicsCommandBuffer, drawCommands.allocation, 0, drawCommands.uint16DrawCount);
+		}
+		if (drawCommands.uint32DrawCount > 0) {
+			geometryPool.bindIndexBuffer(frameInfo.graphicsCommandBuffer, VK_INDEX_TYPE_UINT32);
+			drawIndirect(frameInfo.graphicsCommandBuffer, drawCommands.allocation, drawCommands.uint16DrawCount, drawCommands.uint32DrawCount);
+		}
+	}
+
+	void LthRenderSystem::renderClusters(FrameInfo& frameInfo) {
+		if (clusterCullingWork.jobCount == 0) return;
+		LthGeometryPool& geometryPool = frameInfo.scene.getGeometryPool();
+
+		// The draw commands follow the draw counts.
+		LthRingAllocation drawCommands = clusterCullingWork.draws;
+		drawCommands.offset += CLUSTER_DRAW_COUNTS_SIZE;
+		const std::array<VkIndexType, 2> indexTypes{ VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32 };
+		const std::array<uint32_t, 2> drawCapacities{ clusterCullingWork.uint16DrawCapacity, clusterCullingWork.uint32DrawCapacity };
+		uint32_t firstDraw = 0;
+		for (size_t type = 0; type < indexTypes.size(); ++type) {
+			if (drawCapacities[type] == 0) continue;
+			geometryPool.bindIndexBuffer(frameInfo.graphicsCommandBuffer, indexTypes[type]);
+			if (clusterDrawCount) {
+				vkCmdDrawIndexedIndirectCount(
+					frameInfo.graphicsCommandBuffer,
+					drawCommands.buffer,
+					drawCommands.offset + sizeof(VkDrawIndexedIndirectCommand) * firstDraw,
+					clusterCullingWork.draws.buffer,
+					clusterCullingWork.draws.offset + sizeof(uint32_t) * type,
+					drawCapacities[type],
+					sizeof(VkDrawIndexedIndirectCommand));
+			}
+			else {
+				drawIndirect(frameInfo.graphicsCommandBuffer, drawCommands, firstDraw, drawCapacities[type]);
+			}
+			firstDraw += drawCapacities[type];
+		}
+	}
+
+	void LthRenderSystem::drawIndirect(VkCommandBuffer commandBuffer, const LthRingAllocation& drawCommands, uint32_t firstDraw, uint32_t drawCount) {
+		const VkDeviceSize firstOffset = drawCommands.offset + sizeof(VkDrawIndexedIndirectCommand) * firstDraw;
+		if (lthDevice.supportsMultiDrawIndirect()) {
+			uint32_t maxDrawCount = lthDevice.getMaxDrawIndirectCount();
+			for (uint32_t drawIndex = 0; drawIndex < drawCount; drawIndex += maxDrawCount) {
+				vkCmdDrawIndexedIndirect(
+					commandBuffer,
+					drawCommands.buffer,
+					firstOffset + sizeof(VkDrawIndexedIndirectCommand) * drawIndex,
+					std::min(maxDrawCount, drawCount - drawIndex),
+					sizeof(VkDrawIndexedIndirectCommand));
+			}
+		}
+		else {
+			for (uint32_t drawIndex = 0; drawIndex < drawCount; ++drawIndex) {
+				vkCmdDrawIndexedIndirect(
+					commandBuffer,
+					drawCommands.buffer,
+					firstOffset + sizeof(VkDrawIndexedIndirectCommand) * drawIndex,
+					1,
+					sizeof(VkDrawIndexedIndirectCommand));
+			}
 		}
 	}
 }
\ No newline at end of file
@@ -4,31 +4,79 @@
 #include "lth_graphics_system.hpp"
 #include "../gameObjects/lth_game_object.hpp"
 #include "../lth_global_info.hpp"
+#include "../pipelines/lth_compute_pipeline.hpp"
 
+#include <array>
 #include <memory>
 #include <vector>
 
 namespace lth {
 
-	struct SimplePushConstantData {
-		glm::mat4 modelMatrix{ 1.f };
-		glm::mat4 normalMatrix{ 1.f };
+	enum LthClusterCullingFlags : uint32_t {
+		LTH_CLUSTER_CULLING_DRAW_COUNT = 1u << 0, // Visible meshlets are compacted and drawn with vkCmdDrawIndexedIndirectCount.
+		LTH_CLUSTER_CULLING_FRUSTUM = 1u << 1,
+		LTH_CLUSTER_CULLING_CONE = 1u << 2,
+	};
+
+	struct ClusterCullingPushConstants {
+		LthFrustumPlanes frustumPlanes;
+		glm::vec3 cameraPosition;
+		uint32_t uint32DrawBase;
+		uint32_t flags; // LthClusterCullingFlags.
+		uint32_t firstJob;
 	};
 
 	class LthRenderSystem : public LthGraphicsSystem {
 		LthGraphicsPipelineFilePaths renderFilePaths = {
 			.vertexFilePath = SHADERSPIRVFOLDERPATH("standard.vert"),
 			.fragmentFilePath = SHADERSPIRVFOLDERPATH("standard.frag") };
+		inline static std::string clusterCullingShaderSpvPath = SHADERSPIRVFOLDERPATH("clusterCull.comp");
 	public:
 
-		LthRenderSystem(LthDevice& device, LthShaderCompiler& shaderCompiler, VkRenderPass renderPass, DescriptorSetLayouts& setLayouts);
+		LthRenderSystem(LthDevice& device, LthShaderCompiler& shaderCompiler, LthPipelineScheduler& pipelineScheduler, VkRenderPass renderPass, DescriptorSetLayouts& setLayouts);
+		~LthRenderSystem();
 
 		LthRenderSystem(const LthRenderSystem&) = delete;
 		LthRenderSystem& operator=(const LthRenderSystem&) = delete;
 		
+		// Culls the meshlets of the scene cluster draws and writes their draw commands. Recorded in the graphics command
+		// buffer, outside of the render pass that calls render.
+		void cullClusters(FrameInfo& frameInfo, VkDescriptorSet clusterCullingDescriptorSet);
+		// Reads back the draws of the last cluster culling pass of the frame, once its fence signaled and before the ring
+		// buffer gives back its bytes. Reports to std::cerr a pass that drew more meshlets than it was given, or that
+		// culled some without any culling test.
+		void readClusterCullingResults(int frameIndex);
 		void render(FrameInfo &frameInfo);
+
+		std::vector<LthPipeline*> getPipelines() override;
+
+		// Of the last frame read by readClusterCullingResults.
+		uint32_t getClusterMeshletCount() const { return clusterMeshletCount; }
+		uint32_t getVisibleMeshletCount() const { return visibleMeshletCount; }
+
+		bool useIndirectDraws = true; // One multi-draw indirect call for the whole scene instead of one draw per instance.
+		bool enableConeCulling = false; // Only correct with back face culling, which the standard pipeline does not do.
 	private:
 		void createPipeline(VkRenderPass renderPass);
+		void createClusterCullingPipeline();
+		void renderDirect(FrameInfo& frameInfo);
+		void renderIndirect(FrameInfo& frameInfo);
+		void renderClusters(FrameInfo& frameInfo);
+		void drawIndirect(VkCommandBuffer commandBuffer, const LthRingAllocation& drawCommands, uint32_t firstDraw, uint32_t drawCount);
+
+		std::unique_ptr<LthComputePipeline> clusterCullingPipeline;
+		VkPipelineLayout clusterCullingPipelineLayout = 0;
+		LthClusterCullingWork clusterCullingWork{};
+		bool clusterDrawCount = false; // The cluster culling pass of the frame compacted its draws.
+
+		struct FrameClusterCulling {
+			LthClusterCullingWork work{};
+			bool drawCount = false;
+			bool culling = false; // Frustum or cone test.
+		};
+		std::array<FrameClusterCulling, MAX_FRAMES_IN_FLIGHT> frameClusterCulling{};
+		uint32_t clusterMeshletCount = 0;
+		uint32_t visibleMeshletCount = 0;
 	};
 }
 
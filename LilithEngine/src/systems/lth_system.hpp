@@ -4,8 +4,11 @@
 #include "../lth_device.hpp"
 #include "../lth_descriptors.hpp"
 #include "../lth_shader_compiler.hpp"
+#include "../pipelines/lth_pipeline.hpp"
+#include "../pipelines/lth_pipeline_scheduler.hpp"
 
 #include <string>
+#include <vector>
 
 namespace lth {
 
@@ -17,7 +20,8 @@ namespace lth {
 			DescriptorSetLayouts& setLayouts) :
 			lthDevice{ device }, lthShaderCompiler{ shaderCompiler } {};
 
-		virtual bool checkForPipelineUpdates() = 0;
+		// Pipelines to check for shader updates, see LthPipelineReloader.
+		virtual std::vector<LthPipeline*> getPipelines() = 0;
 	protected:
 		void createPipelineLayout(VkPipelineLayout* pipelineLayout,
 			const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts = {},
@@ -8,7 +8,10 @@
 
 namespace lth {
 
+	// The systems only schedule the creation of their pipelines: the constructor creates all of them concurrently, once
+	// every system is constructed.
 	struct LthSystemSet {
+		LthPipelineScheduler pipelineScheduler; // First, so that it is ready when the systems are constructed.
 		LthRenderSystem renderSystem;
 		LthRayTracingSystem rayTracingSystem;
 		LthPointLightSystem pointLightSystem;
@@ -19,10 +22,22 @@ namespace lth {
 			VkRenderPass renderPass,
 			DescriptorSetLayouts& setLayouts,
 			std::vector<std::unique_ptr<LthBuffer>>& cboBuffers) :
-			particleSystem(device, shaderCompiler, renderPass, setLayouts, cboBuffers),
-			renderSystem(device, shaderCompiler, renderPass, setLayouts),
-			rayTracingSystem(device, shaderCompiler, renderPass, setLayouts),
-			pointLightSystem(device, shaderCompiler, renderPass, setLayouts){};
+			pipelineScheduler(device.getThreadPool(), shaderCompiler),
+			particleSystem(device, shaderCompiler, pipelineScheduler, renderPass, setLayouts, cboBuffers),
+			renderSystem(device, shaderCompiler, pipelineScheduler, renderPass, setLayouts),
+			rayTracingSystem(device, shaderCompiler, pipelineScheduler, renderPass, setLayouts),
+			pointLightSystem(device, shaderCompiler, pipelineScheduler, renderPass, setLayouts) {
+			pipelineScheduler.run();
+		};
+
+		std::vector<LthPipeline*> getPipelines() {
+			std::vector<LthPipeline*> pipelines;
+			for (LthSystem* system : std::initializer_list<LthSystem*>{ &renderSystem, &rayTracingSystem, &pointLightSystem, &particleSystem }) {
+				std::vector<LthPipeline*> systemPipelines = system->getPipelines();
+				pipelines.insert(pipelines.end(), systemPipelines.begin(), systemPipelines.end());
+			}
+			return pipelines;
+		}
 	};
 }
 